@@ -50,6 +50,7 @@
 
 #include "CPUSensors.h"
 #include "IntelDefinitions.h"
+#include "CPUSensorsMath.h"
 
 #include "timer.h"
 #include "smc.h"
@@ -84,24 +85,74 @@ enum {
 
     kCPUSensorsVoltageCore              = BIT(12),
     kCPUSensorsVoltagePackage           = BIT(13),
+
+    kCPUSensorsResidencyCore            = BIT(14),
+    kCPUSensorsResidencyPackage         = BIT(15),
+
+    kCPUSensorsPowerPlatform            = BIT(16),
+    kCPUSensorsPowerLimit               = BIT(17),
+    kCPUSensorsPowerThrottle            = BIT(18),
+
+    kCPUSensorsEventsCore               = BIT(19),
+    kCPUSensorsEventsPackage            = BIT(20),
 };
 
+#define kCPUSensorsThermalAll   (kCPUSensorsThermalCore | kCPUSensorsThermalPackage)
+#define kCPUSensorsEventsAll    (kCPUSensorsEventsCore | kCPUSensorsEventsPackage)
+#define kCPUSensorsFrequencyAll (kCPUSensorsFrequencyCore | kCPUSensorsFrequencyPackage | kCPUSensorsFrequencyCoreAverage | kCPUSensorsFrequencyPackageAverage)
+#define kCPUSensorsPowerDomains (kCPUSensorsPowerTotal | kCPUSensorsPowerCores | kCPUSensorsPowerUncore | kCPUSensorsPowerDram | kCPUSensorsPowerPlatform)
+
 static UInt16 cpu_energy_msrs[] =
 {
     MSR_PKG_ENERY_STATUS,
     MSR_PP0_ENERY_STATUS,
     MSR_PP1_ENERY_STATUS,
-    MSR_DRAM_ENERGY_STATUS
+    MSR_DRAM_ENERGY_STATUS,
+    MSR_PLATFORM_ENERGY_STATUS
 };
 
-static UInt16 cpu_energy_flgs[] =
+static UInt32 cpu_energy_flgs[] =
 {
     kCPUSensorsPowerTotal,
     kCPUSensorsPowerCores,
     kCPUSensorsPowerUncore,
-    kCPUSensorsPowerDram
+    kCPUSensorsPowerDram,
+    kCPUSensorsPowerPlatform
+};
+
+// C1 has no residency counter and is derived from C0 (MPERF) and the deeper states
+static UInt16 cpu_core_cstate_msrs[kCPUSensorsCoreCStates] =
+{
+    0,
+    MSR_CORE_C3_RESIDENCY,
+    MSR_CORE_C6_RESIDENCY,
+    MSR_CORE_C7_RESIDENCY
 };
 
+static UInt8 cpu_core_cstate_numbers[kCPUSensorsCoreCStates] = { 1, 3, 6, 7 };
+
+static UInt16 cpu_package_cstate_msrs[kCPUSensorsPackageCStates] =
+{
+    MSR_PKG_C2_RESIDENCY,
+    MSR_PKG_C3_RESIDENCY,
+    MSR_PKG_C6_RESIDENCY,
+    MSR_PKG_C7_RESIDENCY,
+    MSR_PKG_C8_RESIDENCY,
+    MSR_PKG_C9_RESIDENCY,
+    MSR_PKG_C10_RESIDENCY
+};
+
+static UInt8 cpu_package_cstate_numbers[kCPUSensorsPackageCStates] = { 2, 3, 6, 7, 8, 9, 10 };
+
+// Sticky log bits in IA32_THERM_STATUS and IA32_PACKAGE_THERM_STATUS, cleared by writing zero
+static UInt16 cpu_throttle_log_bits[kCPUSensorsThrottleEvents] = { BIT(1), BIT(3), BIT(5), BIT(11) };
+
+static char cpu_throttle_event_names[kCPUSensorsThrottleEvents] = { 'T', 'H', 'C', 'L' };
+
+#define kCPUSensorsThermalLogs      (BIT(1) | BIT(3) | BIT(5) | BIT(7) | BIT(9) | BIT(11) | BIT(13) | BIT(15))
+#define kCPUSensorsThrottleLogs     (BIT(1) | BIT(3) | BIT(5) | BIT(11))
+#define kCPUSensorsThresholdLogs    (BIT(7) | BIT(9))
+
 #define super FakeSMCPlugin
 OSDefineMetaClassAndStructors(CPUSensors, FakeSMCPlugin)
 
@@ -117,6 +168,20 @@ inline uint64_t rdmpc64(uint32_t counter)
 //	return c > 96 && c < 103 ? c - 87 : c > 47 && c < 58 ? c - 48 : 0;
 //};
 
+static inline bool accumulate_throttle_events(UInt64 status, UInt32 *events)
+{
+    bool logged = false;
+
+    for (UInt8 index = 0; index < kCPUSensorsThrottleEvents; index++) {
+        if (status & cpu_throttle_log_bits[index]) {
+            events[index]++;
+            logged = true;
+        }
+    }
+
+    return logged;
+}
+
 static inline UInt8 get_cpu_number()
 {
     UInt8 number = cpu_number() & 0xFF;
@@ -150,6 +215,50 @@ static void read_cpu_rapl(void *magic)
     }
 }
 
+// Reads each status register once for the readout and the sticky logs. Without thresholds every pass
+// refreshes, with thresholds a core only refreshes and re-centers its own band once it has left it.
+// Only the logs consumed here are cleared, the others are written back as ones to keep them
+static void update_thermal_status(CPUSensorsCounters *counters, UInt32 number)
+{
+    UInt64 msr, consumed;
+
+    if (bit_get(counters->event_flags, kCPUSensorsThermalCore | kCPUSensorsEventsCore)) {
+        msr = rdmsr64(MSR_IA32_THERM_STS);
+        consumed = 0;
+
+        if (bit_get(counters->event_flags, kCPUSensorsThermalCore) && (msr & 0x80000000) &&
+            (counters->thermal_refresh || (counters->thermal_thresholds && (msr & kCPUSensorsThresholdLogs)))) {
+            counters->thermal_status[number] = (msr >> 16) & 0x7F;
+
+            if (counters->thermal_thresholds) {
+                wrmsr64(MSR_IA32_THERM_INTERRUPT, get_thermal_thresholds(rdmsr64(MSR_IA32_THERM_INTERRUPT), counters->thermal_status[number], kCPUSensorsThermalThresholdBand));
+                consumed |= kCPUSensorsThresholdLogs;
+            }
+        }
+
+        if (bit_get(counters->event_flags, kCPUSensorsEventsCore) && accumulate_throttle_events(msr, counters->throttle_events[number])) {
+            consumed |= kCPUSensorsThrottleLogs;
+        }
+
+        if (msr & consumed) {
+            wrmsr64(MSR_IA32_THERM_STS, msr & kCPUSensorsThermalLogs & ~consumed);
+        }
+    }
+
+    // Package thresholds are re-centered by the timer after the pass
+    if (number == 0 && counters->thermal_refresh && bit_get(counters->event_flags, kCPUSensorsThermalPackage | kCPUSensorsEventsPackage)) {
+        msr = rdmsr64(MSR_IA32_PACKAGE_THERM_STATUS);
+
+        if (bit_get(counters->event_flags, kCPUSensorsThermalPackage) && (msr & 0x80000000)) {
+            counters->thermal_status_package = (msr >> 16) & 0x7F;
+        }
+
+        if (bit_get(counters->event_flags, kCPUSensorsEventsPackage) && accumulate_throttle_events(msr, counters->throttle_events_package)) {
+            wrmsr64(MSR_IA32_PACKAGE_THERM_STATUS, msr & kCPUSensorsThermalLogs & ~kCPUSensorsThrottleLogs);
+        }
+    }
+}
+
 static void update_counters(void *arg)
 {
     CPUSensorsCounters *counters = (CPUSensorsCounters *)arg;
@@ -158,18 +267,8 @@ static void update_counters(void *arg)
 
     if (number < kCPUSensorsMaxCpus) {
 
-        UInt64 msr;
-
-        if (bit_get(counters->event_flags, kCPUSensorsThermalCore)) {
-            if ((msr = rdmsr64(MSR_IA32_THERM_STS)) & 0x80000000) {
-                counters->thermal_status[number] = (msr >> 16) & 0x7F;
-            }
-        }
-
-        if (number == 0 && bit_get(counters->event_flags, kCPUSensorsThermalPackage)) {
-            if ((msr = rdmsr64(MSR_IA32_PACKAGE_THERM_STATUS)) & 0x80000000) {
-                counters->thermal_status_package = (msr >> 16) & 0x7F;
-            }
+        if (counters->thermal_refresh || counters->thermal_thresholds) {
+            update_thermal_status(counters, number);
         }
 
         if (bit_get(counters->event_flags, kCPUSensorsMultiplierCore) || (number == 0 && bit_get(counters->event_flags, kCPUSensorsMultiplierPackage))) {
@@ -186,21 +285,63 @@ static void update_counters(void *arg)
         }
 
         // Frequency counters
-        if (counters->update_perf_counters && (bit_get(counters->event_flags, kCPUSensorsFrequencyCore) || (number == 0 && bit_get(counters->event_flags, kCPUSensorsFrequencyPackage)))) {
+        if (counters->update_fixed_counters && bit_get(counters->event_flags, kCPUSensorsFrequencyAll)) {
+            // Another agent may have reprogrammed the PMU since the last pass, take the counters back
+            // and restart the interval, values read across the reprogramming are meaningless
+            if ((counters->fixed_rearmed[number] = !pmu_fixed_counters_armed())) {
+                pmu_arm_fixed_counters();
+            }
+
             counters->utc_before[number] = counters->utc_after[number];
             counters->urc_before[number] = counters->urc_after[number];
             counters->utc_after[number] = rdmpc64(0x40000001);
             counters->urc_after[number] = rdmpc64(0x40000002);
         }
 
+        // C-state residency counters
+        if (bit_get(counters->event_flags, kCPUSensorsResidencyCore)) {
+            counters->tsc_before[number] = counters->tsc_after[number];
+            counters->c0_before[number] = counters->c0_after[number];
+            counters->tsc_after[number] = rdmsr64(MSR_IA32_TIME_STAMP_COUNTER);
+            counters->c0_after[number] = rdmsr64(MSR_IA32_MPERF);
+
+            for (UInt8 index = 1; index < kCPUSensorsCoreCStates; index++) {
+                if (bit_get(counters->core_cstates, BIT(index))) {
+                    counters->core_cstate_before[number][index] = counters->core_cstate_after[number][index];
+                    counters->core_cstate_after[number][index] = rdmsr64(cpu_core_cstate_msrs[index]);
+                }
+            }
+        }
+
+        if (number == 0 && bit_get(counters->event_flags, kCPUSensorsResidencyPackage)) {
+            counters->package_tsc_before = counters->package_tsc_after;
+            counters->package_tsc_after = rdmsr64(MSR_IA32_TIME_STAMP_COUNTER);
+
+            for (UInt8 index = 0; index < kCPUSensorsPackageCStates; index++) {
+                if (bit_get(counters->package_cstates, BIT(index))) {
+                    counters->package_cstate_before[index] = counters->package_cstate_after[index];
+                    counters->package_cstate_after[index] = rdmsr64(cpu_package_cstate_msrs[index]);
+                }
+            }
+        }
+
         // Energy counters
         if (number == 0) {
-            for (UInt8 index = 0; index < 4; index++) {
+            for (UInt8 index = 0; index < kCPUSensorsRaplDomains; index++) {
                 if (bit_get(counters->event_flags, cpu_energy_flgs[index])) {
                     counters->energy_before[index] = counters->energy_after[index];
-                    counters->energy_after[index] = rdmsr64(cpu_energy_msrs[index]);
+                    counters->energy_after[index] = rdmsr64(cpu_energy_msrs[index]) & 0xFFFFFFFF;
                 }
             }
+
+            if (bit_get(counters->event_flags, kCPUSensorsPowerLimit)) {
+                counters->power_limit = rdmsr64(MSR_PKG_POWER_LIMIT);
+            }
+
+            if (bit_get(counters->event_flags, kCPUSensorsPowerThrottle)) {
+                counters->throttle_before = counters->throttle_after;
+                counters->throttle_after = rdmsr64(MSR_PKG_PERF_STATUS) & 0xFFFFFFFF;
+            }
         }
     }
 }
@@ -302,11 +443,16 @@ void CPUSensors::calculateTimedCounters()
         }
     }
 
-    if (bit_get(counters.event_flags, kCPUSensorsFrequencyCore | kCPUSensorsFrequencyPackage)) {
+    if (bit_get(counters.event_flags, kCPUSensorsFrequencyAll)) {
         for (UInt8 index = 0; index < coreCount; index++) {
-            if (baseMultiplier > 0) {
-                UInt64 thread_clocks = counters.utc_after[index] < counters.utc_before[index] ? UINT64_MAX - counters.utc_before[index] + counters.utc_after[index] : counters.utc_after[index] - counters.utc_before[index];
-                UInt64 ref_clocks = counters.urc_after[index] < counters.urc_before[index] ? UINT64_MAX - counters.urc_before[index] + counters.urc_after[index] : counters.urc_after[index] - counters.urc_before[index];
+            if (baseMultiplier > 0 && counters.update_fixed_counters) {
+                if (counters.fixed_rearmed[index]) {
+                    HWSensorsDebugLog("fixed counters on core %d were reprogrammed by another agent, re-armed", index);
+                    continue;
+                }
+
+                UInt64 thread_clocks = get_counter_delta(counters.utc_before[index], counters.utc_after[index]) & fixedCountersMask;
+                UInt64 ref_clocks = get_counter_delta(counters.urc_before[index], counters.urc_after[index]) & fixedCountersMask;
 
                 if (ref_clocks) {
                     turbo[index] = (double)thread_clocks / (double)ref_clocks;
@@ -318,14 +464,64 @@ void CPUSensors::calculateTimedCounters()
         }
     }
 
-    if (timerEventDeltaTime && timerEventDeltaTime < 10.0f && bit_get(counters.event_flags, kCPUSensorsPowerTotal | kCPUSensorsPowerCores | kCPUSensorsPowerUncore | kCPUSensorsPowerDram)) {
-        for (UInt8 index = 0; index < 4; index++) {
+    if (timerEventDeltaTime && timerEventDeltaTime < 10.0f && bit_get(counters.event_flags, kCPUSensorsPowerDomains)) {
+        for (UInt8 index = 0; index < kCPUSensorsRaplDomains; index++) {
 
-            UInt64 deltaEnergy = counters.energy_after[index] < counters.energy_before[index] ? UINT64_MAX - counters.energy_before[index] + counters.energy_after[index] : counters.energy_after[index] - counters.energy_before[index];
+            energy[index] = get_rapl_energy_rate(counters.energy_before[index], counters.energy_after[index], timerEventDeltaTime);
+        }
+    }
 
-            energy[index] = (double)deltaEnergy / timerEventDeltaTime;
+    if (bit_get(counters.event_flags, kCPUSensorsPowerLimit)) {
+        powerLimit[0] = get_rapl_power_limit(counters.power_limit, 0, powerUnits);
+        powerLimit[1] = get_rapl_power_limit(counters.power_limit, 1, powerUnits);
+    }
+
+    if (timerEventDeltaTime && timerEventDeltaTime < 10.0f && bit_get(counters.event_flags, kCPUSensorsPowerThrottle)) {
+        throttle = get_rapl_throttle_percent(counters.throttle_before, counters.throttle_after, timeUnits, timerEventDeltaTime);
+    }
+
+    if (bit_get(counters.event_flags, kCPUSensorsResidencyCore)) {
+        for (UInt8 index = 0; index < coreCount; index++) {
+            UInt64 deltas[kCPUSensorsCoreCStates];
+
+            for (UInt8 state = 1; state < kCPUSensorsCoreCStates; state++)
+                deltas[state] = get_counter_delta(counters.core_cstate_before[index][state], counters.core_cstate_after[index][state]);
+
+            get_core_residency(get_counter_delta(counters.tsc_before[index], counters.tsc_after[index]),
+                               get_counter_delta(counters.c0_before[index], counters.c0_after[index]),
+                               deltas, counters.core_cstates, kCPUSensorsCoreCStates, coreResidency[index]);
         }
     }
+
+    if (bit_get(counters.event_flags, kCPUSensorsResidencyPackage)) {
+        UInt64 tsc = get_counter_delta(counters.package_tsc_before, counters.package_tsc_after);
+
+        for (UInt8 index = 0; index < kCPUSensorsPackageCStates; index++) {
+            if (bit_get(counters.package_cstates, BIT(index))) {
+                packageResidency[index] = get_residency_percent(get_counter_delta(counters.package_cstate_before[index], counters.package_cstate_after[index]), tsc);
+            }
+        }
+    }
+}
+
+bool CPUSensors::thermalThresholdsCrossed(double time)
+{
+    if (time - thermalLastRefresh >= thermalFallbackInterval)
+        return true;
+
+    // Package threshold #1/#2 log bits are sticky, any core crossing the band sets them
+    return rdmsr64(MSR_IA32_PACKAGE_THERM_STATUS) & (BIT(7) | BIT(9));
+}
+
+void CPUSensors::programThermalThresholds(double time)
+{
+    // Interrupt enable bits are left as they are, only the log bits are polled
+    wrmsr64(MSR_IA32_PACKAGE_THERM_INTERRUPT, get_thermal_thresholds(rdmsr64(MSR_IA32_PACKAGE_THERM_INTERRUPT), counters.thermal_status_package, kCPUSensorsThermalThresholdBand));
+
+    // Log bits are cleared by writing zero, write ones to the other log bits to keep them
+    wrmsr64(MSR_IA32_PACKAGE_THERM_STATUS, rdmsr64(MSR_IA32_PACKAGE_THERM_STATUS) & kCPUSensorsThermalLogs & ~kCPUSensorsThresholdLogs);
+
+    thermalLastRefresh = time;
 }
 
 IOReturn CPUSensors::timerEventAction()
@@ -337,9 +533,20 @@ IOReturn CPUSensors::timerEventAction()
         timerEventDeltaTime =  time - timerEventLastTime;
         timerEventLastTime = time;
 
-        mp_rendezvous_no_intrs(update_counters, &counters);
+        counters.thermal_refresh = !thermalThresholds || thermalThresholdsCrossed(time);
+
+        // When the rendezvous runs for other counters each core checks its own threshold logs. With nothing
+        // but temperatures sampled it only runs once the package leaves its band or the fallback expires
+        // (throttle logs are sticky and will be collected on the next pass)
+        if (counters.thermal_refresh || bit_get(counters.event_flags, ~(kCPUSensorsThermalAll | kCPUSensorsEventsAll))) {
+            mp_rendezvous_no_intrs(update_counters, &counters);
 
-        calculateTimedCounters();
+            calculateTimedCounters();
+        }
+
+        if (thermalThresholds && counters.thermal_refresh) {
+            programThermalThresholds(time);
+        }
 
         if (timerEventDeltaTime == 0 || timerEventDeltaTime > 10.0f) {
             timerEventScheduled = timerEventSource->setTimeoutMS(500) == kIOReturnSuccess ? true : false;
@@ -407,9 +614,34 @@ bool CPUSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
         case kCPUSensorsPowerCores:
         case kCPUSensorsPowerUncore:
         case kCPUSensorsPowerDram:
+        case kCPUSensorsPowerPlatform:
             *outValue = energyUnits * energy[index];
             break;
 
+        case kCPUSensorsPowerLimit:
+            *outValue = powerLimit[index];
+            break;
+
+        case kCPUSensorsPowerThrottle:
+            *outValue = throttle;
+            break;
+
+        case kCPUSensorsResidencyCore:
+            *outValue = coreResidency[index >> 4][index & 0xF];
+            break;
+
+        case kCPUSensorsResidencyPackage:
+            *outValue = packageResidency[index];
+            break;
+
+        case kCPUSensorsEventsCore:
+            *outValue = counters.throttle_events[index >> 4][index & 0xF];
+            break;
+
+        case kCPUSensorsEventsPackage:
+            *outValue = counters.throttle_events_package[index];
+            break;
+
         default:
             return false;
             
@@ -485,6 +717,14 @@ bool CPUSensors::start(IOService *provider)
             }
         }
         
+        if (OSBoolean* enabled = OSDynamicCast(OSBoolean, configuration->getObject("ThermalThresholds"))) {
+            thermalThresholds = enabled->isTrue();
+        }
+
+        if (OSNumber* number = OSDynamicCast(OSNumber, configuration->getObject("ThermalFallbackInterval"))) {
+            thermalFallbackInterval = number->unsigned32BitValue();
+        }
+
         if (OSString* string = OSDynamicCast(OSString, configuration->getObject("PlatformString"))) {
             // User defined platform key (RPlt)
             if (string->getLength() > 0) {
@@ -705,6 +945,7 @@ bool CPUSensors::start(IOService *provider)
     HWSensorsDebugLog("adding digital thermal sensors at core level");
 
     bit_set(counters.event_flags, kCPUSensorsThermalCore);
+    counters.thermal_refresh = true;
     mp_rendezvous_no_intrs(update_counters, &counters);
                            
     for (uint32_t i = 0; i < kCPUSensorsMaxCpus; i++) {
@@ -740,8 +981,67 @@ bool CPUSensors::start(IOService *provider)
                 if (!addSensor(KEY_CPU_PACKAGE_TEMPERATURE, SMC_TYPE_SP78, SMC_TYPE_SPXX_SIZE, kCPUSensorsThermalPackage, 0))
                     HWSensorsWarningLog("failed to add cpu package temperature sensor");
             }
+
+            if ((uint32_t)bitfield32(cpuid_reg[eax], 6, 6)) {
+                for (UInt8 event = 0; event < kCPUSensorsThrottleEvents; event++) {
+                    // Power limit notification log is only valid with PLN
+                    if (event == kCPUSensorsThrottleEvents - 1 && !(uint32_t)bitfield32(cpuid_reg[eax], 4, 4))
+                        continue;
+
+                    char key[5];
+
+                    snprintf(key, 5, KEY_FAKESMC_FORMAT_CPU_PACKAGE_EVENTS, cpu_throttle_event_names[event]);
+
+                    if (!addSensor(key, SMC_TYPE_UI32, SMC_TYPE_UI32_SIZE, kCPUSensorsEventsPackage, event))
+                        HWSensorsWarningLog("failed to add cpu package throttle event sensor");
+                }
+            }
+
+            // Package thermal thresholds need package thermal management (PTM) and the package readout
+            if (thermalThresholds && !((uint32_t)bitfield32(cpuid_reg[eax], 6, 6) && bit_get(counters.event_flags, kCPUSensorsThermalPackage))) {
+                HWSensorsWarningLog("package thermal thresholds are not supported, polling temperatures");
+                thermalThresholds = false;
+            }
             break;
         }
+
+        default:
+            thermalThresholds = false;
+            break;
+    }
+
+    if (thermalThresholds) {
+        if (thermalFallbackInterval < 1)
+            thermalFallbackInterval = 10;
+
+        HWSensorsInfoLog("temperatures are refreshed on core and package threshold crossings or every %d seconds", (int)thermalFallbackInterval);
+    }
+
+    counters.thermal_thresholds = thermalThresholds;
+
+    HWSensorsDebugLog("adding throttle event counters at core level");
+
+    if (coreCount) {
+        uint32_t cpuid_reg[4];
+
+        do_cpuid(6, cpuid_reg);
+
+        // Thermal, PROCHOT and critical temperature logs are architectural, power limit log needs PLN
+        UInt8 events = (uint32_t)bitfield32(cpuid_reg[eax], 4, 4) ? kCPUSensorsThrottleEvents : kCPUSensorsThrottleEvents - 1;
+
+        if (coreCount > kCPUSensorsMaxKeyCores)
+            HWSensorsInfoLog("core throttle event counters are limited to the first %d cores", kCPUSensorsMaxKeyCores);
+
+        for (UInt8 i = 0; i < coreCount && i < kCPUSensorsMaxKeyCores; i++) {
+            for (UInt8 event = 0; event < events; event++) {
+                char key[5];
+
+                snprintf(key, 5, KEY_FAKESMC_FORMAT_CPU_CORE_EVENTS, i, cpu_throttle_event_names[event]);
+
+                if (!addSensor(key, SMC_TYPE_UI32, SMC_TYPE_UI32_SIZE, kCPUSensorsEventsCore, (i << 4) | event))
+                    HWSensorsWarningLog("failed to add throttle event sensor");
+            }
+        }
     }
 
     HWSensorsDebugLog("adding multiplier & frequency sensors");
@@ -791,11 +1091,25 @@ bool CPUSensors::start(IOService *provider)
             break;
     }
 
-    HWSensorsDebugLog("adding average frequency sensor");
+    HWSensorsDebugLog("adding average frequency sensors");
+
+    if (baseMultiplier && pmu_fixed_counters_supported()) {
+        counters.update_fixed_counters = true;
+        fixedCountersMask = pmu_fixed_counters_mask();
+
+        mp_rendezvous_no_intrs(init_cpu_turbo_counters, NULL);
 
-    if (baseMultiplier) {
         if (!addSensor(KEY_FAKESMC_CPU_PACKAGE_FREQUENCY_AVERAGE, SMC_TYPE_UI32, SMC_TYPE_UI32_SIZE, kCPUSensorsFrequencyPackageAverage, 0))
-        HWSensorsWarningLog("failed to add package average frequency sensor");
+            HWSensorsWarningLog("failed to add package average frequency sensor");
+
+        for (UInt8 i = 0; i < coreCount && i < kCPUSensorsMaxKeyCores; i++) {
+            char key[5];
+
+            snprintf(key, 5, KEY_FAKESMC_FORMAT_CPU_FREQUENCY_AVERAGE, i);
+
+            if (!addSensor(key, SMC_TYPE_UI32, SMC_TYPE_UI32_SIZE, kCPUSensorsFrequencyCoreAverage, i))
+                HWSensorsWarningLog("failed to add average frequency sensor");
+        }
     }
 
     HWSensorsDebugLog("adding voltage sensor");
@@ -826,13 +1140,16 @@ bool CPUSensors::start(IOService *provider)
         {
             mp_rendezvous_no_intrs(read_cpu_rapl, NULL);
 
-            UInt8 power_units = cpu_rapl & 0xf;
-            UInt8 energy_units = (cpu_rapl >> 8) & 0x1f;
-            UInt8 time_units = (cpu_rapl >> 16) & 0xf;
+            UInt8 power_units = get_rapl_power_units(cpu_rapl);
+            UInt8 energy_units = get_rapl_energy_units(cpu_rapl);
+            UInt8 time_units = get_rapl_time_units(cpu_rapl);
             
             HWSensorsDebugLog("RAPL units power: 0x%x energy: 0x%x time: 0x%x", power_units, energy_units, time_units);
+
+            powerUnits = get_rapl_unit_scale(power_units);
+            timeUnits = get_rapl_unit_scale(time_units);
             
-            if (energy_units && (energyUnits = 1.0f / (float)(1 << energy_units))) {
+            if (energy_units && (energyUnits = get_rapl_unit_scale(energy_units))) {
                 if (!addSensor(KEY_CPU_PACKAGE_TOTAL_POWER, SMC_TYPE_SP78, SMC_TYPE_SPXX_SIZE, kCPUSensorsPowerTotal, 0))
                     HWSensorsWarningLog("failed to add CPU package total power sensor");
                 
@@ -873,11 +1190,133 @@ bool CPUSensors::start(IOService *provider)
                     default:
                         break;
                 }
+
+                // PSYS domain is only present on Skylake and later client parts, and reads zero when the platform does not report it.
+                // Skylake-X shares the Skylake family but faults on MSR_PLATFORM_ENERGY_STATUS, so match models here
+                switch (cpuid_info()->cpuid_model) {
+                    case CPUID_MODEL_SKYLAKE_LT:
+                    case CPUID_MODEL_SKYLAKE_DT:
+                    case CPUID_MODEL_KABYLAKE_U:
+                    case CPUID_MODEL_KABYLAKE_S:
+                        if (rdmsr64(MSR_PLATFORM_ENERGY_STATUS) & 0xFFFFFFFF) {
+                            if (!addSensor(KEY_CPU_PACKAGE_PLATFORM_POWER, SMC_TYPE_SP78, SMC_TYPE_SPXX_SIZE, kCPUSensorsPowerPlatform, 4))
+                                HWSensorsWarningLog("failed to add CPU platform power sensor");
+                        }
+                        break;
+
+                    default:
+                        break;
+                }
+            }
+
+            if (power_units) {
+                for (UInt8 i = 0; i < 2; i++) {
+                    char key[5];
+
+                    snprintf(key, 5, KEY_FAKESMC_FORMAT_CPU_POWER_LIMIT, i + 1);
+
+                    if (!addSensor(key, SMC_TYPE_SP78, SMC_TYPE_SPXX_SIZE, kCPUSensorsPowerLimit, i))
+                        HWSensorsWarningLog("failed to add CPU package power limit sensor");
+                }
+            }
+
+            // PKG_PERF_STATUS is only implemented on server parts, reading it elsewhere faults
+            if (time_units) {
+                switch (cpuid_info()->cpuid_model) {
+                    case CPUID_MODEL_JAKETOWN:
+                    case CPUID_MODEL_IVYBRIDGE_EP:
+                    case CPUID_MODEL_HASWELL_MB:
+                    case CPUID_MODEL_BROADWELL_MB:
+                    case CPUID_MODEL_SKYLAKE_X:
+                        if (!addSensor(KEY_FAKESMC_CPU_PACKAGE_THROTTLE, SMC_TYPE_FP88, SMC_TYPE_FPXX_SIZE, kCPUSensorsPowerThrottle, 0))
+                            HWSensorsWarningLog("failed to add CPU package throttle sensor");
+                        break;
+
+                    default:
+                        break;
+                }
             }
             break;
         }
             
     }
+
+    HWSensorsDebugLog("adding C-state residency sensors");
+
+    switch (cpuid_info()->cpuid_cpufamily) {
+        case CPUFAMILY_INTEL_NEHALEM:
+        case CPUFAMILY_INTEL_WESTMERE:
+            counters.core_cstates = BIT(0) | BIT(1) | BIT(2);
+            counters.package_cstates = BIT(1) | BIT(2);
+            break;
+
+        case CPUFAMILY_INTEL_SANDYBRIDGE:
+        case CPUFAMILY_INTEL_IVYBRIDGE:
+        case CPUFAMILY_INTEL_HASWELL:
+        case CPUFAMILY_INTEL_BROADWELL:
+        case CPUFAMILY_INTEL_SKYLAKE:
+        case CPUFAMILY_INTEL_KABYLAKE:
+            // Skylake-X shares the Skylake family but has no C3/C7 and PC3/PC7 residency
+            // counters, reading them faults inside the rendezvous, so match models here
+            switch (cpuid_info()->cpuid_model) {
+                case CPUID_MODEL_SKYLAKE_X:
+                    counters.core_cstates = BIT(0) | BIT(2);
+                    counters.package_cstates = BIT(0) | BIT(2);
+                    break;
+
+                default:
+                    counters.core_cstates = BIT(0) | BIT(1) | BIT(2) | BIT(3);
+                    counters.package_cstates = BIT(0) | BIT(1) | BIT(2) | BIT(3);
+                    break;
+            }
+
+            // PC8-PC10 are only implemented on low power parts
+            switch (cpuid_info()->cpuid_model) {
+                case CPUID_MODEL_HASWELL_ULT:
+                case CPUID_MODEL_HASWELL_ULX:
+                case CPUID_MODEL_BROADWELL_ULV:
+                case CPUID_MODEL_SKYLAKE_LT:
+                case CPUID_MODEL_SKYLAKE_DT:
+                case CPUID_MODEL_KABYLAKE_U:
+                case CPUID_MODEL_KABYLAKE_S:
+                    counters.package_cstates |= BIT(4) | BIT(5) | BIT(6);
+                    break;
+
+                default:
+                    break;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (coreCount > kCPUSensorsMaxKeyCores)
+        HWSensorsInfoLog("core residency sensors are limited to the first %d cores", kCPUSensorsMaxKeyCores);
+
+    for (UInt8 i = 0; i < coreCount && i < kCPUSensorsMaxKeyCores; i++) {
+        for (UInt8 state = 0; state < kCPUSensorsCoreCStates; state++) {
+            if (bit_get(counters.core_cstates, BIT(state))) {
+                char key[5];
+
+                snprintf(key, 5, KEY_FAKESMC_FORMAT_CPU_CORE_RESIDENCY, i, cpu_core_cstate_numbers[state]);
+
+                if (!addSensor(key, SMC_TYPE_FP88, SMC_TYPE_FPXX_SIZE, kCPUSensorsResidencyCore, (i << 4) | state))
+                    HWSensorsWarningLog("failed to add core C%d residency sensor", cpu_core_cstate_numbers[state]);
+            }
+        }
+    }
+
+    for (UInt8 state = 0; state < kCPUSensorsPackageCStates; state++) {
+        if (bit_get(counters.package_cstates, BIT(state))) {
+            char key[5];
+
+            snprintf(key, 5, KEY_FAKESMC_FORMAT_CPU_PACKAGE_RESIDENCY, cpu_package_cstate_numbers[state]);
+
+            if (!addSensor(key, SMC_TYPE_FP88, SMC_TYPE_FPXX_SIZE, kCPUSensorsResidencyPackage, state))
+                HWSensorsWarningLog("failed to add package C%d residency sensor", cpu_package_cstate_numbers[state]);
+        }
+    }
     
     // two power states - off and on
 	static const IOPMPowerState powerStates[2] = {
@@ -911,7 +1350,7 @@ IOReturn CPUSensors::setPowerState(unsigned long powerState, IOService *device)
 
         case 1: // Power On
                 //timerEventSource->setTimeoutMS(1000);
-            if (baseMultiplier > 0) {
+            if (counters.update_fixed_counters) {
                 mp_rendezvous_no_intrs(init_cpu_turbo_counters, &magic);
             }
             break;
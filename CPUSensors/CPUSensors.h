@@ -56,14 +56,36 @@
 
 
 #define MSR_IA32_THERM_STS                  0x019C
+#ifndef MSR_IA32_THERM_INTERRUPT
+#define MSR_IA32_THERM_INTERRUPT            0x019B
+#endif
 #define MSR_IA32_TEMP_TARGET                0x01A2
 #define MSR_IA32_PERF_STATUS                0x0198
 
+#ifndef MSR_IA32_PACKAGE_THERM_INTERRUPT
+#define MSR_IA32_PACKAGE_THERM_INTERRUPT    0x01B2
+#endif
+
 #define MSR_RAPL_POWER_UNIT                 0x606
 #define MSR_PKG_ENERY_STATUS                0x611
 #define MSR_DRAM_ENERGY_STATUS              0x619
 #define MSR_PP0_ENERY_STATUS                0x639
 #define MSR_PP1_ENERY_STATUS                0x641
+#define MSR_PLATFORM_ENERGY_STATUS          0x64D
+#define MSR_PKG_POWER_LIMIT                 0x610
+#define MSR_PKG_PERF_STATUS                 0x613
+
+#define MSR_CORE_C3_RESIDENCY               0x3FC
+#define MSR_CORE_C6_RESIDENCY               0x3FD
+#define MSR_CORE_C7_RESIDENCY               0x3FE
+
+#define MSR_PKG_C2_RESIDENCY                0x60D
+#define MSR_PKG_C3_RESIDENCY                0x3F8
+#define MSR_PKG_C6_RESIDENCY                0x3F9
+#define MSR_PKG_C7_RESIDENCY                0x3FA
+#define MSR_PKG_C8_RESIDENCY                0x630
+#define MSR_PKG_C9_RESIDENCY                0x631
+#define MSR_PKG_C10_RESIDENCY               0x632
 
 #ifndef MSR_IA32_APERF
 #define MSR_IA32_APERF                      0x0E8
@@ -78,19 +100,35 @@
 #define MSR_IA32_TIME_STAMP_COUNTER         0x10
 
 #define kCPUSensorsMaxCpus                  32
+#define kCPUSensorsMaxKeyCores              16  // per-core keys encode the core as one hex digit
+
+#define kCPUSensorsThrottleEvents           4   // thermal, PROCHOT, critical temperature, power limit
+
+#define kCPUSensorsThermalThresholdBand     2   // degrees around the current package reading
+
+#define kCPUSensorsRaplDomains              5   // PKG, PP0, PP1, DRAM, PSYS
+
+#define kCPUSensorsCoreCStates              4   // C1 (derived), C3, C6, C7
+#define kCPUSensorsPackageCStates           7   // PC2, PC3, PC6, PC7, PC8, PC9, PC10
 
 extern "C" int cpu_number(void);
 extern "C" void mp_rendezvous_no_intrs(void (*action_func)(void *), void * arg);
 
 struct CPUSensorsCounters {
-    UInt16  event_flags;
+    UInt32  event_flags;
 
     UInt8   thermal_status[kCPUSensorsMaxCpus];
     UInt8   thermal_status_package;
+    bool    thermal_refresh;
+    bool    thermal_thresholds;
+
+    UInt32  throttle_events[kCPUSensorsMaxCpus][kCPUSensorsThrottleEvents];
+    UInt32  throttle_events_package[kCPUSensorsThrottleEvents];
 
     UInt16  perf_status[kCPUSensorsMaxCpus];
 
     bool    update_perf_counters;
+    bool    update_fixed_counters;
 
     UInt64  aperf_before[kCPUSensorsMaxCpus];
     UInt64  aperf_after[kCPUSensorsMaxCpus];
@@ -101,9 +139,30 @@ struct CPUSensorsCounters {
     UInt64  utc_after[kCPUSensorsMaxCpus];
     UInt64  urc_before[kCPUSensorsMaxCpus];
     UInt64  urc_after[kCPUSensorsMaxCpus];
-
-    UInt64  energy_before[4];
-    UInt64  energy_after[4];
+    bool    fixed_rearmed[kCPUSensorsMaxCpus];
+
+    // RAPL status registers are 32 bits wide
+    UInt32  energy_before[kCPUSensorsRaplDomains];
+    UInt32  energy_after[kCPUSensorsRaplDomains];
+
+    UInt64  power_limit;
+    UInt32  throttle_before;
+    UInt32  throttle_after;
+
+    UInt8   core_cstates;
+    UInt8   package_cstates;
+
+    UInt64  tsc_before[kCPUSensorsMaxCpus];
+    UInt64  tsc_after[kCPUSensorsMaxCpus];
+    UInt64  c0_before[kCPUSensorsMaxCpus];
+    UInt64  c0_after[kCPUSensorsMaxCpus];
+    UInt64  core_cstate_before[kCPUSensorsMaxCpus][kCPUSensorsCoreCStates];
+    UInt64  core_cstate_after[kCPUSensorsMaxCpus][kCPUSensorsCoreCStates];
+
+    UInt64  package_tsc_before;
+    UInt64  package_tsc_after;
+    UInt64  package_cstate_before[kCPUSensorsPackageCStates];
+    UInt64  package_cstate_after[kCPUSensorsPackageCStates];
 };
 
 class EXPORT CPUSensors : public FakeSMCPlugin
@@ -117,13 +176,20 @@ private:
     UInt64                  busClock;
     UInt8                   baseMultiplier;
     float                   energyUnits;
+    float                   powerUnits;
+    float                   timeUnits;
     UInt8                   coreCount;
 
     float                   multiplier[kCPUSensorsMaxCpus];
     float                   voltage[kCPUSensorsMaxCpus];
     float                   ratio[kCPUSensorsMaxCpus];
     float                   turbo[kCPUSensorsMaxCpus];
+    UInt64                  fixedCountersMask;
     float                   energy[kCPUSensorsMaxCpus];
+    float                   powerLimit[2];
+    float                   throttle;
+    float                   coreResidency[kCPUSensorsMaxCpus][kCPUSensorsCoreCStates];
+    float                   packageResidency[kCPUSensorsPackageCStates];
 
 
     IOTimerEventSource*     timerEventSource;
@@ -132,6 +198,12 @@ private:
     double                  timerEventDeltaTime;
     bool                    timerEventScheduled;
 
+    bool                    thermalThresholds;
+    double                  thermalFallbackInterval;
+    double                  thermalLastRefresh;
+    bool                    thermalThresholdsCrossed(double time);
+    void                    programThermalThresholds(double time);
+
     void                    calculateMultiplier(UInt32 index);
     void                    calculateVoltage(UInt32 index);
     void                    calculateTimedCounters();
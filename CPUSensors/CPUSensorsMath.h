@@ -0,0 +1,117 @@
+//
+//  CPUSensorsMath.h
+//  HWSensors
+//
+//  Counter arithmetic used by CPUSensors. Kept free of IOKit so the same
+//  code is exercised by the host tests in HWSensorsTests.
+//
+
+#ifndef HWSensors_CPUSensorsMath_h
+#define HWSensors_CPUSensorsMath_h
+
+#include <libkern/OSTypes.h>
+
+// Free running counters, unsigned subtraction handles the wrap (mask the result for narrower counters)
+inline UInt64 get_counter_delta(UInt64 before, UInt64 after)
+{
+    return after - before;
+}
+
+// RAPL energy and throttle status counters are only 32 bits wide
+inline UInt32 get_counter_delta32(UInt32 before, UInt32 after)
+{
+    return after - before;
+}
+
+inline float get_residency_percent(UInt64 delta, UInt64 reference)
+{
+    if (!reference)
+        return 0;
+
+    float percent = 100.0f * (float)delta / (float)reference;
+
+    return percent > 100.0f ? 100.0f : percent;
+}
+
+// Core C-state residencies over one sampling interval. State 0 is C1, which has no counter:
+// whatever idle time (TSC minus unhalted C0 clocks) is not accounted by the deeper states
+// selected in mask was spent there. Returns false if the TSC did not advance.
+inline bool get_core_residency(UInt64 tsc, UInt64 c0, const UInt64 *deltas, UInt32 mask, UInt8 states, float *residency)
+{
+    if (!tsc)
+        return false;
+
+    float idle = 100.0f - get_residency_percent(c0, tsc);
+
+    for (UInt8 state = 1; state < states; state++) {
+        if (mask & (1U << state)) {
+            residency[state] = get_residency_percent(deltas[state], tsc);
+            idle -= residency[state];
+        }
+    }
+
+    residency[0] = idle > 0 ? idle : 0;
+
+    return true;
+}
+
+// MSR_RAPL_POWER_UNIT holds each unit as an exponent n of 1/2^n: power in bits 3:0 (W),
+// energy in bits 12:8 (J), time in bits 19:16 (s)
+inline UInt8 get_rapl_power_units(UInt64 units)
+{
+    return units & 0xF;
+}
+
+inline UInt8 get_rapl_energy_units(UInt64 units)
+{
+    return (units >> 8) & 0x1F;
+}
+
+inline UInt8 get_rapl_time_units(UInt64 units)
+{
+    return (units >> 16) & 0xF;
+}
+
+inline float get_rapl_unit_scale(UInt8 exponent)
+{
+    return 1.0f / (float)(1U << exponent);
+}
+
+// MSR_PKG_POWER_LIMIT: PL1 in bits 14:0 enabled by bit 15, PL2 in bits 46:32 enabled by bit 47.
+// A disabled limit reads as zero
+inline float get_rapl_power_limit(UInt64 limits, UInt8 limit, float powerUnits)
+{
+    UInt32 value = (UInt32)(limits >> (limit ? 32 : 0));
+
+    return (value & 0x8000) ? powerUnits * (float)(value & 0x7FFF) : 0;
+}
+
+// Energy status counters in energy units per second, the 32 bit counter may wrap once per interval
+inline double get_rapl_energy_rate(UInt32 before, UInt32 after, double interval)
+{
+    return interval > 0 ? (double)get_counter_delta32(before, after) / interval : 0;
+}
+
+// MSR_PKG_PERF_STATUS counts time throttled by RAPL in time units
+inline float get_rapl_throttle_percent(UInt32 before, UInt32 after, float timeUnits, double interval)
+{
+    if (interval <= 0)
+        return 0;
+
+    float throttled = 100.0f * timeUnits * (float)get_counter_delta32(before, after) / interval;
+
+    return throttled > 100.0f ? 100.0f : throttled;
+}
+
+// IA32_THERM_INTERRUPT and IA32_PACKAGE_THERM_INTERRUPT hold threshold #1 in bits 14:8 and #2 in bits 22:16,
+// in the digital readout encoding (degrees below Tjmax). Places them band degrees above and below the readout,
+// interrupt enables and the other fields are kept
+inline UInt64 get_thermal_thresholds(UInt64 interrupt, UInt8 readout, UInt8 band)
+{
+    UInt64 hot = readout > band ? readout - band : 0;
+    UInt64 cold = readout + band < 0x7F ? readout + band : 0x7F;
+
+    return (interrupt & ~((0x7FULL << 8) | (0x7FULL << 16))) | (hot << 8) | (cold << 16);
+}
+
+#endif
@@ -59,34 +59,52 @@ struct FixedEventControlRegister
     };
 };
 
-inline void init_cpu_turbo_counters(void *magic)
+// CPUSensors owns fixed counters 1 (unhalted core clocks) and 2 (unhalted reference clocks)
+#define PMU_FIXED_CTR_CTRL_MASK             0xFF0ULL
+#define PMU_FIXED_CTR_CTRL_OWNED            0x330ULL    // CTR1 & CTR2 counting in OS and USR rings, no PMI
+#define PMU_GLOBAL_CTRL_OWNED               ((1ULL << 33) | (1ULL << 34))
+
+inline bool pmu_fixed_counters_supported(void)
+{
+    uint32_t cpuid_reg[4];
+
+    do_cpuid(0xA, cpuid_reg);
+
+    // Architectural PMU version 2 or later with at least 3 fixed counters
+    return (cpuid_reg[eax] & 0xFF) >= 2 && (cpuid_reg[edx] & 0x1F) >= 3;
+}
+
+inline UInt64 pmu_fixed_counters_mask(void)
+{
+    uint32_t cpuid_reg[4];
+
+    do_cpuid(0xA, cpuid_reg);
+
+    UInt8 width = (cpuid_reg[edx] >> 5) & 0xFF;
+
+    return width && width < 64 ? (1ULL << width) - 1 : UINT64_MAX;
+}
+
+inline bool pmu_fixed_counters_armed(void)
+{
+    return (rdmsr64(MSR_IA32_CR_FIXED_CTR_CTRL) & PMU_FIXED_CTR_CTRL_MASK) == PMU_FIXED_CTR_CTRL_OWNED &&
+           (rdmsr64(MSR_IA32_CR_PERF_GLOBAL_CTRL) & PMU_GLOBAL_CTRL_OWNED) == PMU_GLOBAL_CTRL_OWNED;
+}
+
+inline void pmu_arm_fixed_counters(void)
 {
-    //UInt32 number = get_cpu_number();
-    
-    FixedEventControlRegister ctrl_reg;
-    ctrl_reg.value = rdmsr64(MSR_IA32_CR_FIXED_CTR_CTRL);
-    
-    
-    ctrl_reg.fields.os0 = 1;
-    ctrl_reg.fields.usr0 = 1;
-    ctrl_reg.fields.any_thread0 = 0;
-    ctrl_reg.fields.enable_pmi0 = 0;
-    
-    ctrl_reg.fields.os1 = 1;
-    ctrl_reg.fields.usr1 = 1;
-    ctrl_reg.fields.any_thread1 = 0;
-    ctrl_reg.fields.enable_pmi1 = 0;
-    
-    ctrl_reg.fields.os2 = 1;
-    ctrl_reg.fields.usr2 = 1;
-    ctrl_reg.fields.any_thread2 = 0;
-    ctrl_reg.fields.enable_pmi2 = 0;
-    
-    wrmsr64(MSR_IA32_CR_FIXED_CTR_CTRL, ctrl_reg.value);
-    
+    // Only touch the bits of the counters we own, leave whatever else is programmed intact
+    UInt64 ctrl = rdmsr64(MSR_IA32_CR_FIXED_CTR_CTRL);
+
+    wrmsr64(MSR_IA32_CR_FIXED_CTR_CTRL, (ctrl & ~PMU_FIXED_CTR_CTRL_MASK) | PMU_FIXED_CTR_CTRL_OWNED);
+
     // start counting
-    UInt64 value = (1ULL << 0) + (1ULL << 1) + (1ULL << 2) + (1ULL << 3) + (1ULL << 32) + (1ULL << 33) + (1ULL << 34);
-    wrmsr64(MSR_IA32_CR_PERF_GLOBAL_CTRL, value);
+    wrmsr64(MSR_IA32_CR_PERF_GLOBAL_CTRL, rdmsr64(MSR_IA32_CR_PERF_GLOBAL_CTRL) | PMU_GLOBAL_CTRL_OWNED);
+}
+
+inline void init_cpu_turbo_counters(void *magic)
+{
+    pmu_arm_fixed_counters();
 }
 
 #endif
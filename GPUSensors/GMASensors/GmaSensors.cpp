@@ -9,6 +9,7 @@
 
 #include "GmaSensors.h"
 #include "smc.h"
+#include "timer.h"
 
 /*#define kGenericPCIDevice "IOPCIDevice"
  #define kTimeoutMSecs 1000
@@ -16,48 +17,47 @@
  #define fDevice "device-id"
  #define kIOPCIConfigBaseAddress0 0x10*/
 #define kMCHBAR	0x48
-#define TSC1	0x1001
-#define TSS1	0x1004
-#define TR1		0x1006
-#define RTR1	0x1008
-#define TIC1	0x100B
-#define TSC2	0x1041
-#define TSS2	0x1044
-#define TR2		0x1046
-#define RTR2	0x1048
-#define TIC2	0x104B
-
-
-#define INVID8(offset) (mmio_base[offset])
-#define INVID16(offset) OSReadLittleInt16((mmio_base), offset)
-#define INVID(offset) OSReadLittleInt32((mmio_base), offset)
-#define OUTVID(offset,val) OSWriteLittleInt32((mmio_base), offset, val)
+
+#define kGmaSensorsTemperatureStale     "temperature-stale"
 
 #define super GPUSensors
 OSDefineMetaClassAndStructors(GmaSensors, GPUSensors)
 
-bool GmaSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
+IOReturn GmaSensors::conversionEvent()
+{
+    if (!mmio_base)
+        return kIOReturnSuccess;
+
+    UInt64 time = ptimer_read();
+
+    // Conversion started before power down is lost
+    if (!acquireMMIO()) {
+        thermal.conversionPending = false;
+        timerEventSource->setTimeoutMS(kGmaSensorsConversionPeriod);
+        return kIOReturnSuccess;
+    }
+
+    if (!gma_thermal_convert(&thermal, mmio_base, time))
+        HWSensorsDebugLog("thermal sensor conversion timed out, restarting");
+
+    releaseMMIO();
+
+    if (gma_thermal_update_stale(&thermal, time))
+        setProperty(kGmaSensorsTemperatureStale, thermal.temperatureStale);
+
+    timerEventSource->setTimeoutMS(kGmaSensorsConversionPeriod);
+
+    return kIOReturnSuccess;
+}
+
+bool GmaSensors::readSensorValue(FakeSMCSensor *sensor, float *outValue)
 {    
     if (sensor->getGroup() == kFakeSMCTemperatureSensor) {
-        short value = 0;
-        
-        if (mmio_base) {
-            
-            OUTVID(TIC1, 3);
-            
-            //		if ((INVID16(TSC1) & (1<<15)) && !(INVID16(TSC1) & (1<<8)))//enabled and ready
-            for (int i=0; i<1000; i++) {  //attempts to ready
-                
-                if (INVID16(TSS1) & (1<<10))   //valid?
-                    break;
-                
-                IOSleep(10);
-            }	
-			
-            value = INVID8(TR1);
-        }				
-        
-        *outValue = (float)(150 - value);
+        // Nothing converted yet, keep the key value
+        if (!thermal.temperatureTime)
+            return false;
+
+        *outValue = thermal.temperature;
     }
     
     return true;
@@ -91,11 +91,30 @@ bool GmaSensors::managedStart(IOService *provider)
         }
     }
 
+    // Conversion timer is set up before the key is published, so a failure leaves no key behind
+    if (!(workloop = getWorkLoop())) {
+        HWSensorsFatalLog("failed to obtain workloop");
+        return false;
+    }
+
+    if (!(timerEventSource = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &GmaSensors::conversionEvent)))) {
+        HWSensorsFatalLog("failed to initialize conversion timer event source");
+        return false;
+    }
+
+    if (kIOReturnSuccess != workloop->addEventSource(timerEventSource)) {
+        HWSensorsFatalLog("failed to add conversion timer event source into workloop");
+        OSSafeReleaseNULL(timerEventSource);
+        return false;
+    }
+
     //Find card number
     gpuIndex = takeVacantGPUIndex();
     
-    if (gpuIndex < 0) {
+    if (gpuIndex == UINT8_MAX) {
         HWSensorsFatalLog("failed to obtain vacant GPU index");
+        workloop->removeEventSource(timerEventSource);
+        OSSafeReleaseNULL(timerEventSource);
         return false;
     }
     
@@ -107,8 +126,16 @@ bool GmaSensors::managedStart(IOService *provider)
         HWSensorsFatalLog("failed to register temperature sensor");
         releaseGPUIndex(gpuIndex);
         gpuIndex = UINT8_MAX;
+        workloop->removeEventSource(timerEventSource);
+        OSSafeReleaseNULL(timerEventSource);
         return false;
     }
+
+    thermal.temperatureStale = true;
+    setProperty(kGmaSensorsTemperatureStale, thermal.temperatureStale);
+
+    // First conversion is started right away
+    conversionEvent();
     
     registerService();
     
@@ -117,6 +144,12 @@ bool GmaSensors::managedStart(IOService *provider)
 
 void GmaSensors::stop(IOService* provider)
 {
+    if (timerEventSource) {
+        timerEventSource->cancelTimeout();
+        workloop->removeEventSource(timerEventSource);
+        OSSafeReleaseNULL(timerEventSource);
+    }
+
     if (gpuIndex < UINT8_MAX)
         releaseGPUIndex(gpuIndex);
     
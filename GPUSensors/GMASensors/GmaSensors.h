@@ -12,6 +12,7 @@
 #include <IOKit/pci/IOPCIDevice.h>
 
 #include "GPUSensors.h"
+#include "GmaThermal.h"
 
 class EXPORT GmaSensors : public GPUSensors
 {
@@ -22,9 +23,15 @@ private:
 	volatile UInt8*     mmio_base;
 	IOMemoryMap *		mmio;
     UInt8               gpuIndex;
+
+    IOWorkLoop*         workloop;
+    IOTimerEventSource* timerEventSource;
+    GmaThermalState     thermal;
+
+    IOReturn            conversionEvent();
 	
 protected:	
-    virtual bool        willReadSensorValue(FakeSMCSensor *sensor, float* result);
+    virtual bool        readSensorValue(FakeSMCSensor *sensor, float* result);
 	virtual bool        managedStart(IOService *provider);
     
 public:
@@ -0,0 +1,87 @@
+//
+//  GmaThermal.h
+//  HWSensors
+//
+//  Two phase readout of the GMA thermal sensor in MCHBAR: a conversion is
+//  started on one timer tick and collected on the next one. Free of IOKit so
+//  the same code runs against the simulated registers in HWSensorsTests.
+//
+
+#ifndef HWSensors_GmaThermal_h
+#define HWSensors_GmaThermal_h
+
+#include <libkern/OSTypes.h>
+#include <libkern/OSByteOrder.h>
+
+#define TSC1	0x1001
+#define TSS1	0x1004
+#define TR1		0x1006
+#define RTR1	0x1008
+#define TIC1	0x100B
+#define TSC2	0x1041
+#define TSS2	0x1044
+#define TR2		0x1046
+#define RTR2	0x1048
+#define TIC2	0x104B
+
+#define GMA_THERMAL_VALID               (1<<10)         // in TSS1
+#define GMA_THERMAL_START               3               // to TIC1
+
+#define kGmaSensorsConversionPeriod     1000            // in milliseconds
+#define kGmaSensorsConversionMaxTicks   10              // conversion is restarted if still not valid
+#define kGmaSensorsStaleTime            5000000000ULL   // 5 s
+
+#define INVID8(offset) (mmio_base[offset])
+#define INVID16(offset) OSReadLittleInt16((mmio_base), offset)
+#define INVID(offset) OSReadLittleInt32((mmio_base), offset)
+#define OUTVID(offset,val) OSWriteLittleInt32((mmio_base), offset, val)
+
+struct GmaThermalState {
+    bool    conversionPending;
+    UInt8   conversionTicks;
+    float   temperature;
+    UInt64  temperatureTime;        // 0 until the first conversion is collected
+    bool    temperatureStale;
+};
+
+// One timer tick with the MMIO accessible: collects the pending conversion and starts the next one.
+// Returns false when the pending conversion timed out and was restarted
+inline bool gma_thermal_convert(GmaThermalState *state, volatile UInt8 *mmio_base, UInt64 time)
+{
+    bool completed = true;
+
+    if (state->conversionPending) {
+        if (INVID16(TSS1) & GMA_THERMAL_VALID) {
+            state->temperature = (float)(150 - INVID8(TR1));
+            state->temperatureTime = time;
+            state->conversionPending = false;
+        }
+        else if (++state->conversionTicks >= kGmaSensorsConversionMaxTicks) {
+            state->conversionPending = false;
+            completed = false;
+        }
+    }
+
+    if (!state->conversionPending) {
+        OUTVID(TIC1, GMA_THERMAL_START);
+        state->conversionPending = true;
+        state->conversionTicks = 0;
+    }
+
+    return completed;
+}
+
+// Updates the stale flag, true when it changed
+inline bool gma_thermal_update_stale(GmaThermalState *state, UInt64 time)
+{
+    bool stale = !state->temperatureTime || time - state->temperatureTime > kGmaSensorsStaleTime;
+
+    if (stale == state->temperatureStale)
+        return false;
+
+    state->temperatureStale = stale;
+
+    return true;
+}
+
+#endif
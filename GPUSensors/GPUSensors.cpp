@@ -29,53 +29,192 @@ workloop->removeEventSource(timer); \
 timer = NULL; \
 }
 
-#define kGPUSensorsAcceleratorWaitCycle     1000.0f
-#define kGPUSensorsAcceleratorDelayTime     5000
+#define kGPUSensorsAcceleratorWaitTimeout   45000   // in milliseconds
+#define kGPUSensorsAcceleratorCheckInterval 1000    // in milliseconds, only for plugins polling loaded flags
+
+#define kGPUSensorsMMIOReadsAvoided         "mmio-reads-avoided"
+#define kGPUSensorsAvoidedReportInterval    16
+
+bool GPUSensors::acceleratorPublished(void *target, void *refCon, IOService *newService, IONotifier *notifier)
+{
+    GPUSensors *self = OSDynamicCast(GPUSensors, (OSObject*)target);
+
+    // Only accelerator attached to our own PCI device is of interest. Timer is
+    // kept until stop() removes this notifier, so it is always valid here
+    if (self && newService && newService->getParentEntry(gIOServicePlane) == self->pciDevice && !self->acceleratorFound) {
+        self->acceleratorFound = true;
+
+        // Start on the workloop, same as timeout does
+        self->timerEventSource->setTimeoutMS(1);
+    }
+
+    return true;
+}
 
 IOReturn GPUSensors::probeEvent()
 {
     HWSensorsDebugLog("Probe event...");
 
-    if (probIsAcceleratorAlreadyLoaded()) {
-        releaseTimerEventSource(timerEventSource);
+    // Notification may fire the timer once more after start
+    if (acceleratorProbed)
+        return kIOReturnSuccess;
 
-        if (!(timerEventSource = IOTimerEventSource::timerEventSource( this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &GPUSensors::delayedStartEvent)))) {
-            HWSensorsFatalLog("failed to initialize delayed startup timer event source");
-            return false;
-        }
+    // Accelerator driver may attach below a nub of its own, not directly to our
+    // PCI device, so its loaded flags are checked too
+    if (!acceleratorFound && probIsAcceleratorAlreadyLoaded())
+        acceleratorFound = true;
 
-        if (kIOReturnSuccess != workloop->addEventSource(timerEventSource))
-        {
-            HWSensorsFatalLog("failed to add delayed startup timer event source into workloop");
-            timerEventSource->release();
-            return false;
-        }
+    // Only plugins polling the flags come back every second, for the others
+    // this is the single kGPUSensorsAcceleratorWaitTimeout timeout
+    if (!acceleratorFound && shouldPollForAccelerator() && (acceleratorWaitTime += kGPUSensorsAcceleratorCheckInterval) < kGPUSensorsAcceleratorWaitTimeout) {
+        timerEventSource->setTimeoutMS(kGPUSensorsAcceleratorCheckInterval);
+        return kIOReturnSuccess;
+    }
 
-        // Wait a little before start
-        timerEventSource->setTimeoutMS(kGPUSensorsAcceleratorDelayTime);
+    acceleratorProbed = true;
+
+    if (acceleratorNotifier) {
+        acceleratorNotifier->remove();
+        acceleratorNotifier = NULL;
     }
-    else if (probeCounter++ == (1000.0f / (kGPUSensorsAcceleratorWaitCycle * 45.0f))) {
-        releaseTimerEventSource(timerEventSource);
-        HWSensorsInfoLog("still waiting for IOAccelerator to start...");
-        onTimeoutExceeded(pciDevice);
+
+    trackAccelerator();
+
+    if (acceleratorFound) {
+        HWSensorsDebugLog("accelerator published, starting...");
+        onAcceleratorFound(pciDevice);
     }
     else {
-//        if (probeCounter > 0 && !(probeCounter % ((int)(1000.0f / (float)kGPUSensorsAcceleratorWaitCycle) * 15)))
-//            HWSensorsInfoLog("still waiting for accelerator to start...");
-
-        timerEventSource->setTimeoutMS(kGPUSensorsAcceleratorWaitCycle);
+        HWSensorsInfoLog("IOAccelerator did not start in time, starting anyway...");
+        onTimeoutExceeded(pciDevice);
     }
     
     return kIOReturnSuccess;
 }
 
-IOReturn GPUSensors::delayedStartEvent()
+/**
+ *  Follow power state of the accelerator attached to our PCI device. Some
+ *  accelerators power the GPU down while PCI device stays in usable state
+ */
+void GPUSensors::trackAccelerator()
 {
-    HWSensorsDebugLog("delayed start...");
+    if (accelerator || !mmioLock)
+        return;
 
-    onAcceleratorFound(pciDevice);
-    releaseTimerEventSource(timerEventSource);
-    return kIOReturnSuccess;
+    OSIterator *iterator = pciDevice->getChildIterator(gIOServicePlane);
+
+    if (!iterator)
+        return;
+
+    while (IORegistryEntry *entry = OSDynamicCast(IORegistryEntry, iterator->getNextObject())) {
+        if (entry->metaCast("IOAccelerator")) {
+            if ((accelerator = OSDynamicCast(IOService, entry)))
+                accelerator->retain();
+            break;
+        }
+    }
+
+    OSSafeReleaseNULL(iterator);
+
+    if (accelerator) {
+        IOPMPowerFlags flags = accelerator->registerInterestedDriver(this);
+
+        IOLockLock(mmioLock);
+        acceleratorPoweredOn = !flags || (flags & (kIOPMDeviceUsable | kIOPMPowerOn));
+        IOLockUnlock(mmioLock);
+
+        HWSensorsDebugLog("tracking %s power state", accelerator->getName());
+    }
+}
+
+void GPUSensors::releaseAccelerator()
+{
+    if (accelerator) {
+        accelerator->deRegisterInterestedDriver(this);
+        OSSafeReleaseNULL(accelerator);
+    }
+}
+
+/**
+ *  Take MMIO access lock, GPU is not powered down until access is released
+ *
+ *  @return False if GPU is powered down, MMIO must not be touched then
+ */
+bool GPUSensors::acquireMMIO()
+{
+    if (!mmioLock)
+        return true;
+
+    IOLockLock(mmioLock);
+
+    if (gpuPoweredOn && acceleratorPoweredOn)
+        return true;
+
+    if (++mmioReadsAvoided % kGPUSensorsAvoidedReportInterval == 0)
+        setProperty(kGPUSensorsMMIOReadsAvoided, mmioReadsAvoided, 32);
+
+    IOLockUnlock(mmioLock);
+
+    return false;
+}
+
+void GPUSensors::releaseMMIO()
+{
+    if (mmioLock)
+        IOLockUnlock(mmioLock);
+}
+
+bool GPUSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
+{
+    // Reading registers would wake GPU from runtime power down or return garbage, keep the key value
+    if (!acquireMMIO())
+        return false;
+
+    bool result = readSensorValue(sensor, outValue);
+
+    releaseMMIO();
+
+    return result;
+}
+
+bool GPUSensors::readSensorValue(FakeSMCSensor *sensor, float *outValue)
+{
+    return false;
+}
+
+IOReturn GPUSensors::powerStateWillChangeTo(IOPMPowerFlags capabilities, unsigned long stateNumber, IOService *whatDevice)
+{
+    if (mmioLock && (whatDevice == pciDevice || (accelerator && whatDevice == accelerator)) && !(capabilities & (kIOPMDeviceUsable | kIOPMPowerOn))) {
+        // Waits for register access in progress
+        IOLockLock(mmioLock);
+        if (whatDevice == pciDevice)
+            gpuPoweredOn = false;
+        else
+            acceleratorPoweredOn = false;
+        IOLockUnlock(mmioLock);
+
+        HWSensorsDebugLog("GPU is powering down, sensors are inactive");
+    }
+
+    return kIOPMAckImplied;
+}
+
+IOReturn GPUSensors::powerStateDidChangeTo(IOPMPowerFlags capabilities, unsigned long stateNumber, IOService *whatDevice)
+{
+    if (mmioLock && (whatDevice == pciDevice || (accelerator && whatDevice == accelerator)) && (capabilities & (kIOPMDeviceUsable | kIOPMPowerOn))) {
+        IOLockLock(mmioLock);
+        if (whatDevice == pciDevice)
+            gpuPoweredOn = true;
+        else
+            acceleratorPoweredOn = true;
+        IOLockUnlock(mmioLock);
+
+        setProperty(kGPUSensorsMMIOReadsAvoided, mmioReadsAvoided, 32);
+
+        HWSensorsDebugLog("GPU is powered on, sensors are active");
+    }
+
+    return kIOPMAckImplied;
 }
 
 bool GPUSensors::shouldWaitForAccelerator()
@@ -85,7 +224,16 @@ bool GPUSensors::shouldWaitForAccelerator()
 
 bool GPUSensors::probIsAcceleratorAlreadyLoaded()
 {
-    return true;
+    return false;
+}
+
+/**
+ *  Loaded flags are checked every kGPUSensorsAcceleratorCheckInterval while waiting,
+ *  only needed when they are set without an accelerator being published for our PCI device
+ */
+bool GPUSensors::shouldPollForAccelerator()
+{
+    return false;
 }
 
 bool GPUSensors::onStartUp(IOService *provider)
@@ -126,10 +274,40 @@ bool GPUSensors::start(IOService *provider)
         return false;
     }
 
+    if (!(mmioLock = IOLockAlloc())) {
+        HWSensorsFatalLog("failed to allocate MMIO lock");
+        return false;
+    }
+
+    // Follow PCI device power state, discrete GPUs are powered down at runtime on hybrid systems
+    IOPMPowerFlags flags = pciDevice->registerInterestedDriver(this);
+
+    gpuPoweredOn = !flags || (flags & (kIOPMDeviceUsable | kIOPMPowerOn));
+    acceleratorPoweredOn = true;
+    mmioReadsAvoided = 0;
+
+    if (!startSensors(provider)) {
+        // stop() is not called for a failed start, nothing may keep calling us back
+        releaseAccelerator();
+        pciDevice->deRegisterInterestedDriver(this);
+        return false;
+    }
+
+    return true;
+}
+
+bool GPUSensors::startSensors(IOService *provider)
+{
     if (!onStartUp(provider))
         return false;
 
     if (shouldWaitForAccelerator()) {
+        // Accelerator was started before us, e.g. plugin was reloaded
+        if (probIsAcceleratorAlreadyLoaded()) {
+            trackAccelerator();
+            return managedStart(provider);
+        }
+
         if (!(workloop = getWorkLoop())) {
             HWSensorsFatalLog("failed to obtain workloop");
             return false;
@@ -146,10 +324,30 @@ bool GPUSensors::start(IOService *provider)
             timerEventSource->release();
             return false;
         }
-        
-        timerEventSource->setTimeoutMS(100);
+
+        acceleratorFound = false;
+        acceleratorProbed = false;
+        acceleratorWaitTime = 0;
+
+        timerEventSource->setTimeoutMS(shouldPollForAccelerator() ? kGPUSensorsAcceleratorCheckInterval : kGPUSensorsAcceleratorWaitTimeout);
+
+        // Delivered for already published accelerators too
+        OSDictionary *matching = serviceMatching("IOAccelerator");
+
+        acceleratorNotifier = addMatchingNotification(gIOFirstPublishNotification, matching, &GPUSensors::acceleratorPublished, this);
+
+        OSSafeReleaseNULL(matching);
+
+        if (!acceleratorNotifier) {
+            HWSensorsFatalLog("failed to install accelerator matching notification");
+            releaseTimerEventSource(timerEventSource);
+            return false;
+        }
+    }
+    else {
+        trackAccelerator();
+        return managedStart(provider);
     }
-    else return managedStart(provider);
     
     return true;
 }
@@ -157,8 +355,28 @@ bool GPUSensors::start(IOService *provider)
 void GPUSensors::stop(IOService *provider)
 {
     HWSensorsDebugLog("Stop...");
+
+    if (acceleratorNotifier) {
+        acceleratorNotifier->remove();
+        acceleratorNotifier = NULL;
+    }
     
     releaseTimerEventSource(timerEventSource);
+
+    releaseAccelerator();
+
+    if (mmioLock)
+        pciDevice->deRegisterInterestedDriver(this);
     
     super::stop(provider);
 }
+
+void GPUSensors::free()
+{
+    if (mmioLock) {
+        IOLockFree(mmioLock);
+        mmioLock = NULL;
+    }
+
+    super::free();
+}
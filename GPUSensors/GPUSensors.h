@@ -19,17 +19,38 @@ class EXPORT GPUSensors : public FakeSMCPlugin
 private:
     IOWorkLoop*             workloop;
     IOTimerEventSource*     timerEventSource;
-    int                     probeCounter;
+    IONotifier*             acceleratorNotifier;
+    bool                    acceleratorFound;
+    bool                    acceleratorProbed;
+    UInt32                  acceleratorWaitTime;
     
     IOReturn                probeEvent();
-    IOReturn                delayedStartEvent();
+    static bool             acceleratorPublished(void *target, void *refCon, IOService *newService, IONotifier *notifier);
+
+    IOLock*                 mmioLock;
+    bool                    gpuPoweredOn;
+    UInt32                  mmioReadsAvoided;
+
+    IOService*              accelerator;
+    bool                    acceleratorPoweredOn;
+
+    void                    trackAccelerator();
+    void                    releaseAccelerator();
+    bool                    startSensors(IOService *provider);
     
 protected:
     IOPCIDevice*            pciDevice;
+
+    bool                    acquireMMIO();
+    void                    releaseMMIO();
+
+    virtual bool            willReadSensorValue(FakeSMCSensor *sensor, float *outValue);
+    virtual bool            readSensorValue(FakeSMCSensor *sensor, float *outValue);
     
     
     virtual bool            shouldWaitForAccelerator();
     virtual bool            probIsAcceleratorAlreadyLoaded();
+    virtual bool            shouldPollForAccelerator();
     virtual bool            onStartUp(IOService *provider);
     virtual void            onAcceleratorFound(IOService *provider);
     virtual void            onTimeoutExceeded(IOService *provider);
@@ -38,6 +59,10 @@ protected:
 public:
     virtual bool            start(IOService *provider);
     virtual void            stop(IOService *provider);
+    virtual void            free(void);
+
+    virtual IOReturn        powerStateWillChangeTo(IOPMPowerFlags capabilities, unsigned long stateNumber, IOService *whatDevice);
+    virtual IOReturn        powerStateDidChangeTo(IOPMPowerFlags capabilities, unsigned long stateNumber, IOService *whatDevice);
 };
 
 #endif /* defined(__HWSensors__GPUSensors__) */
@@ -36,6 +36,9 @@
 #include "nvclock_i2c.h"
 
 #include "smc.h"
+#include "timer.h"
+
+#include <IOKit/IOTimerEventSource.h>
 
 enum nouveau_temp_source {
     nouveau_temp_core       = 1,
@@ -51,6 +54,217 @@ enum nouveau_fan_source {
 #define super GPUSensors
 OSDefineMetaClassAndStructors(GeforceSensors, GPUSensors)
 
+IOReturn GeforceSensors::fanSenseEvent()
+{
+    // GPU powered down, next RPM read after it wakes restarts sampling
+    if (!acquireMMIO()) {
+        card.fan_sense.active = false;
+        return kIOReturnSuccess;
+    }
+
+    // New window is started here, on the workloop, never by the threads asking for it
+    if (!card.fan_sense.active || card.fan_sense.reset_pending) {
+        card.fan_sense.active = true;
+        card.fan_sense.reset_pending = false;
+        nouveau_therm_fan_sense_reset(&card);
+    }
+
+    nouveau_therm_fan_sense_sample(&card);
+
+    releaseMMIO();
+
+    // Nobody reads RPM, stop sampling until next read
+    if (ptimer_read() - card.fan_sense.last_read < NOUVEAU_FAN_SENSE_IDLE)
+        fanSenseTimer->setTimeoutUS(NOUVEAU_FAN_SENSE_PERIOD);
+    else
+        card.fan_sense.active = false;
+
+    return kIOReturnSuccess;
+}
+
+void GeforceSensors::fanSenseStart()
+{
+    // Called from SMC reads, sampler state is left to the timer
+    if (fanSenseTimer && !card.fan_sense.active)
+        fanSenseTimer->setTimeoutUS(NOUVEAU_FAN_SENSE_PERIOD);
+}
+
+static UInt32 bios_cache_checksum(const u8 *data, u32 size)
+{
+    UInt32 a = 1, b = 0;
+
+    while (size) {
+        // Sums can't overflow within 5552 bytes
+        u32 chunk = size < 5552 ? size : 5552;
+
+        size -= chunk;
+
+        while (chunk--) {
+            a += *data++;
+            b += a;
+        }
+
+        a %= 65521;
+        b %= 65521;
+    }
+
+    return b << 16 | a;
+}
+
+bool GeforceSensors::restoreBiosCache()
+{
+    struct nouveau_device *device = &card;
+
+    OSData *data = OSDynamicCast(OSData, pciDevice->getProperty(kGeforceSensorsBiosCacheKey));
+
+    if (!data || data->getLength() < sizeof(GeforceSensorsBiosCache))
+        return false;
+
+    UInt64 start = ptimer_read();
+
+    const GeforceSensorsBiosCache *cache = (const GeforceSensorsBiosCache *)data->getBytesNoCopy();
+    const u8 *image = (const u8 *)cache + cache->headerSize;
+
+    if (cache->magic != kGeforceSensorsBiosCacheMagic ||
+        cache->version != kGeforceSensorsBiosCacheVersion ||
+        cache->headerSize != sizeof(GeforceSensorsBiosCache) ||
+        cache->pciId != pciDevice->configRead32(kIOPCIConfigVendorID) ||
+        cache->subsystemId != pciDevice->configRead32(kIOPCIConfigSubSystemVendorID) ||
+        !cache->size || data->getLength() != cache->headerSize + cache->size) {
+        nv_debug(device, "VBIOS cache doesn't match the device\n");
+        return false;
+    }
+
+    if (bios_cache_checksum(image, cache->size) != cache->checksum) {
+        nv_warn(device, "VBIOS cache checksum mismatch\n");
+        return false;
+    }
+
+    if (!(device->bios.data = (u8*)IOMalloc(cache->size)))
+        return false;
+
+    device->bios.size = cache->size;
+    memcpy(device->bios.data, image, cache->size);
+
+    device->bios.bmp_offset = cache->bmpOffset;
+    device->bios.bit_offset = cache->bitOffset;
+    device->bios.version = cache->biosVersion;
+    device->vbios.type = (nvbios_type)cache->vbiosType;
+    device->vbios.offset = cache->vbiosOffset;
+
+    biosCached = true;
+
+    UInt64 elapsed = ptimer_read() - start;
+
+    nv_info(device, "VBIOS restored from cache in %lld us, %lld us saved\n", elapsed / 1000, cache->shadowTime > elapsed ? (cache->shadowTime - elapsed) / 1000 : 0);
+
+    return true;
+}
+
+void GeforceSensors::storeBiosCache()
+{
+    struct nouveau_device *device = &card;
+
+    if (biosCached || !device->bios.data || !device->bios.size)
+        return;
+
+    GeforceSensorsBiosCache cache;
+
+    bzero(&cache, sizeof(cache));
+
+    cache.magic = kGeforceSensorsBiosCacheMagic;
+    cache.version = kGeforceSensorsBiosCacheVersion;
+    cache.headerSize = sizeof(GeforceSensorsBiosCache);
+    cache.pciId = pciDevice->configRead32(kIOPCIConfigVendorID);
+    cache.subsystemId = pciDevice->configRead32(kIOPCIConfigSubSystemVendorID);
+    cache.size = device->bios.size;
+    cache.checksum = bios_cache_checksum(device->bios.data, device->bios.size);
+    cache.bmpOffset = device->bios.bmp_offset;
+    cache.bitOffset = device->bios.bit_offset;
+    cache.vbiosOffset = device->vbios.offset;
+    cache.vbiosType = device->vbios.type;
+    cache.biosVersion = device->bios.version;
+    cache.shadowTime = biosShadowTime;
+
+    if (OSData *data = OSData::withCapacity(sizeof(cache) + device->bios.size)) {
+        if (data->appendBytes(&cache, sizeof(cache)) && data->appendBytes(device->bios.data, device->bios.size)) {
+            pciDevice->setProperty(kGeforceSensorsBiosCacheKey, data);
+            biosCached = true;
+        }
+
+        data->release();
+    }
+}
+
+UInt32 GeforceSensors::biosChecksum()
+{
+    struct nouveau_device *device = &card;
+
+    return device->bios.data && device->bios.size ? bios_cache_checksum(device->bios.data, device->bios.size) : 0;
+}
+
+void GeforceSensors::probeI2CDevices()
+{
+    struct nouveau_device *device = &card;
+    struct nouveau_i2c_probe_hint hint;
+
+    bzero(&hint, sizeof(hint));
+
+    UInt32 subsystemId = pciDevice->configRead32(kIOPCIConfigSubSystemVendorID);
+    UInt32 checksum = biosChecksum();
+
+    if (OSData *data = OSDynamicCast(OSData, pciDevice->getProperty(kGeforceSensorsI2CCacheKey))) {
+        const GeforceSensorsI2CCache *cache = (const GeforceSensorsI2CCache *)data->getBytesNoCopy();
+
+        if (data->getLength() == sizeof(GeforceSensorsI2CCache) &&
+            cache->magic == kGeforceSensorsI2CCacheMagic &&
+            cache->version == kGeforceSensorsI2CCacheVersion &&
+            cache->size == sizeof(GeforceSensorsI2CCache) &&
+            cache->subsystemId == subsystemId &&
+            cache->biosChecksum == checksum &&
+            cache->found) {
+            hint.cached = true;
+            hint.found = cache->found;
+            hint.index = cache->index;
+            hint.addr = cache->addr;
+            strlcpy(hint.type, cache->type, sizeof(hint.type));
+
+            nv_debug(device, "using cached I2C probe result\n");
+        }
+    }
+
+    nouveau_i2c_probe(device, &hint);
+
+    // Verified cached result needs no update
+    if (hint.cached)
+        return;
+
+    // Missing device is not remembered, it may just have been slow to answer this time
+    if (!hint.found) {
+        pciDevice->removeProperty(kGeforceSensorsI2CCacheKey);
+        return;
+    }
+
+    GeforceSensorsI2CCache cache;
+
+    bzero(&cache, sizeof(cache));
+
+    cache.magic = kGeforceSensorsI2CCacheMagic;
+    cache.version = kGeforceSensorsI2CCacheVersion;
+    cache.size = sizeof(GeforceSensorsI2CCache);
+    cache.subsystemId = subsystemId;
+    cache.biosChecksum = checksum;
+    cache.found = hint.found;
+    cache.index = hint.index;
+    cache.addr = hint.addr;
+    strlcpy(cache.type, hint.type, sizeof(cache.type));
+
+    if (OSData *data = OSData::withBytes(&cache, sizeof(cache))) {
+        pciDevice->setProperty(kGeforceSensorsI2CCacheKey, data);
+        data->release();
+    }
+}
+
 bool GeforceSensors::shadowBios()
 {
     struct nouveau_device *device = &card;
@@ -58,6 +272,11 @@ bool GeforceSensors::shadowBios()
     if (device->bios.data && device->bios.size)
         return true; // BIOS present already
 
+    if (restoreBiosCache())
+        return true;
+
+    UInt64 start = ptimer_read();
+
 
     //try to load bios from registry first from "vbios" property created by Chameleon boolloader
     if (OSData *vbios = OSDynamicCast(OSData, pciDevice->getProperty("vbios"))) {
@@ -77,6 +296,8 @@ bool GeforceSensors::shadowBios()
         }
     }
 
+    biosShadowTime = ptimer_read() - start;
+
     return true;
 }
 
@@ -123,7 +344,7 @@ bool GeforceSensors::mapMemory(IOService *provider)
      }*/
 }
 
-bool GeforceSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
+bool GeforceSensors::readSensorValue(FakeSMCSensor *sensor, float *outValue)
 {
     switch (sensor->getGroup()) {
         case kFakeSMCTemperatureSensor: {
@@ -147,13 +368,15 @@ bool GeforceSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
         }
             
         case kFakeSMCFrequencySensor:
-            *outValue = (float)card.clocks_get(&card, sensor->getIndex()) / 1000.0f;
+            *outValue = (float)nouveau_clocks_get(&card, sensor->getIndex()) / 1000.0f;
             break;
 
         case kFakeSMCTachometerSensor:{
             switch (sensor->getIndex()) {
                 case nouveau_fan_rpm:
+                    // GPIO tachometer returns RPM of the last sampling window right away
                     *outValue = card.fan_rpm_get(&card);
+                    fanSenseStart();
                     break;
                     
                 case nouveau_fan_pwm:
@@ -222,6 +445,12 @@ bool GeforceSensors::probIsAcceleratorAlreadyLoaded()
     return false;
 }
 
+bool GeforceSensors::shouldPollForAccelerator()
+{
+    // NVDA sets its loaded flags on the PCI device, nothing is published for them
+    return true;
+}
+
 bool GeforceSensors::onStartUp(IOService *provider)
 {
     HWSensorsDebugLog("Initializing...");
@@ -261,7 +490,17 @@ bool GeforceSensors::managedStart(IOService *provider)
     }
 
     nouveau_vbios_init(device);
-    nouveau_bios_parse(device);
+
+    // Values parsed from the image come with the cache
+    if (!biosCached) {
+        UInt64 start = ptimer_read();
+
+        nouveau_bios_parse(device);
+
+        biosShadowTime += ptimer_read() - start;
+
+        storeBiosCache();
+    }
     
     // initialize funcs and variables
     if (!nouveau_init(device)) {
@@ -278,7 +517,7 @@ bool GeforceSensors::managedStart(IOService *provider)
         nouveau_i2c_create(device);
         
         // setup nouveau i2c sensors
-        nouveau_i2c_probe(device);
+        probeI2CDevices();
     }
     
     // Register sensors
@@ -340,8 +579,20 @@ bool GeforceSensors::managedStart(IOService *provider)
         char title[DIAG_FUNCTION_STR_LEN];
         snprintf (title, DIAG_FUNCTION_STR_LEN, "GPU %X", card.card_index + 1);
         
-        if (card.fan_rpm_get && card.fan_rpm_get(&card) >= 0)
-            addTachometer(nouveau_fan_rpm, title, GPU_FAN_RPM, card.card_index);
+        if (card.fan_rpm_get && card.fan_rpm_get(&card) >= 0) {
+            if (card.fan_rpm_get == nouveau_therm_fan_rpm_get) {
+                if (!(workloop = getWorkLoop()) ||
+                    !(fanSenseTimer = IOTimerEventSource::timerEventSource(this, OSMemberFunctionCast(IOTimerEventSource::Action, this, &GeforceSensors::fanSenseEvent))) ||
+                    kIOReturnSuccess != workloop->addEventSource(fanSenseTimer)) {
+                    nv_error(device, "failed to initialize fan sense timer event source\n");
+                    OSSafeReleaseNULL(fanSenseTimer);
+                }
+                else fanSenseStart();
+            }
+
+            if (card.fan_rpm_get != nouveau_therm_fan_rpm_get || fanSenseTimer)
+                addTachometer(nouveau_fan_rpm, title, GPU_FAN_RPM, card.card_index);
+        }
         
         if (card.fan_pwm_get && card.fan_pwm_get(&card) >= 0)
             addTachometer(nouveau_fan_pwm, title, GPU_FAN_PWM_CYCLE, card.card_index);
@@ -367,10 +618,22 @@ void GeforceSensors::hasPoweredOn()
     if (card.fan_init) {
         card.fan_init(&card);
     }
+
+    // Edges counted before sleep are meaningless, sampler drops them on its next run
+    card.fan_sense.reset_pending = true;
+
+    // Clocks are reprogrammed on wake
+    nouveau_clocks_invalidate(&card);
 }
 
 void GeforceSensors::stop(IOService * provider)
 {
+    if (fanSenseTimer) {
+        fanSenseTimer->cancelTimeout();
+        workloop->removeEventSource(fanSenseTimer);
+        OSSafeReleaseNULL(fanSenseTimer);
+    }
+
     if (card.mmio)
         OSSafeReleaseNULL(card.mmio);
     
@@ -36,6 +36,48 @@
 
 #include "GPUSensors.h"
 
+// Shadowed VBIOS and values parsed from it are kept in PCI device registry entry,
+// so the plugin reloaded later validates the cache instead of reading ROM over MMIO
+#define kGeforceSensorsBiosCacheKey         "hwsensors-vbios-cache"
+#define kGeforceSensorsBiosCacheMagic       0x4e564243 // NVBC
+#define kGeforceSensorsBiosCacheVersion     1
+
+struct GeforceSensorsBiosCache {
+    UInt32                  magic;
+    UInt16                  version;
+    UInt16                  headerSize;
+    UInt32                  pciId;                  // vendor | device << 16
+    UInt32                  subsystemId;            // vendor | device << 16
+    UInt32                  size;
+    UInt32                  checksum;               // adler32 of the image
+    UInt32                  bmpOffset;
+    UInt32                  bitOffset;
+    UInt16                  vbiosOffset;
+    UInt8                   vbiosType;
+    UInt8                   reserved;
+    nouveau_bios_version    biosVersion;
+    UInt64                  shadowTime;             // ns spent to shadow and parse without cache
+};
+
+// Result of I2C monitoring device probe for the board, the device found is
+// verified alone on next start and nothing is scanned if none was found
+#define kGeforceSensorsI2CCacheKey          "hwsensors-i2c-probe-cache"
+#define kGeforceSensorsI2CCacheMagic        0x4e564943 // NVIC
+#define kGeforceSensorsI2CCacheVersion      1
+
+struct GeforceSensorsI2CCache {
+    UInt32                  magic;
+    UInt16                  version;
+    UInt16                  size;
+    UInt32                  subsystemId;            // vendor | device << 16
+    UInt32                  biosChecksum;           // adler32 of the VBIOS image
+    UInt8                   found;
+    UInt8                   index;                  // NV_I2C_DEFAULT(n)
+    UInt8                   addr;
+    UInt8                   reserved;
+    char                    type[I2C_NAME_SIZE];
+};
+
 class EXPORT GeforceSensors : public GPUSensors
 {
     OSDeclareDefaultStructors(GeforceSensors)    
@@ -50,12 +92,25 @@ private:
     float               i2c_get_fanspeed_pwm(I2CDevPtr dev);
     int                 i2c_get_fanspeed_mode(I2CDevPtr dev);
 
+    IOWorkLoop*         workloop;
+    IOTimerEventSource* fanSenseTimer;
+    IOReturn            fanSenseEvent();
+    void                fanSenseStart();
+
+    bool                biosCached;
+    UInt64              biosShadowTime;
+
     bool                mapMemory(IOService *provider);
     bool                shadowBios();
+    bool                restoreBiosCache();
+    void                storeBiosCache();
+    UInt32              biosChecksum();
+    void                probeI2CDevices();
 protected:
-    virtual bool        willReadSensorValue(FakeSMCSensor *sensor, float* value);
+    virtual bool        readSensorValue(FakeSMCSensor *sensor, float* value);
     virtual bool        shouldWaitForAccelerator();
     virtual bool        probIsAcceleratorAlreadyLoaded();
+    virtual bool        shouldPollForAccelerator();
     virtual bool        onStartUp(IOService *provider);
     virtual bool        managedStart(IOService *provider);
     virtual void        hasPoweredOn();
@@ -50,15 +50,18 @@
 /* This function should return the chip type .. */
 int adt7473_detect(I2CDevPtr dev)
 {
-	I2CByte man_id, dev_id, chip_id;
+	const I2CByte regs[] = { ADT7473_REG_MAN_ID, ADT7473_REG_DEVID2, ADT7473_REG_CHIP_ID };
+	I2CByte values[3], man_id, dev_id, chip_id;
 	
-	xf86I2CReadByte(dev, ADT7473_REG_MAN_ID, &man_id);
-    xf86I2CReadByte(dev, ADT7473_REG_DEVID2, &dev_id);
+	if (!xf86I2CReadVec(dev, regs, values, 3))
+		return 0;
+    
+	man_id = values[0];
+	dev_id = values[1];
+	chip_id = values[2];
     
     if (man_id != AD_MAN_ID || (dev_id & 0xf8) != 0x68)
 		return 0;
-    
-	xf86I2CReadByte(dev, ADT7473_REG_CHIP_ID, &chip_id);
 
     if (chip_id == 0x73) {
         dev->chip_id = ADT7473;
@@ -86,13 +89,16 @@ int adt7473_detect(I2CDevPtr dev)
 
 int adt7473_get_board_temp(nouveau_device *device)
 {
-	I2CByte temp;
-	I2CByte cfg;
+	const I2CByte regs[] = { ADT7473_REG_LOCAL_TEMP, ADT7473_REG_CFG5 };
+	I2CByte values[2];
 
-	xf86I2CReadByte(device->nvclock_i2c_sensor, ADT7473_REG_LOCAL_TEMP, &temp);
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
+
+	I2CByte temp = values[0];
+	I2CByte cfg = values[1];
 
 	/* Check if the sensor uses 2-complement or offset-64 mode */
-	xf86I2CReadByte(device->nvclock_i2c_sensor, ADT7473_REG_CFG5, &cfg);
 	if(cfg & 0x1)
 		return (int)((char)temp);
 	else
@@ -101,8 +107,8 @@ int adt7473_get_board_temp(nouveau_device *device)
 
 int adt7473_get_gpu_temp(nouveau_device *device)
 {
-	I2CByte temp;
-	I2CByte cfg;
+	const I2CByte regs[] = { ADT7473_REG_REMOTE_TEMP, ADT7473_REG_CFG5 };
+	I2CByte values[2];
 	int offset = 0;
 
 	/* The temperature needs to be corrected using an offset which is stored in the bios.
@@ -130,11 +136,13 @@ int adt7473_get_gpu_temp(nouveau_device *device)
 			offset = 8;
 	}
 
-	xf86I2CReadByte(device->nvclock_i2c_sensor, ADT7473_REG_REMOTE_TEMP, &temp);
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
+
+	I2CByte temp = values[0];
+	I2CByte cfg = values[1];
 	
 	/* Check if the sensor uses 2-complement or offset-64 mode */
-
-	xf86I2CReadByte(device->nvclock_i2c_sensor, ADT7473_REG_CFG5, &cfg);
 	if(cfg & 0x1)
 		return (int)((char)temp + offset);
 	else
@@ -143,12 +151,18 @@ int adt7473_get_gpu_temp(nouveau_device *device)
 
 int adt7473_get_fanspeed_rpm(nouveau_device *device)
 {
-	I2CByte count_lb, count_hb;
+	/* Low byte goes first, it latches the high byte */
+	const I2CByte regs[] = { ADT7473_REG_TACH1_LB, ADT7473_REG_TACH1_HB };
+	I2CByte values[2];
 	int count;
 
-	xf86I2CReadByte(device->nvclock_i2c_sensor, ADT7473_REG_TACH1_LB, &count_lb);
-	xf86I2CReadByte(device->nvclock_i2c_sensor, ADT7473_REG_TACH1_HB, &count_hb);
-	count = (count_hb << 8) | count_lb;
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
+
+	count = (values[1] << 8) | values[0];
+
+	if (!count)
+		return 0;
 
 	/* GT200 boards seem to use two phases instead of a single, the fan speed is twice as high */
 	if((device->chipset & 0x1f0) >= 0xA0)
@@ -8,18 +8,19 @@
 
 int f75375_detect(I2CDevPtr dev)
 {
-	I2CByte nvl, nvh;
+	const I2CByte regs[] = { FINTEK_VENDOR1, FINTEK_VENDOR2, ASUS_NV40_CHIPID_H, ASUS_NV40_CHIPID_L };
+	I2CByte values[4], nvl, nvh;
 
-	xf86I2CReadByte(dev, FINTEK_VENDOR1, &nvl);
-	xf86I2CReadByte(dev, FINTEK_VENDOR2, &nvh);
+	if (!xf86I2CReadVec(dev, regs, values, 4))
+		return 0;
 
-	if (MERGE_BYTE(nvh, nvl) != 0x3419)
+	if (MERGE_BYTE(values[1], values[0]) != 0x3419)
 	{
 		return 0;
 	}
 
-	xf86I2CReadByte(dev, ASUS_NV40_CHIPID_H, &nvh);
-	xf86I2CReadByte(dev, ASUS_NV40_CHIPID_L, &nvl);
+	nvh = values[2];
+	nvl = values[3];
 
 	if (MERGE_BYTE(nvh, nvl) == 0x0306)
 	{
@@ -48,13 +49,14 @@ int f75375_get_gpu_temp(nouveau_device *device)
 
 int f75375_get_fanspeed_rpm(nouveau_device *device)
 {
-	I2CByte nvh, nvl;
+	const I2CByte regs[] = { F75375S_FAN1_COUNT_H, F75375S_FAN1_COUNT_L };
+	I2CByte values[2];
 	int rpm;
 
-	xf86I2CReadByte(device->nvclock_i2c_sensor, F75375S_FAN1_COUNT_H, &nvh);
-	xf86I2CReadByte(device->nvclock_i2c_sensor, F75375S_FAN1_COUNT_L, &nvl);
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
 
-	rpm = FAN_TO_RPM(nvh, nvl);
+	rpm = FAN_TO_RPM(values[0], values[1]);
 
 	return rpm;
 }
@@ -113,22 +115,27 @@ int f75375_set_gpu_tempctl(I2CDevPtr dev, fan_vtemp speeds)
 
 int f75375_get_gpu_tempctl(I2CDevPtr dev, fan_vtemp *speeds)
 {
-	I2CByte nvh, nvl;
+	I2CByte regs[14], values[14];
 	int i;
 
 	for (i=0; i<4; i++)
-	{
-		xf86I2CReadByte(dev, F75375S_VT1_B1 + i, &nvl);
-		speeds->temp[i] = (int)nvl;
-	}
+		regs[i] = F75375S_VT1_B1 + i;
 
 	for (i=0; i<5; i++)
 	{
-		xf86I2CReadByte(dev, F75375S_VT1_S1_H + (i*2), &nvh);
-		xf86I2CReadByte(dev, F75375S_VT1_S1_L + (i*2), &nvl);
-		speeds->speed[i] = FAN_TO_RPM(nvh, nvl);
+		regs[4 + i*2] = F75375S_VT1_S1_H + (i*2);
+		regs[5 + i*2] = F75375S_VT1_S1_L + (i*2);
 	}
 
+	if (!xf86I2CReadVec(dev, regs, values, 14))
+		return -1;
+
+	for (i=0; i<4; i++)
+		speeds->temp[i] = (int)values[i];
+
+	for (i=0; i<5; i++)
+		speeds->speed[i] = FAN_TO_RPM(values[4 + i*2], values[5 + i*2]);
+
 	return 0;
 }
 
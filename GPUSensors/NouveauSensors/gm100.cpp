@@ -37,6 +37,7 @@
 #include "nv50.h"
 #include "nva3.h"
 #include "nv84.h"
+#include "nvc0.h"
 #include "nvd0.h"
 #include "nve0.h"
 #include "nouveau_therm.h"
@@ -88,6 +89,7 @@ void gm100_init(struct nouveau_device *device)
     device->gpio_sense = nvd0_gpio_sense;
     device->temp_get = nv84_temp_get;
     device->clocks_get = nve0_clock_read;
+    device->clocks_stamp = nvc0_clocks_stamp;
     //device->voltage_get = nouveau_voltage_get;
     device->pwm_get = gm107_fan_pwm_get;
     device->fan_pwm_get = nouveau_therm_fan_pwm_get;
@@ -42,14 +42,21 @@
 /* This function should return the chip type .. */
 int lm99_detect(I2CDevPtr dev)
 {
+	const I2CByte regs[] = { LM99_REG_MAN_ID, LM99_REG_CHIP_ID, LM90_REG_R_CONFIG1, LM90_REG_R_CONVRATE, LM90_REG_R_CONFIG2 };
+	I2CByte values[5];
 	I2CByte man_id, chip_id, config1, config2, convrate, address = dev->SlaveAddr / 2;
     const char *name = NULL;
     
-    if (!xf86I2CReadByte(dev, LM99_REG_MAN_ID, &man_id) || !xf86I2CReadByte(dev, LM99_REG_CHIP_ID, &chip_id) || !xf86I2CReadByte(dev, LM90_REG_R_CONFIG1, &config1) || !xf86I2CReadByte(dev, LM90_REG_R_CONVRATE, &convrate))
+    if (!xf86I2CReadVec(dev, regs, values, 4))
 		return 0;
     
+    man_id = values[0];
+    chip_id = values[1];
+    config1 = values[2];
+    convrate = values[3];
+    
     if (man_id == 0x01 || man_id == 0x5C || man_id == 0x41) {
-		if (!xf86I2CReadByte(dev, LM90_REG_R_CONVRATE, &config2))
+		if (!xf86I2CReadByte(dev, LM90_REG_R_CONFIG2, &config2))
 			return 0;
 	} else config2 = 0;
     
@@ -85,6 +92,7 @@ int lm99_detect(I2CDevPtr dev)
             dev->chip_id = MAX6559;
         }
     } else if (man_id == 0x4D) { /* Maxim */
+        const I2CByte maxim_regs[] = { MAX6659_REG_R_REMOTE_EMERG, LM99_REG_MAN_ID, MAX6659_REG_R_REMOTE_EMERG, MAX6696_REG_R_STATUS2 };
         I2CByte emerg, emerg2, status2;
         
         /*
@@ -93,9 +101,14 @@ int lm99_detect(I2CDevPtr dev)
          * exists, both readings will reflect the same value. Otherwise,
          * the readings will be different.
          */
-        if (!xf86I2CReadByte(dev, MAX6659_REG_R_REMOTE_EMERG, &emerg) || !xf86I2CReadByte(dev, LM99_REG_MAN_ID, &man_id) || !xf86I2CReadByte(dev, MAX6659_REG_R_REMOTE_EMERG, &emerg2) || !xf86I2CReadByte  (dev, MAX6696_REG_R_STATUS2, &status2))
+        if (!xf86I2CReadVec(dev, maxim_regs, values, 4))
             return 0;
         
+        emerg = values[0];
+        man_id = values[1];
+        emerg2 = values[2];
+        status2 = values[3];
+        
         /*
          * The MAX6657, MAX6658 and MAX6659 do NOT have a chip_id
          * register. Reading from that address will return the last
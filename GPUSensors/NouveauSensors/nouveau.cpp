@@ -40,6 +40,7 @@
 #include "gp100.h"
 #include "nouveau_therm.h"
 #include "nouveau_volt.h"
+#include "timer.h"
 
 bool nouveau_identify(struct nouveau_device *device)
 {
@@ -151,3 +152,38 @@ bool nouveau_init(struct nouveau_device *device)
     
     return true;
 }
+
+int nouveau_clocks_get(struct nouveau_device *device, u8 source)
+{
+    struct nouveau_clock_cache *cache = &device->clock_cache;
+    
+    if (!device->clocks_get)
+        return 0;
+    
+    if (!device->clocks_stamp || source >= NOUVEAU_CLOCK_SOURCES)
+        return device->clocks_get(device, source);
+    
+    u64 stamp = device->clocks_stamp(device);
+    u64 now = ptimer_read();
+    
+    /* clocks only change on perf level transitions, decode the tree again after that */
+    if (!cache->stamped || cache->stamp != stamp || now - cache->time > NOUVEAU_CLOCK_MAX_AGE) {
+        cache->stamped = true;
+        cache->stamp = stamp;
+        cache->time = now;
+        cache->valid = 0;
+    }
+    
+    if (!(cache->valid & (1 << source))) {
+        cache->value[source] = device->clocks_get(device, source);
+        cache->valid |= 1 << source;
+    }
+    
+    return cache->value[source];
+}
+
+void nouveau_clocks_invalidate(struct nouveau_device *device)
+{
+    device->clock_cache.stamped = false;
+    device->clock_cache.valid = 0;
+}
@@ -16,6 +16,7 @@
 #include "nouveau_gpio.h"
 #include "nouveau_volt.h"
 #include "nouveau_i2c.h"
+#include "nouveau_therm.h"
 
 enum nouveau_clock_source {
     nouveau_clock_core      = 1,
@@ -32,6 +33,18 @@ enum nouveau_clock_source {
 	nouveau_clock_hub07    	= 12	/* nvc0- */
 };
 
+#define NOUVEAU_CLOCK_SOURCES       13
+#define NOUVEAU_CLOCK_MAX_AGE       5000000000ULL   /* ns, catches reclocks not seen by stamp */
+
+/* decoded clocks are reused until the clock stamp registers change */
+struct nouveau_clock_cache {
+    bool stamped;
+    u64 stamp;
+    u64 time;
+    u32 valid;  /* bitmask of decoded sources */
+    int value[NOUVEAU_CLOCK_SOURCES];
+};
+
 struct nouveau_pm_temp_sensor_constants {
 	/* diode */
 	s16 slope_mult;
@@ -79,6 +92,8 @@ struct nouveau_device {
     
     dcb_gpio_func fan_pwm;
     dcb_gpio_func fan_tach;
+    nouveau_fan_sense fan_sense;
+    nouveau_clock_cache clock_cache;
         
     int (*gpio_sense)(struct nouveau_device *, int);
     int (*gpio_find)(struct nouveau_device *, int, u8, u8, struct dcb_gpio_func *);
@@ -87,6 +102,7 @@ struct nouveau_device {
 	int (*pwm_get)(struct nouveau_device *, int, u32*, u32*);
     
     int (*clocks_get)(struct nouveau_device *, u8);
+    u64 (*clocks_stamp)(struct nouveau_device *);
 	//int (*voltage_get)(struct nouveau_device *);
     int (*temp_get)(struct nouveau_device *);
 	int (*core_temp_get)(struct nouveau_device *);
@@ -145,5 +161,7 @@ inline u32 nv_mask(nouveau_device *device, u32 addr, u32 mask, u32 data)
 
 bool nouveau_identify(struct nouveau_device *device);
 bool nouveau_init(struct nouveau_device *device);
+int nouveau_clocks_get(struct nouveau_device *device, u8 source);
+void nouveau_clocks_invalidate(struct nouveau_device *device);
 
 #endif
@@ -34,6 +34,7 @@
 
 #include "nouveau_definitions.h"
 #include "nouveau.h"
+#include "vbios_scan.h"
 
 u8 nv_ro08(struct nouveau_device *device, u32 addr)
 {
@@ -154,21 +155,6 @@ static u8 nvbios_checksum(const u8 *data, int size)
 	return sum;
 }
 
-static u16 nvbios_findstr(const u8 *data, int size, const char *str, int len)
-{
-	int i, j;
-    
-	for (i = 0; i <= (size - len); i++) {
-		for (j = 0; j < len; j++)
-			if ((char)data[i + j] != str[j])
-				break;
-		if (j == len)
-			return i;
-	}
-    
-	return 0;
-}
-
 int nouveau_bios_score(struct nouveau_device *device, const bool writeable)
 {
     if (device->bios.size < 3 || !device->bios.data || device->bios.data[0] != 0x55 || device->bios.data[1] != 0xAA) {
@@ -380,9 +366,21 @@ static bool nouveau_parse_vbios_struct(struct nouveau_device *device)
 	struct nvbios *bios = &device->vbios;
 	const uint8_t bit_signature[] = { 0xff, 0xb8, 'B', 'I', 'T' };
 	const uint8_t bmp_signature[] = { 0xff, 0x7f, 'N', 'V', 0x0 };
-	int offset;
+	const struct vbios_signature signatures[] = {
+        { (const char*)bit_signature, sizeof(bit_signature) },
+        { (const char*)bmp_signature, sizeof(bmp_signature) },
+    };
+	u32 offsets[2];
+	u32 offset;
+    
+    // Same signatures are located by nouveau_bios_parse in the shadowed image already
+    if (bios->data == device->bios.data && bios->length == device->bios.size) {
+        offsets[0] = device->bios.bit_offset;
+        offsets[1] = device->bios.bmp_offset;
+    }
+    else vbios_find_signatures(bios->data, bios->length, signatures, 2, offsets);
     
-	offset = nvbios_findstr(bios->data, bios->length, (char*)bit_signature, sizeof(bit_signature));
+	offset = offsets[0];
 	if (offset) {
 		//nv_info(device, "BIT BIOS found\n");
 		bios->type = NVBIOS_BIT;
@@ -390,7 +388,7 @@ static bool nouveau_parse_vbios_struct(struct nouveau_device *device)
 		return true; //parse_bit_structure(device, offset + 6);
 	}
     
-	offset = nvbios_findstr(bios->data, bios->length, (char*)bmp_signature, sizeof(bmp_signature));
+	offset = offsets[1];
 	if (offset) {
 		//nv_info(device, "BMP BIOS found\n");
 		bios->type = NVBIOS_BMP;
@@ -413,16 +411,23 @@ void nouveau_bios_parse(struct nouveau_device *device)
     nv_debug(device, "parsing VBIOS\n");
     
     /* detect type of vbios we're dealing with */
-	bios->bmp_offset = nvbios_findstr((u8*)bios->data, bios->size,
-                                      "\xff\x7f""NV\0", 5);
+	const struct vbios_signature signatures[] = {
+        { "\xff\x7f""NV\0", 5 },
+        { "\xff\xb8""BIT", 5 },
+    };
+	u32 offsets[2];
+    
+    /* BMP and BIT signatures are searched in a single pass */
+    vbios_find_signatures((u8*)bios->data, bios->size, signatures, 2, offsets);
+    
+	bios->bmp_offset = offsets[0];
 	if (bios->bmp_offset) {
 		nv_info(device, "VBIOS BMP version %x.%x\n",
                 bmp_version(device) >> 8,
                 bmp_version(device) & 0xff);
 	}
     
-	bios->bit_offset = nvbios_findstr((u8*)bios->data, bios->size,
-                                      "\xff\xb8""BIT", 5);
+	bios->bit_offset = offsets[1];
 	if (bios->bit_offset)
 		nv_debug(device, "VBIOS BIT signature found\n");
     
@@ -45,6 +45,15 @@ struct nouveau_i2c {
 	struct list_head ports;
 };
 
+/* result of monitoring device probe, kept by the caller between starts */
+struct nouveau_i2c_probe_hint {
+	bool cached;	/* filled from previous probe, only found devices are kept */
+	bool found;
+	u8 index;	/* bus, NV_I2C_DEFAULT(n) */
+	u8 addr;
+	char type[I2C_NAME_SIZE];
+};
+
 struct nouveau_i2c_port *nouveau_i2c_find(struct nouveau_i2c *i2c, u8 index);
 
 void nouveau_i2c_drive_scl(void *, int);
@@ -63,6 +72,6 @@ extern const struct i2c_algorithm nouveau_i2c_bit_algo;
 extern const struct i2c_algorithm nouveau_i2c_aux_algo;
 
 bool nouveau_i2c_create(struct nouveau_device *device);
-void nouveau_i2c_probe(struct nouveau_device *device);
+bool nouveau_i2c_probe(struct nouveau_device *device, struct nouveau_i2c_probe_hint *hint);
 
 #endif /* defined(__HWSensors__nouveau_i2c__) */
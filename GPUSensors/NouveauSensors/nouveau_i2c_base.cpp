@@ -64,23 +64,18 @@ int nv_rdi2cr(struct nouveau_i2c_port *port, u8 addr, u8 reg)
 
 int nv_wri2cr(struct nouveau_i2c_port *port, u8 addr, u8 reg, u8 val)
 {
+	u8 buf[2] = { reg, val };
 	struct i2c_msg msgs[] = {
 		{
             addr,
             0,
-            1,
-            &reg
-        },
-		{
-            addr,
-            0,
-            1,
-            &val
+            2,
+            buf
         },
 	};
     
-	int ret = i2c_transfer(&port->adapter, msgs, 2);
-	if (ret != 2)
+	int ret = i2c_transfer(&port->adapter, msgs, 1);
+	if (ret != 1)
 		return -EIO;
     
 	return 0;
@@ -441,6 +436,8 @@ static bool probe_monitoring_device(struct nouveau_i2c_port *i2c, struct i2c_boa
     device->nvclock_i2c_sensor = dev;
 
     nv_debug(device, "found device: %s\n", device->nvclock_i2c_sensor->chip_name);
+
+    nvclock_i2c_tune_sensor(dev);
         
     switch(device->nvclock_i2c_sensor->chip_id)
     {
@@ -537,19 +534,54 @@ nv_board_infos[] = {
     { I2C_BOARD_INFO_NULL }
 };
 
-void nouveau_i2c_probe(struct nouveau_device *device)
+static bool nouveau_i2c_probe_board(struct nouveau_i2c *i2c, u8 index, struct i2c_board_info *board, struct nouveau_i2c_probe_hint *hint)
+{
+	int i = i2c->identify(i2c, index, "monitoring device", board, probe_monitoring_device);
+    
+	if (i < 0)
+		return false;
+    
+	if (hint) {
+		hint->found = true;
+		hint->index = index;
+		hint->addr = board[i].addr;
+		strlcpy(hint->type, board[i].type, sizeof(hint->type));
+	}
+    
+	return true;
+}
+
+bool nouveau_i2c_probe(struct nouveau_device *device, struct nouveau_i2c_probe_hint *hint)
 {
 	struct nouveau_i2c *i2c = &device->i2c;
     struct nvbios_extdev_func extdev_entry;
     
+	if (hint->cached && hint->found) {
+		/* Check the known device only, scan everything if it doesn't answer */
+		struct i2c_board_info board[] = {
+			{ I2C_BOARD_INFO("", hint->addr) },
+			{ I2C_BOARD_INFO_NULL }
+		};
+        
+		strlcpy(board[0].type, hint->type, sizeof(board[0].type));
+        
+		if (nouveau_i2c_probe_board(i2c, hint->index, board, NULL))
+			return true;
+        
+		nv_debug(device, "cached monitoring device %s at 0x%x doesn't answer, probing all\n", hint->type, hint->addr);
+	}
+    
+	hint->cached = false;
+	hint->found = false;
+    
 	if (!nvbios_extdev_find(device, NVBIOS_EXTDEV_LM89, &extdev_entry)) {
 		struct i2c_board_info board[] = {
 			{ I2C_BOARD_INFO("lm90", extdev_entry.addr >> 1) },
 			{ I2C_BOARD_INFO_NULL }
 		};
         
-		if(i2c->identify(i2c, NV_I2C_DEFAULT(0), "monitoring device", board, probe_monitoring_device) >= 0)
-			return;
+		if (nouveau_i2c_probe_board(i2c, NV_I2C_DEFAULT(0), board, hint))
+			return true;
 	}
     
 	if (!nvbios_extdev_find(device, NVBIOS_EXTDEV_ADT7473, &extdev_entry)) {
@@ -558,15 +590,15 @@ void nouveau_i2c_probe(struct nouveau_device *device)
 			{ I2C_BOARD_INFO_NULL }
 		};
         
-		if(i2c->identify(i2c, NV_I2C_DEFAULT(0), "monitoring device",board, probe_monitoring_device) >= 0)
-			return;
+		if (nouveau_i2c_probe_board(i2c, NV_I2C_DEFAULT(0), board, hint))
+			return true;
 	}
     
 	/* The vbios doesn't provide the address of an exisiting monitoring
      device. Let's try our static list.
 	 */
-	if (i2c->identify(i2c, NV_I2C_DEFAULT(0), "monitoring device", nv_board_infos, probe_monitoring_device) < 0)
-        i2c->identify(i2c, NV_I2C_DEFAULT(1), "monitoring device", nv_board_infos, probe_monitoring_device);
+	return nouveau_i2c_probe_board(i2c, NV_I2C_DEFAULT(0), nv_board_infos, hint) ||
+           nouveau_i2c_probe_board(i2c, NV_I2C_DEFAULT(1), nv_board_infos, hint);
     
 //	struct i2c_board_info info[] = {
 //		{ "w83l785ts", 0x0, 0x2d, NULL, 0 },
@@ -197,44 +197,70 @@ int nouveau_therm_fan_pwm_get(struct nouveau_device *device)
     return -EIO;
 }
 
-#define THERM_FAN_SENSE_CYCLES 8
-
 int nouveau_therm_fan_rpm_get(struct nouveau_device *device)
 {
-	u32 cycles, cur, prev, stop = THERM_FAN_SENSE_CYCLES * 4 + 1;
-	u64 start, interval;
+    struct nouveau_fan_sense *sense = &device->fan_sense;
 
 	if (device->fan_tach.func != DCB_GPIO_UNUSED) {
-        /* Time a complete rotation and extrapolate to RPM:
-         * When the fan spins, it changes the value of GPIO FAN_SENSE.
-         * We get 4 changes (0 -> 1 -> 0 -> 1) per complete rotation.
-         */
-        start = ptimer_read();
-
-        prev = device->gpio_get(device, 0, device->fan_tach.func, device->fan_tach.line);
-        cycles = 0;
-        do {
-            IODelay(750); /* supports 0 < rpm < 7500 */
-            
-            cur = device->gpio_get(device, 0, device->fan_tach.func, device->fan_tach.line);
-            if (prev != cur) {
-                if (!start)
-                    start = ptimer_read();
-                cycles++;
-                prev = cur;
-            }
-            
-            interval = ptimer_read() - start;
-            
-        } while (cycles < stop && interval < 500000000);
-        
-        if (interval) {
-            return (int)(((u64)60000000000ULL * (((u64)cycles - 1) / 4)) / interval);
-        } else
-            return -EIO;
+        /* Sampler owner restarts sampling once it sees RPM is wanted again */
+        sense->last_read = ptimer_read();
+
+        return sense->rpm;
     }
-    
+
     nv_debug(device, "DCB_GPIO_FAN_SENSE func not found\n");
-    
+
     return -EIO;
 }
+
+void nouveau_therm_fan_sense_reset(struct nouveau_device *device)
+{
+    struct nouveau_fan_sense *sense = &device->fan_sense;
+
+    sense->slot = 0;
+    sense->filled = 0;
+    sense->slot_start = 0;
+    sense->edges[0] = 0;
+}
+
+void nouveau_therm_fan_sense_sample(struct nouveau_device *device)
+{
+    struct nouveau_fan_sense *sense = &device->fan_sense;
+    int cur = device->gpio_get(device, 0, device->fan_tach.func, device->fan_tach.line);
+    u64 now = ptimer_read();
+
+    if (!sense->slot_start) {
+        sense->prev = cur;
+        sense->slot_start = now;
+        return;
+    }
+
+    if (cur != sense->prev) {
+        sense->edges[sense->slot]++;
+        sense->prev = cur;
+    }
+
+    if (now - sense->slot_start < NOUVEAU_FAN_SENSE_SLOT)
+        return;
+
+    sense->length[sense->slot] = now - sense->slot_start;
+
+    if (sense->filled < NOUVEAU_FAN_SENSE_SLOTS)
+        sense->filled++;
+
+    /* When the fan spins, it changes the value of GPIO FAN_SENSE.
+     * We get 4 changes (0 -> 1 -> 0 -> 1) per complete rotation.
+     */
+    u64 edges = 0, interval = 0;
+
+    for (int i = 0; i < sense->filled; i++) {
+        edges += sense->edges[i];
+        interval += sense->length[i];
+    }
+
+    sense->rpm = (int)((60000000000ULL * edges / 4) / interval);
+
+    sense->slot = (sense->slot + 1) % NOUVEAU_FAN_SENSE_SLOTS;
+    sense->edges[sense->slot] = 0;
+    sense->slot_start = now;
+}
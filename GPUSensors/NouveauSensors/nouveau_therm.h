@@ -18,9 +18,32 @@ struct nvbios_therm_sensor {
 	s8 offset_constant;
 };
 
+/* GPIO fan tachometer is sampled from a timer, edges are counted in slots
+ * and RPM is published over the sliding window of the last slots */
+#define NOUVEAU_FAN_SENSE_PERIOD    750                 /* us, supports 0 < rpm < 7500 */
+#define NOUVEAU_FAN_SENSE_SLOTS     8
+#define NOUVEAU_FAN_SENSE_SLOT      125000000ULL        /* ns, window is 1 s */
+#define NOUVEAU_FAN_SENSE_IDLE      10000000000ULL      /* ns, sampling stops when RPM is not read */
+
+/* Owned by the sampling timer, other threads only set last_read and reset_pending */
+struct nouveau_fan_sense {
+    bool active;
+    bool reset_pending;
+    int prev;
+    u8 slot;
+    u8 filled;
+    u32 edges[NOUVEAU_FAN_SENSE_SLOTS];
+    u64 length[NOUVEAU_FAN_SENSE_SLOTS];
+    u64 slot_start;
+    u64 last_read;
+    int rpm;
+};
+
 void nouveau_therm_init(struct nouveau_device *device);
 int nouveau_therm_fan_pwm_get(struct nouveau_device *device);
 int nouveau_therm_fan_rpm_get(struct nouveau_device *device);
+void nouveau_therm_fan_sense_reset(struct nouveau_device *device);
+void nouveau_therm_fan_sense_sample(struct nouveau_device *device);
 
 int nouveau_fan_pwm_get(struct nouveau_device *device);
 int nouveau_fan_rpm_get(struct nouveau_device *device);
@@ -96,6 +96,7 @@ void nv50_init(struct nouveau_device *device)
             nv50_sensor_setup(device);
             device->temp_get = nv50_temp_get;
             device->clocks_get = nv50_clocks_get;
+            device->clocks_stamp = nv50_clocks_stamp;
             device->fan_rpm_get = nouveau_therm_fan_rpm_get;
             break;
         case 0xa3:
@@ -104,11 +105,13 @@ void nv50_init(struct nouveau_device *device)
         case 0xaf:
             nva3_therm_init(device);
             device->clocks_get = nva3_clocks_get;
+            device->clocks_stamp = nva3_clocks_stamp;
             device->temp_get = nv84_temp_get;
             device->fan_rpm_get = nva3_therm_fan_sense;
             break;
         default:
             device->clocks_get = nv50_clocks_get;
+            device->clocks_stamp = nv50_clocks_stamp;
             device->temp_get = nv84_temp_get;
             device->fan_rpm_get = nouveau_therm_fan_rpm_get;
             break;
@@ -416,6 +419,12 @@ static u32 read_clk(struct nouveau_device *device, enum clk_src src)
 	return 0;
 }
 
+u64 nv50_clocks_stamp(struct nouveau_device *device)
+{
+    /* source mux and nvclk pll coefficients are rewritten by reclocking */
+    return (u64)nv_rd32(device, 0x00c040) << 32 | nv_rd32(device, 0x00402c);
+}
+
 int nv50_clocks_get(struct nouveau_device *device, u8 source)
 {
 	if (/*device->chipset == 0xaa ||*/
@@ -15,6 +15,7 @@ void nv50_init(struct nouveau_device *device);
 int nv50_gpio_sense(struct nouveau_device *device, int line);
 
 int nv50_clocks_get(struct nouveau_device *device, u8 source);
+u64 nv50_clocks_stamp(struct nouveau_device *device);
 void nv50_sensor_setup(struct nouveau_device *device);
 int nv50_temp_get(struct nouveau_device *device);
 int nv50_fan_pwm_get(struct nouveau_device *device, int line, u32 *divs, u32 *duty);
@@ -130,6 +130,12 @@ static u32 read_pll(struct nouveau_device *device, int clk, u32 pll)
 	return 0;
 }
 
+u64 nva3_clocks_stamp(struct nouveau_device *device)
+{
+    /* core pll control and coefficients */
+    return (u64)nv_rd32(device, 0x004200) << 32 | nv_rd32(device, 0x004204);
+}
+
 int nva3_clocks_get(struct nouveau_device *device, u8 source)
 {
     switch (source) {
@@ -12,5 +12,6 @@
 int nva3_therm_fan_sense(struct nouveau_device *device);
 int nva3_therm_init(struct nouveau_device *device);
 int nva3_clocks_get(struct nouveau_device *device, u8 source);
+u64 nva3_clocks_stamp(struct nouveau_device *device);
 
 #endif
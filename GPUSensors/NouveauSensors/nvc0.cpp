@@ -92,6 +92,7 @@ void nvc0_init(struct nouveau_device *device)
 
     device->temp_get = nv84_temp_get;
     device->clocks_get = nvc0_clocks_get;
+    device->clocks_stamp = nvc0_clocks_stamp;
     //device->voltage_get = nouveau_voltage_get;
     device->pwm_get = nvd0_fan_pwm_get;
     device->fan_pwm_get = nouveau_therm_fan_pwm_get;
@@ -209,6 +210,15 @@ static u32 read_clk(struct nouveau_device *device, int clk)
 	return sclk;
 }
 
+u64 nvc0_clocks_stamp(struct nouveau_device *device)
+{
+    /* pll/divider source select, core clock divider control and clk 0 pll
+     * coefficients, mixed in so a reclock that only moves the pll is seen */
+    u64 stamp = (u64)nv_rd32(device, 0x137100) << 32 | nv_rd32(device, 0x137250);
+
+    return stamp ^ ((u64)nv_rd32(device, 0x137004) << 16);
+}
+
 int nvc0_clocks_get(struct nouveau_device *device, u8 source)
 {
     switch (source) {
@@ -15,6 +15,7 @@ bool nvc0_identify(struct nouveau_device *device);
 void nvc0_init(struct nouveau_device *device);
 
 int nvc0_clocks_get(struct nouveau_device *device, u8 source);
+u64 nvc0_clocks_stamp(struct nouveau_device *device);
 int nve0_clocks_get(struct nouveau_device *device, u8 source);
 
 #endif
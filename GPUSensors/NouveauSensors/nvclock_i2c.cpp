@@ -301,10 +301,40 @@ I2CDevPtr nvclock_i2c_probe_devices(nouveau_device *device, I2CBusPtr busses[],
 	return NULL;
 }
 
+/* Tune bus timing with the identification register the chip was detected by */
+void nvclock_i2c_tune_sensor(I2CDevPtr dev)
+{
+    I2CByte reg;
+    
+    switch (dev->chip_id) {
+        case LM99:
+        case MAX6559:
+            reg = 0xfe; /* manufacturer ID */
+            break;
+        case F75375:
+            reg = 0x5d; /* FINTEK_VENDOR1 */
+            break;
+        case W83781D:
+            reg = 0x4f; /* manufacturer ID */
+            break;
+        case W83L785R:
+            reg = 0x4c; /* manufacturer ID, low byte */
+            break;
+        case ADT7473:
+            reg = 0x3e; /* manufacturer ID */
+            break;
+        default:
+            return;
+    }
+    
+    if (xf86I2CTuneBus(dev, reg) < 0)
+        nv_debug(dev->pI2CBus->card, "%s did not answer at configured bus timing\n", dev->chip_name);
+}
+
 bool nvclock_i2c_sensor_init(nouveau_device *device)
 {
     int num_busses = 0;
-    I2CBusPtr busses[4];
+    I2CBusPtr busses[5];
     
     struct nouveau_i2c_port *port = NULL;
     
@@ -314,7 +344,16 @@ bool nvclock_i2c_sensor_init(nouveau_device *device)
             
             snprintf(name, 16, "NV_I2C_DEFAULT%X", i);
             
-            busses[num_busses++] = nvclock_i2c_create_bus_ptr(device, STRDUP(name, sizeof(name)), port->drive);
+            I2CBusPtr bus = nvclock_i2c_create_bus_ptr(device, STRDUP(name, sizeof(name)), port->drive);
+            
+            if (!bus)
+                continue;
+            
+            /* AUX channels can't be bit-banged, use the port adapter instead */
+            if (port->type == DCB_I2C_NVIO_AUX)
+                bus->port = port;
+            
+            busses[num_busses++] = bus;
         }
     }
     
@@ -325,6 +364,8 @@ bool nvclock_i2c_sensor_init(nouveau_device *device)
         if(device->nvclock_i2c_sensor) {
             nv_info(device, "found %s monitoring chip\n", device->nvclock_i2c_sensor->chip_name);
             
+            nvclock_i2c_tune_sensor(device->nvclock_i2c_sensor);
+            
             switch(device->nvclock_i2c_sensor->chip_id)
             {
                 case LM99:
@@ -53,6 +53,7 @@ I2CDevPtr nvclock_i2c_probe_device (I2CBusPtr bus, I2CSlaveAddr addr, const char
 void nvclock_i2c_probe_all_devices (I2CBusPtr busses[], int nbus);
 I2CDevPtr nvclock_i2c_probe_devices(nouveau_device *device, I2CBusPtr busses[], int num_busses);
 bool nvclock_i2c_sensor_init(nouveau_device *device);
+void nvclock_i2c_tune_sensor(I2CDevPtr dev);
 
 /* ADT7473 */
 int adt7473_detect(I2CDevPtr dev);
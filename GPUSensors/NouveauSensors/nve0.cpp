@@ -77,6 +77,7 @@ void nve0_init(struct nouveau_device *device)
     device->gpio_sense = nvd0_gpio_sense;
     device->temp_get = nv84_temp_get;
     device->clocks_get = nve0_clock_read;
+    device->clocks_stamp = nvc0_clocks_stamp;
 //    device->voltage_get = nouveau_voltage_get;
     device->pwm_get = nvd0_fan_pwm_get;
     device->fan_pwm_get = nouveau_therm_fan_pwm_get;
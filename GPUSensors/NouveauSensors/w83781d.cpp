@@ -21,12 +21,13 @@
 /* This function should return the chip type .. */
 int w83781d_detect(I2CDevPtr dev)
 {
-	I2CByte man_id, chip_id;
+	const I2CByte regs[] = { W83781D_REG_MAN_ID, W83781D_REG_CHIP_ID };
+	I2CByte values[2];
 
-	xf86I2CReadByte  (dev, W83781D_REG_MAN_ID, &man_id); 
-	xf86I2CReadByte  (dev, W83781D_REG_CHIP_ID, &chip_id); 
+	if (!xf86I2CReadVec(dev, regs, values, 2))
+		return 0;
 
-	switch(man_id)
+	switch(values[0])
 	{
 		case ASUS_MAN_ID:
 		case W83781D_MAN_ID:
@@ -58,10 +59,14 @@ int w83781d_get_gpu_temp(nouveau_device *device)
 
 int w83781d_get_fanspeed_rpm(nouveau_device *device)
 {
-	I2CByte count, divisor;
+	const I2CByte regs[] = { W83781D_REG_FAN1_COUNT, W83781D_REG_FAN_DIVISOR };
+	I2CByte values[2], count, divisor;
+
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
 
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83781D_REG_FAN1_COUNT, &count);
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83781D_REG_FAN_DIVISOR, &divisor);
+	count = values[0];
+	divisor = values[1];
 	divisor = 1 << ((divisor >> 4) & 0x3); /* bit 5:4 are for fan1; a value of 0 means a divider of 1, while 2 means 2^3 = 8 */
 	
 	/* A count of 0xff indicates that something is wrong i.e. no fan is connected */
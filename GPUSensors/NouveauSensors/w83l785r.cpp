@@ -46,11 +46,15 @@
 /* This function should return the chip type .. */
 int w83l785r_detect(I2CDevPtr dev)
 {
-	I2CByte man_id_l, man_id_h, chip_id;
+	const I2CByte regs[] = { W83L785R_REG_MAN_ID_L, W83L785R_REG_MAN_ID_H, W83L785R_REG_CHIP_ID };
+	I2CByte values[3], man_id_l, man_id_h, chip_id;
 
-	xf86I2CReadByte(dev, W83L785R_REG_MAN_ID_L, &man_id_l); 
-	xf86I2CReadByte(dev, W83L785R_REG_MAN_ID_H, &man_id_h); 
-	xf86I2CReadByte(dev, W83L785R_REG_CHIP_ID, &chip_id); 
+	if (!xf86I2CReadVec(dev, regs, values, 3))
+		return 0;
+
+	man_id_l = values[0];
+	man_id_h = values[1];
+	chip_id = values[2];
 
 	/* Winbond chip */  
 	if((man_id_l == 0xa3) && (man_id_h == 0x5c))
@@ -68,27 +72,36 @@ int w83l785r_detect(I2CDevPtr dev)
 
 int w83l785r_get_board_temp(nouveau_device *device)
 {
-	I2CByte temp, offset;
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83L785R_REG_LOCAL_TEMP, &temp);
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83L785R_REG_LOCAL_TEMP_OFFSET, &offset);
-	return temp + offset;
+	const I2CByte regs[] = { W83L785R_REG_LOCAL_TEMP, W83L785R_REG_LOCAL_TEMP_OFFSET };
+	I2CByte values[2];
+
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
+
+	return values[0] + values[1];
 }
 
 int w83l785r_get_gpu_temp(nouveau_device *device)
 {
-	I2CByte temp, offset;
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83L785R_REG_REMOTE_TEMP, &temp);
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83L785R_REG_REMOTE_TEMP_OFFSET, &offset);
-	return temp + offset;
+	const I2CByte regs[] = { W83L785R_REG_REMOTE_TEMP, W83L785R_REG_REMOTE_TEMP_OFFSET };
+	I2CByte values[2];
+
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
+
+	return values[0] + values[1];
 }
 
 int w83l785r_get_fanspeed_rpm(nouveau_device *device)
 {
-	I2CByte count, divisor;
+	const I2CByte regs[] = { W83L785R_REG_FAN1_COUNT, W83L785R_REG_FAN_DIVISOR };
+	I2CByte values[2], count, divisor;
+
+	if (!xf86I2CReadVec(device->nvclock_i2c_sensor, regs, values, 2))
+		return 0;
 
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83L785R_REG_FAN1_COUNT, &count);
-	xf86I2CReadByte(device->nvclock_i2c_sensor, W83L785R_REG_FAN_DIVISOR, &divisor);
-	divisor &= 0x7;
+	count = values[0];
+	divisor = values[1] & 0x7;
 
 	/* By default count useally is 153, it seems that a value of 255 means that something is wrong.
 	/  For example it retuns this value on boards on which the fan is replaced with a heatpipe and because
@@ -14,6 +14,7 @@
 #include "xf86i2c.h"
 
 #include "nouveau_definitions.h"
+#include "nouveau_i2c.h"
 
 #define I2C_TIMEOUT(x, args...)	/*(x)*/  /* Report timeouts */
 #define I2C_TRACE(x, args...) /*(x)*/  /* Report progress */
@@ -359,6 +360,119 @@ Bool I2CAddress(I2CDevPtr d, I2CSlaveAddr addr)
     return FALSE;
 }
 
+/* Transactions.
+ * =============
+ *
+ * Every helper below builds its messages on the stack and passes them
+ * to I2CTransfer. A bus attached to a port hands them to the port's
+ * adapter (AUX channels), otherwise they are clocked out bit by bit with
+ * the bus' I2CAddress/PutByte/GetByte/Stop functions.
+ */
+
+/* Each message starts with a [repeated] start condition and the slave
+ * address, with the read flag set for I2C_M_RD messages. Bytes of a read
+ * are acknowledged except for the last one. A single stop condition ends
+ * the transfer once an address has been sent.
+ *
+ * The transfer ends at the first error. A failed I2CAddress leaves the
+ * bus idle itself, no stop is sent then.
+ */
+
+static Bool
+I2CBitTransfer(I2CDevPtr d, struct i2c_msg *msgs, int num)
+{
+    I2CBusPtr b = d->pI2CBus;
+    Bool r = TRUE;
+    int i, n;
+    
+    for (i = 0; r && i < num; i++) {
+        Bool read = (msgs[i].flags & I2C_M_RD) != 0;
+        
+        if (!b->I2CAddress(d, (msgs[i].addr << 1) | (read ? 1 : 0)))
+            return FALSE;
+        
+        for (n = 0; r && n < msgs[i].len; n++)
+            r = read ? b->I2CGetByte(d, &msgs[i].buf[n], n == msgs[i].len - 1)
+                     : b->I2CPutByte(d, msgs[i].buf[n]);
+    }
+    
+    if (num > 0) b->I2CStop(d);
+    
+    return r;
+}
+
+/* Bit timing is restored for the failed transfer only when it is a read,
+ * register pointer writes included. A write may have reached the slave
+ * before the failure and is not repeated. When the repeated read works
+ * the slave can't keep up with the tuned timing and the bus stays slow.
+ */
+
+static Bool
+I2CIsRead(const struct i2c_msg *msgs, int num)
+{
+    int i;
+    
+    if (num <= 0 || !(msgs[num - 1].flags & I2C_M_RD) || msgs[num - 1].len <= 0)
+        return FALSE;
+    
+    for (i = 0; i < num; i++)
+        if (!(msgs[i].flags & I2C_M_RD) && msgs[i].len > 1)
+            return FALSE;
+    
+    return TRUE;
+}
+
+static int
+I2CSafeTiming(I2CBusPtr b)
+{
+    int hold = b->HoldTime;
+    
+    b->HoldTime = b->HoldTimeSafe;
+    
+    return hold;
+}
+
+static void
+I2CKeepTiming(I2CBusPtr b, int hold, Bool r)
+{
+    if (r) {
+        b->Tuned = FALSE;
+        nv_info(b->card, "I2C bus \"%s\": falling back to %d us hold time\n", b->BusName, b->HoldTime);
+    }
+    else b->HoldTime = hold;
+}
+
+static Bool
+I2CTransfer(I2CDevPtr d, struct i2c_msg *msgs, int num)
+{
+    I2CBusPtr b = d->pI2CBus;
+    Bool r;
+    
+    if (b->port)
+        return i2c_transfer(&b->port->adapter, msgs, num) == num;
+    
+    r = I2CBitTransfer(d, msgs, num);
+    
+    if (!r && b->Tuned && I2CIsRead(msgs, num)) {
+        int hold = I2CSafeTiming(b);
+        
+        r = I2CBitTransfer(d, msgs, num);
+        
+        I2CKeepTiming(b, hold, r);
+    }
+    
+    return r;
+}
+
+static void
+I2CMessage(struct i2c_msg *msg, I2CDevPtr d, u16 flags, I2CByte *buf, int len)
+{
+    msg->addr = d->SlaveAddr >> 1;
+    msg->flags = flags;
+    msg->len = len;
+    msg->buf = buf;
+}
+
 /* These are the hardware independent I2C helper functions.
  * ========================================================
  */
@@ -367,15 +481,18 @@ Bool I2CAddress(I2CDevPtr d, I2CSlaveAddr addr)
  * and return true if the device responds. The slave address
  * must have the lsb set to reflect a read (1) or write (0) access.
  * Don't expect a read- or write-only device will respond otherwise.
+ *
+ * Port adapters can't send an address alone, a single byte is read.
  */
 
 Bool
 xf86I2CProbeAddress(I2CBusPtr b, I2CSlaveAddr addr)
 {
-    int r;
+    struct i2c_msg msg;
+    I2CByte dummy;
     I2CDevRec d;
     
-    d.DevName = STRDUP("Probing", sizeof("Probing"));
+    d.DevName = (char *)"Probing";
     d.BitTimeout = b->BitTimeout;
     d.ByteTimeout = b->ByteTimeout;
     d.AcknTimeout = b->AcknTimeout;
@@ -384,11 +501,9 @@ xf86I2CProbeAddress(I2CBusPtr b, I2CSlaveAddr addr)
     d.pI2CBus = b;
     d.NextDev = NULL;
     
-    r = b->I2CAddress(&d, addr);
+    I2CMessage(&msg, &d, addr & 1 ? I2C_M_RD : 0, &dummy, b->port ? 1 : 0);
     
-    if (r) b->I2CStop(&d);
-    
-    return r;
+    return I2CTransfer(&d, &msg, 1);
 }
 
 /* All functions below are related to devices and take the
@@ -419,33 +534,16 @@ xf86I2CWriteRead(I2CDevPtr d,
                  I2CByte *WriteBuffer, int nWrite,
                  I2CByte *ReadBuffer,  int nRead)
 {
-    Bool r = TRUE;
-    I2CBusPtr b = d->pI2CBus;
-    int s = 0;
-    
-    if (r && nWrite > 0) {
-        r = b->I2CAddress(d, d->SlaveAddr & ~1);
-        if (r) {
-            for (; nWrite > 0; WriteBuffer++, nWrite--)
-                if (!(r = b->I2CPutByte(d, *WriteBuffer)))
-                    break;
-            s++;
-        }
-    }
+    struct i2c_msg msgs[2];
+    int num = 0;
     
-    if (r && nRead > 0) {
-        r = b->I2CAddress(d, d->SlaveAddr | 1);
-        if (r) {
-            for (; nRead > 0; ReadBuffer++, nRead--)
-                if (!(r = b->I2CGetByte(d, ReadBuffer, nRead == 1)))
-                    break;
-            s++;
-        }
-    }
+    if (nWrite > 0)
+        I2CMessage(&msgs[num++], d, 0, WriteBuffer, nWrite);
     
-    if (s) b->I2CStop(d);
+    if (nRead > 0)
+        I2CMessage(&msgs[num++], d, I2C_M_RD, ReadBuffer, nRead);
     
-    return r;
+    return num ? I2CTransfer(d, msgs, num) : TRUE;
 }
 
 /* Read a byte, the only readable register of a device.
@@ -507,29 +605,29 @@ xf86I2CWriteByte(I2CDevPtr d, I2CByte subaddr, I2CByte byte)
 }
 
 /* Write bytes to subsequent registers determined by the
- * sub-address of the first register.
+ * sub-address of the first register. At most I2C_VEC_MAX bytes
+ * follow the sub-address.
  */
 
 Bool
 xf86I2CWriteBytes(I2CDevPtr d, I2CByte subaddr,
                   I2CByte *WriteBuffer, int nWrite)
 {
-    I2CBusPtr b = d->pI2CBus;
-    Bool r = TRUE;
+    struct i2c_msg msg;
+    I2CByte wb[I2C_VEC_MAX + 1];
     
-    if (nWrite > 0) {
-        r = b->I2CAddress(d, d->SlaveAddr & ~1);
-        if (r){
-            if ((r = b->I2CPutByte(d, subaddr)))
-                for (; nWrite > 0; WriteBuffer++, nWrite--)
-                    if (!(r = b->I2CPutByte(d, *WriteBuffer)))
-                        break;
-            
-            b->I2CStop(d);
-        }
-    }
+    if (nWrite <= 0)
+        return TRUE;
     
-    return r;
+    if (nWrite > I2C_VEC_MAX)
+        return FALSE;
+    
+    wb[0] = subaddr;
+    memcpy(&wb[1], WriteBuffer, nWrite);
+    
+    I2CMessage(&msg, d, 0, wb, nWrite + 1);
+    
+    return I2CTransfer(d, &msg, 1);
 }
 
 /* Write a word (high byte, then low byte) to one of the registers
@@ -550,36 +648,109 @@ xf86I2CWriteWord(I2CDevPtr d, I2CByte subaddr, unsigned short word)
 
 /* Write a vector of bytes to not adjacent registers. This vector is,
  * 1st byte sub-address, 2nd byte value, 3rd byte sub-address asf.
- * This function is intended to initialize devices. Note this function
- * exits immediately when an error occurs, some registers may
- * remain uninitialized.
+ * This function is intended to initialize devices. Pairs are written
+ * with repeated start conditions, I2C_VEC_MAX pairs per transfer.
+ * Note this function exits immediately when an error occurs, some
+ * registers may remain uninitialized.
  */
 
 Bool
 xf86I2CWriteVec(I2CDevPtr d, I2CByte *vec, int nValues)
+{
+    struct i2c_msg msgs[I2C_VEC_MAX];
+    int i, num;
+    
+    for (; nValues > 0; nValues -= num, vec += num * 2) {
+        num = nValues < I2C_VEC_MAX ? nValues : I2C_VEC_MAX;
+        
+        for (i = 0; i < num; i++)
+            I2CMessage(&msgs[i], d, 0, &vec[i * 2], 2);
+        
+        if (!I2CTransfer(d, msgs, num))
+            return FALSE;
+    }
+    
+    return TRUE;
+}
+
+/* Read a vector of not adjacent registers in one transaction. Each
+ * register is addressed by a combined write-read message started with
+ * a repeated start condition, only the last one is followed by a stop.
+ * Registers are read in the given order, so chips latching a high byte
+ * on a low byte read work as with separate reads. At most I2C_VEC_MAX
+ * registers are read at once, no memory is allocated.
+ */
+
+Bool
+xf86I2CReadVec(I2CDevPtr d, const I2CByte *regs, I2CByte *values, int nValues)
+{
+    struct i2c_msg msgs[I2C_VEC_MAX * 2];
+    int i;
+    
+    if (nValues <= 0 || nValues > I2C_VEC_MAX)
+        return FALSE;
+    
+    for (i = 0; i < nValues; i++) {
+        I2CMessage(&msgs[i * 2], d, 0, (I2CByte *)&regs[i], 1);
+        I2CMessage(&msgs[i * 2 + 1], d, I2C_M_RD, &values[i], 1);
+    }
+    
+    return I2CTransfer(d, msgs, nValues * 2);
+}
+
+/* Find the shortest hold time the bus and the slave work with. The
+ * register must hold a steady value (an ID register for example), it is
+ * read at configured timing first and then repeatedly while the hold
+ * time is binary searched between 1 us and the configured one. A
+ * quarter is added to the result as a margin. The bus is not tuned while
+ * searching, failed reads are not retried. Returns the new hold time
+ * or -1 when the slave doesn't answer at configured timing.
+ */
+
+#define I2C_TUNE_SAMPLES 4 /* matching reads required at each hold time */
+
+int
+xf86I2CTuneBus(I2CDevPtr d, I2CByte reg)
 {
     I2CBusPtr b = d->pI2CBus;
-    Bool r = TRUE;
-    int s = 0;
+    I2CByte ref, val;
+    int lo, hi, mid, i;
     
-    if (nValues > 0) {
-        for (; nValues > 0; nValues--, vec += 2) {
-            if (!(r = b->I2CAddress(d, d->SlaveAddr & ~1)))
-                break;
-            
-            s++;
-            
-            if (!(r = b->I2CPutByte(d, vec[0])))
-                break;
-            
-            if (!(r = b->I2CPutByte(d, vec[1])))
+    /* AUX channels have no bit timing */
+    if (b->port)
+        return b->HoldTime;
+    
+    b->HoldTime = b->HoldTimeSafe;
+    b->Tuned = FALSE;
+    
+    if (!xf86I2CReadByte(d, reg, &ref))
+        return -1;
+    
+    lo = 1;
+    hi = b->HoldTimeSafe;
+    
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        b->HoldTime = mid;
+        
+        for (i = 0; i < I2C_TUNE_SAMPLES; i++)
+            if (!xf86I2CReadByte(d, reg, &val) || val != ref)
                 break;
-        }
         
-        if (s > 0) b->I2CStop(d);
+        if (i == I2C_TUNE_SAMPLES)
+            hi = mid;
+        else
+            lo = mid + 1;
     }
     
-    return r;
+    hi += (hi + 3) / 4;
+    
+    b->HoldTime = hi < b->HoldTimeSafe ? hi : b->HoldTimeSafe;
+    b->Tuned = b->HoldTime < b->HoldTimeSafe;
+    
+    nv_debug(b->card, "I2C bus \"%s\": tuned to %d us hold time (configured %d us)\n", b->BusName, b->HoldTime, b->HoldTimeSafe);
+    
+    return b->HoldTime;
 }
 
 /* Administrative functions.
@@ -722,6 +893,9 @@ xf86CreateI2CBusRec(void)
         b->AcknTimeout = 5;
         b->StartTimeout = 5;
         b->RiseFallTime = RISEFALLTIME;
+        b->HoldTimeSafe = b->HoldTime;
+        b->Tuned = FALSE;
+        b->port = NULL;
     }
     
     return b;
@@ -818,6 +992,8 @@ xf86I2CBusInit(I2CBusPtr b)
         b->I2CUDelay = I2CUDelay;
     
     if (b->HoldTime < 2) b->HoldTime = 5;
+    b->HoldTimeSafe = b->HoldTime;
+    b->Tuned = FALSE;
     if (b->BitTimeout <= 0) b->BitTimeout = b->HoldTime;
     if (b->ByteTimeout <= 0) b->ByteTimeout = b->HoldTime;
     if (b->AcknTimeout <= 0) b->AcknTimeout = b->HoldTime;
@@ -12,6 +12,8 @@
 typedef unsigned char  I2CByte;
 typedef unsigned short I2CSlaveAddr;
 
+#define I2C_VEC_MAX 16 /* registers read by a single xf86I2CReadVec transaction */
+
 typedef struct _I2CBusRec *I2CBusPtr;
 typedef struct _I2CDevRec *I2CDevPtr;
 
@@ -34,10 +36,13 @@ typedef struct _I2CBusRec {
     Bool		(*I2CGetByte)(I2CDevPtr d, I2CByte *data, Bool);
 
     nouveau_device *card;
+    struct nouveau_i2c_port *port;  /* when set, transfers are passed to the port adapter (AUX) */
     
     DevUnion	DriverPrivate;
 
     int         HoldTime; 	/* 1 / bus clock frequency, 5 or 2 usec */
+    int         HoldTimeSafe;   /* configured HoldTime, see xf86I2CTuneBus */
+    Bool        Tuned;          /* HoldTime was lowered below HoldTimeSafe */
 
     int			BitTimeout;	/* usec */
     int 		ByteTimeout;	/* usec */
@@ -95,5 +100,7 @@ Bool 		xf86I2CWriteByte(I2CDevPtr d, I2CByte subaddr, I2CByte byte);
 Bool 		xf86I2CWriteBytes(I2CDevPtr d, I2CByte subaddr, I2CByte *WriteBuffer, int nWrite);
 Bool 		xf86I2CWriteWord(I2CDevPtr d, I2CByte subaddr, unsigned short word);
 Bool 		xf86I2CWriteVec(I2CDevPtr d, I2CByte *vec, int nValues);
+Bool 		xf86I2CReadVec(I2CDevPtr d, const I2CByte *regs, I2CByte *values, int nValues);
+int 		xf86I2CTuneBus(I2CDevPtr d, I2CByte reg);
 
 #endif /*_XF86I2C_H */
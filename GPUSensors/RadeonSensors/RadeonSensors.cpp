@@ -25,7 +25,7 @@
 #define super GPUSensors
 OSDefineMetaClassAndStructors(RadeonSensors, GPUSensors)
 
-bool RadeonSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
+bool RadeonSensors::readSensorValue(FakeSMCSensor *sensor, float *outValue)
 {
     switch (sensor->getGroup()) {
         case kFakeSMCTemperatureSensor:
@@ -48,28 +48,6 @@ bool RadeonSensors::shouldWaitForAccelerator()
     return true;
 }
 
-bool RadeonSensors::probIsAcceleratorAlreadyLoaded()
-{
-    bool acceleratorFound = false;
-
-    if (OSDictionary *matching = serviceMatching("IOAccelerator")) {
-        if (OSIterator *iterator = getMatchingServices(matching)) {
-            while (IOService *service = (IOService*)iterator->getNextObject()) {
-                if (pciDevice == service->getParentEntry(gIOServicePlane)) {
-                    acceleratorFound = true;
-                    break;
-                }
-            }
-
-            OSSafeReleaseNULL(iterator);
-        }
-        
-        OSSafeReleaseNULL(matching);
-    }
-
-    return acceleratorFound;
-}
-
 bool RadeonSensors::managedStart(IOService *provider)
 {
     if (!(card.pdev = pciDevice)) {
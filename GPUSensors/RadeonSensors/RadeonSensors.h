@@ -19,9 +19,8 @@ private:
     radeon_device       card;
     
 protected:	
-    virtual bool        willReadSensorValue(FakeSMCSensor *sensor, float* value);
+    virtual bool        readSensorValue(FakeSMCSensor *sensor, float* value);
     virtual bool        shouldWaitForAccelerator();
-    virtual bool        probIsAcceleratorAlreadyLoaded();
 	virtual bool        managedStart(IOService *provider);
     
 public:
@@ -0,0 +1,178 @@
+//
+//  CPUSensorsTests.cpp
+//  HWSensorsTests
+//
+//  Counter arithmetic from CPUSensorsMath.h driven by simulated MSR samples.
+//
+
+#include "HWSensorsTests.h"
+#include "CPUSensorsMath.h"
+
+#define kCoreCStates    4   // C1 (derived), C3, C6, C7 like kCPUSensorsCoreCStates
+
+// One core as seen through its free running MSRs, counters start at arbitrary points
+struct SimulatedCore {
+    UInt64 tsc;
+    UInt64 c0;
+    UInt64 cstate[kCoreCStates];
+
+    // Advances all counters by one interval split between C0, C1 and the deeper states (in TSC ticks)
+    void run(UInt64 c0_ticks, UInt64 c1_ticks, UInt64 c3_ticks, UInt64 c6_ticks, UInt64 c7_ticks)
+    {
+        tsc += c0_ticks + c1_ticks + c3_ticks + c6_ticks + c7_ticks;
+        c0 += c0_ticks;
+        cstate[1] += c3_ticks;
+        cstate[2] += c6_ticks;
+        cstate[3] += c7_ticks;
+    }
+};
+
+static bool sample_residency(const SimulatedCore &before, const SimulatedCore &after, UInt32 mask, float *residency)
+{
+    UInt64 deltas[kCoreCStates];
+
+    for (UInt8 state = 1; state < kCoreCStates; state++)
+        deltas[state] = get_counter_delta(before.cstate[state], after.cstate[state]);
+
+    return get_core_residency(get_counter_delta(before.tsc, after.tsc), get_counter_delta(before.c0, after.c0), deltas, mask, kCoreCStates, residency);
+}
+
+HWSENSORS_TEST(testCounterDeltaWrapsAt64Bits)
+{
+    XCTAssertEqual(get_counter_delta(100, 250), 150);
+    XCTAssertEqual(get_counter_delta(UINT64_MAX - 9, 20), 30);
+    XCTAssertEqual(get_counter_delta(5, 5), 0);
+}
+
+HWSENSORS_TEST(testCounterDeltaMaskedFor48BitCounters)
+{
+    // Fixed counters are 48 bits wide, the caller masks the 64 bit difference
+    UInt64 mask = (1ULL << 48) - 1;
+    UInt64 before = mask - 99;
+    UInt64 after = 400;
+
+    XCTAssertEqual(get_counter_delta(before, after) & mask, 500);
+}
+
+HWSENSORS_TEST(testCounterDelta32WrapsAt32Bits)
+{
+    // MSR_PKG_ENERGY_STATUS read as 32 bits across a wrap
+    XCTAssertEqual(get_counter_delta32(0xFFFFFF00, 0x00000100), 0x200);
+    XCTAssertEqual(get_counter_delta32(0x1000, 0x2000), 0x1000);
+}
+
+HWSENSORS_TEST(testResidencyPercent)
+{
+    XCTAssertEqualWithAccuracy(get_residency_percent(25, 100), 25.0f, 0.001f);
+    XCTAssertEqualWithAccuracy(get_residency_percent(0, 100), 0.0f, 0.001f);
+    // TSC did not move, nothing to report
+    XCTAssertEqualWithAccuracy(get_residency_percent(10, 0), 0.0f, 0.001f);
+    // Counters are read one after another, a state counter may run slightly ahead of the TSC
+    XCTAssertEqualWithAccuracy(get_residency_percent(101, 100), 100.0f, 0.001f);
+}
+
+HWSENSORS_TEST(testCoreResidencyDerivesC1)
+{
+    SimulatedCore before = { 1000, 200, { 0, 50, 60, 70 } };
+    SimulatedCore after = before;
+
+    // 20% C0, 30% C1, 10% C3, 25% C6, 15% C7
+    after.run(200000, 300000, 100000, 250000, 150000);
+
+    float residency[kCoreCStates] = { 0 };
+
+    XCTAssertTrue(sample_residency(before, after, 0xF, residency));
+    XCTAssertEqualWithAccuracy(residency[0], 30.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[1], 10.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[2], 25.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[3], 15.0f, 0.01f);
+}
+
+HWSENSORS_TEST(testCoreResidencyAcrossCounterWrap)
+{
+    SimulatedCore before = { UINT64_MAX - 1000, UINT64_MAX - 10, { 0, UINT64_MAX, UINT64_MAX - 500, 3 } };
+    SimulatedCore after = before;
+
+    after.run(100000, 400000, 0, 500000, 0);
+
+    float residency[kCoreCStates] = { 0 };
+
+    XCTAssertTrue(sample_residency(before, after, 0xF, residency));
+    XCTAssertEqualWithAccuracy(residency[0], 40.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[2], 50.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[3], 0.0f, 0.01f);
+}
+
+HWSENSORS_TEST(testCoreResidencySkipsUnsupportedStates)
+{
+    // Skylake-X: C3 and C7 counters are not read, their time shows up in C1
+    SimulatedCore before = { 0, 0, { 0, 0, 0, 0 } };
+    SimulatedCore after = before;
+
+    after.run(100000, 100000, 200000, 400000, 200000);
+
+    float residency[kCoreCStates] = { -1, -1, -1, -1 };
+
+    XCTAssertTrue(sample_residency(before, after, 0x1 | 0x4, residency));
+    XCTAssertEqualWithAccuracy(residency[0], 50.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[1], -1.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[2], 40.0f, 0.01f);
+    XCTAssertEqualWithAccuracy(residency[3], -1.0f, 0.01f);
+}
+
+HWSENSORS_TEST(testCoreResidencyClampsC1)
+{
+    // Counters sampled slightly apart can add up to more than the TSC interval
+    SimulatedCore before = { 0, 0, { 0, 0, 0, 0 } };
+    SimulatedCore after = before;
+
+    after.run(300000, 0, 0, 700000, 0);
+    after.cstate[2] += 5000;
+
+    float residency[kCoreCStates] = { 0 };
+
+    XCTAssertTrue(sample_residency(before, after, 0xF, residency));
+    XCTAssertEqualWithAccuracy(residency[0], 0.0f, 0.001f);
+    XCTAssertLessThanOrEqual(residency[2], 100.0f);
+}
+
+HWSENSORS_TEST(testCoreResidencyWithoutTscProgress)
+{
+    SimulatedCore sample = { 42, 7, { 0, 1, 2, 3 } };
+    float residency[kCoreCStates] = { 5, 5, 5, 5 };
+
+    XCTAssertFalse(sample_residency(sample, sample, 0xF, residency));
+    XCTAssertEqualWithAccuracy(residency[0], 5.0f, 0.001f);
+}
+
+HWSENSORS_TEST(testThermalThresholdsAroundReadout)
+{
+    // 30 degrees below Tjmax with a 2 degree band: threshold #1 at 28, #2 at 32
+    UInt64 msr = get_thermal_thresholds(0, 30, 2);
+
+    XCTAssertEqual((msr >> 8) & 0x7F, 28);
+    XCTAssertEqual((msr >> 16) & 0x7F, 32);
+}
+
+HWSENSORS_TEST(testThermalThresholdsKeepOtherFields)
+{
+    // High/low temperature, PROCHOT, critical and threshold interrupt enables (bits 0-4, 15, 23, 24) stay as programmed
+    UInt64 enables = 0x1F | (1ULL << 15) | (1ULL << 23) | (1ULL << 24);
+    UInt64 msr = get_thermal_thresholds(enables | (0x7FULL << 8) | (0x7FULL << 16), 50, 2);
+
+    XCTAssertEqual(msr & ~((0x7FULL << 8) | (0x7FULL << 16)), enables);
+    XCTAssertEqual((msr >> 8) & 0x7F, 48);
+    XCTAssertEqual((msr >> 16) & 0x7F, 52);
+}
+
+HWSENSORS_TEST(testThermalThresholdsClampAtEncodingLimits)
+{
+    // At Tjmax the hot threshold stays at 0, far below it the cold threshold saturates at 127
+    UInt64 hot = get_thermal_thresholds(0, 1, 2);
+    UInt64 cold = get_thermal_thresholds(0, 126, 2);
+
+    XCTAssertEqual((hot >> 8) & 0x7F, 0);
+    XCTAssertEqual((hot >> 16) & 0x7F, 3);
+    XCTAssertEqual((cold >> 8) & 0x7F, 124);
+    XCTAssertEqual((cold >> 16) & 0x7F, 0x7F);
+}
@@ -0,0 +1,273 @@
+//
+//  FanControlTests.cpp
+//  HWSensorsTests
+//
+//  Fan target controller from LPCSensorsControl.h closing the loop over a simulated
+//  fan with inertia and a quantized tachometer, compared with the controller it replaced.
+//
+
+#include "HWSensorsTests.h"
+#include "LPCSensorsControl.h"
+
+#include <string.h>
+
+#define kSimulationStep     0.01    // s
+#define kSimulationLength   60.0    // s, the control window
+
+// Fan with first order inertia, spinning offset + gain * PWM above its stall PWM
+struct SimulatedFan {
+    const char *name;
+    float gain;         // RPM per percent
+    float offset;       // RPM
+    float stall;        // percent
+    float inertia;      // time constant in s
+    float load;         // RPM lost to a disturbance (blocked intake)
+
+    double rpm;
+    double sampled;     // time of the last tachometer update
+    float tach;
+
+    float steady(float pwm) const
+    {
+        return pwm < stall ? 0 : offset + gain * pwm - load;
+    }
+
+    void run(float pwm, double dt)
+    {
+        rpm += (steady(pwm) - rpm) * dt / inertia;
+    }
+
+    // Tachometer counts two pulses per revolution at 22.5 kHz, the chip refreshes it once a second
+    float read(double time)
+    {
+        if (time - sampled >= 1.0) {
+            UInt32 count = rpm > 1 ? (UInt32)(1.35e6 / (2 * rpm) + 0.5) : 0;
+
+            tach = count ? 1.35e6f / (2 * count) : 0;
+            sampled = time;
+        }
+
+        return tach;
+    }
+};
+
+// LPCSensors before the rework: incremental PID on a fixed 2 s period, unbounded integral
+struct LegacyControl {
+    float control, target, prevError;
+    double integral;
+
+    void start(float newTarget, float current)
+    {
+        target = newTarget;
+        control = current;
+        prevError = 0;
+        integral = 0;
+    }
+
+    double sample(float value)
+    {
+        float error = target - value;
+        double derivative = (error - prevError) / 2.0;
+
+        integral += error * 2.0;
+        prevError = error;
+
+        control = CLIP_CONTROL(control + error * 0.012 + integral * 0.00001 + derivative * 0.006);
+
+        return 2.0;
+    }
+};
+
+struct ControlResult {
+    double settle;      // s until the speed stays within kLPCSensorsControlSettledError of target
+    double overshoot;   // percent of the step
+    int samples;
+};
+
+// Runs one control window. With disturbance the load changes half way, settle is measured from there
+template <class Controller>
+static ControlResult run_control(Controller &start, SimulatedFan &fan, float target, float pwm, bool disturbance)
+{
+    ControlResult result = { -1, 0, 0 };
+    double from = fan.rpm, peak = fan.rpm, next = 1.0, settled = -1;
+    bool up = target > from;
+
+    // Every window starts its own clock, the tachometer is fresh when control starts
+    fan.sampled = -1;
+    start(target, pwm, fan.read(0));
+
+    for (double time = 0; time < kSimulationLength; time += kSimulationStep) {
+        if (disturbance && time >= kSimulationLength / 2 && !fan.load) {
+            fan.load = 200;
+            settled = -1;
+            peak = fan.rpm;
+        }
+
+        fan.run(start.output(), kSimulationStep);
+
+        if (time >= next) {
+            next = time + start.step(fan.read(time));
+            result.samples++;
+        }
+
+        if (up ? fan.rpm > peak : fan.rpm < peak)
+            peak = fan.rpm;
+
+        if (CONTROL_ABS(fan.rpm - target) > target * kLPCSensorsControlSettledError)
+            settled = -1;
+        else if (settled < 0)
+            settled = time;
+    }
+
+    if (!disturbance) {
+        double beyond = up ? peak - target : target - peak;
+        result.overshoot = beyond > 0 ? 100 * beyond / CONTROL_ABS(target - from) : 0;
+    }
+
+    result.settle = settled < 0 ? kSimulationLength : disturbance ? settled - kSimulationLength / 2 : settled;
+
+    return result;
+}
+
+struct CurrentRunner {
+    LPCSensorsTachometerControl fan;
+
+    CurrentRunner() { memset(&fan, 0, sizeof(fan)); }
+    void operator()(float target, float pwm, float value) { lpc_control_start(&fan, target, pwm, value); }
+    float output() const { return fan.control; }
+    double step(float value) { lpc_control_sample(&fan, value); return fan.interval / 1000.0; }
+};
+
+struct LegacyRunner {
+    LegacyControl control;
+
+    void operator()(float target, float pwm, float value) { control.start(target, pwm); }
+    float output() const { return control.control; }
+    double step(float value) { return control.sample(value); }
+};
+
+static const SimulatedFan simulatedFans[] = {
+    { "80 mm case",     15, 300, 20, 0.8f, 0, 0, 0, 0 },
+    { "120 mm case",    20, 200, 20, 1.5f, 0, 0, 0, 0 },
+    { "CPU tower",      30, 400, 15, 3.0f, 0, 0, 0, 0 },
+};
+
+#define kSimulatedFans  (sizeof(simulatedFans) / sizeof(simulatedFans[0]))
+
+enum { kStepUp, kStepDown, kStepLearned, kDisturbance, kScenarios };
+
+static const char *scenarioNames[kScenarios] = { "40->65% up", "70->45% down", "learned", "load +200" };
+
+// Steps the fan between the speeds it reaches at two PWM values. The learned scenario repeats
+// the step up with the table filled by a previous window, the disturbance one runs at target
+template <class Runner>
+static ControlResult run_scenario(const SimulatedFan &model, int scenario)
+{
+    SimulatedFan fan = model;
+    Runner runner;
+
+    float pwm = scenario == kStepDown ? 70 : 40;
+    float target = fan.steady(scenario == kStepDown ? 45 : 65);
+
+    fan.rpm = fan.steady(pwm);
+
+    if (scenario == kStepLearned) {
+        run_control(runner, fan, target, pwm, false);
+        run_control(runner, fan, fan.steady(pwm), runner.output(), false);
+    }
+    else if (scenario == kDisturbance) {
+        fan.rpm = target;
+        pwm = 65;
+    }
+
+    return run_control(runner, fan, target, scenario == kStepLearned ? runner.output() : pwm, scenario == kDisturbance);
+}
+
+HWSENSORS_TEST(testFanControlSettlesFasterThanLegacy)
+{
+    double legacyTotal = 0, currentTotal = 0;
+
+    printf("    %-12s %-13s %16s %16s %9s\n", "fan", "scenario", "legacy settle/os", "new settle/os", "samples");
+
+    for (unsigned int model = 0; model < kSimulatedFans; model++) {
+        for (int scenario = 0; scenario < kScenarios; scenario++) {
+            ControlResult legacy = run_scenario<LegacyRunner>(simulatedFans[model], scenario);
+            ControlResult current = run_scenario<CurrentRunner>(simulatedFans[model], scenario);
+
+            printf("    %-12s %-13s %7.1fs %6.1f%% %7.1fs %6.1f%% %4d/%-4d\n", simulatedFans[model].name, scenarioNames[scenario],
+                   legacy.settle, legacy.overshoot, current.settle, current.overshoot, legacy.samples, current.samples);
+
+            legacyTotal += legacy.settle;
+            currentTotal += current.settle;
+
+            // Settles within a quarter of the window. A disturbance is seen late once sampling backed
+            // off to 8 s, the slowest fan overshoots most when the feed-forward is already right
+            XCTAssertLessThanOrEqual(current.settle, kSimulationLength / 4);
+            XCTAssertLessThanOrEqual(current.overshoot, 20);
+        }
+    }
+
+    printf("    total settle %.1fs legacy, %.1fs new\n", legacyTotal, currentTotal);
+
+    XCTAssertLessThanOrEqual(currentTotal * 2, legacyTotal);
+}
+
+HWSENSORS_TEST(testFanControlBacksOffWhenSettled)
+{
+    CurrentRunner runner;
+    SimulatedFan fan = simulatedFans[1];
+
+    fan.rpm = fan.steady(40);
+
+    ControlResult result = run_control(runner, fan, fan.steady(65), 40, false);
+
+    // 1 s sampling while converging, then 2, 4 and 8 s
+    XCTAssertEqual(runner.fan.interval, kLPCSensorsControlMaxInterval);
+    XCTAssertLessThanOrEqual(result.samples, 25);
+}
+
+HWSENSORS_TEST(testFanControlIntegralIsClamped)
+{
+    CurrentRunner runner;
+    SimulatedFan fan = simulatedFans[0];
+
+    // Target out of reach: output saturates, the integral stops growing
+    fan.rpm = fan.steady(50);
+    run_control(runner, fan, fan.steady(100) * 1.5f, 50, false);
+
+    XCTAssertEqualWithAccuracy(runner.fan.control, 100, 0.01);
+    XCTAssertLessThanOrEqual(runner.fan.integral * kLPCSensorsKi * runner.fan.gain, kLPCSensorsControlIntegralLimit + 0.01);
+
+    // Back to a reachable target, the wound up integral does not hold the fan at full speed
+    float target = fan.steady(50);
+    ControlResult result = run_control(runner, fan, target, runner.output(), false);
+
+    XCTAssertLessThanOrEqual(result.settle, kSimulationLength / 4);
+}
+
+HWSENSORS_TEST(testFanControlFeedForwardTable)
+{
+    LPCSensorsTachometerControl fan;
+
+    memset(&fan, 0, sizeof(fan));
+
+    // Nothing learned
+    XCTAssertEqualWithAccuracy(lpc_control_feed_forward(&fan, 1000), -1, 0.001);
+
+    lpc_control_learn(&fan, 40, 1000);
+    lpc_control_learn(&fan, 61, 1400);
+    lpc_control_learn(&fan, 75, 1700);     // too far from a table point
+
+    XCTAssertEqualWithAccuracy(fan.feedForward[4], 1000, 0.001);
+    XCTAssertEqualWithAccuracy(fan.feedForward[6], 1400, 0.001);
+    XCTAssertEqualWithAccuracy(fan.feedForward[7], 0, 0.001);
+
+    // Interpolated between learned points, outside of them the PID starts cold
+    XCTAssertEqualWithAccuracy(lpc_control_feed_forward(&fan, 1200), 50, 0.001);
+    XCTAssertEqualWithAccuracy(lpc_control_feed_forward(&fan, 900), -1, 0.001);
+    XCTAssertEqualWithAccuracy(lpc_control_feed_forward(&fan, 1500), -1, 0.001);
+
+    // Learning again averages with the previous value
+    lpc_control_learn(&fan, 40, 1200);
+    XCTAssertEqualWithAccuracy(fan.feedForward[4], 1050, 0.001);
+}
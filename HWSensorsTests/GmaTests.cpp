@@ -0,0 +1,207 @@
+//
+//  GmaTests.cpp
+//  HWSensorsTests
+//
+//  Two phase GMA thermal sensor readout from GmaThermal.h run against a model
+//  of the MCHBAR thermal registers, compared with the polling loop it replaced.
+//
+
+#include "HWSensorsTests.h"
+#include "GmaThermal.h"
+
+#include <string.h>
+
+#define kNanosecondsPerMillisecond  1000000ULL
+
+// MCHBAR thermal registers. Hardware takes the start command from TIC1, clears the valid bit
+// and reports TR1 (150 - degrees C) conversionTime ms later, never if the sensor is stuck
+struct SimulatedGmaThermal {
+    UInt8       mmio[0x2000];
+    double      conversionTime;
+    double      started;
+    UInt8       reading;
+    bool        stuck;
+    int         starts;
+
+    SimulatedGmaThermal(double conversion, float temperature) :
+        conversionTime(conversion), started(-1), reading((UInt8)(150 - temperature)), stuck(false), starts(0)
+    {
+        memset(mmio, 0, sizeof(mmio));
+    }
+
+    void run(double now)
+    {
+        if (OSReadLittleInt32(mmio, TIC1) & GMA_THERMAL_START) {
+            OSWriteLittleInt32(mmio, TIC1, 0);
+            mmio[TSS1 + 1] &= ~(GMA_THERMAL_VALID >> 8);
+            started = now;
+            starts++;
+        }
+
+        if (started >= 0 && !stuck && now - started >= conversionTime) {
+            mmio[TR1] = reading;
+            mmio[TSS1 + 1] |= GMA_THERMAL_VALID >> 8;
+            started = -1;
+        }
+    }
+};
+
+// One conversion timer tick at now ms, the hardware runs up to it and takes the new command
+static void gma_tick(SimulatedGmaThermal &chip, GmaThermalState &state, double now, int *staleChanges)
+{
+    chip.run(now);
+    gma_thermal_convert(&state, chip.mmio, (UInt64)(now * kNanosecondsPerMillisecond));
+    chip.run(now);
+
+    if (gma_thermal_update_stale(&state, (UInt64)(now * kNanosecondsPerMillisecond)) && staleChanges)
+        (*staleChanges)++;
+}
+
+// GmaSensors before the rework: start a conversion on each key read and poll the valid bit
+// every 10 ms up to 1000 times. Returns the time the SMC read was blocked, in ms
+static double legacy_read(SimulatedGmaThermal &chip, double now, float *value)
+{
+    volatile UInt8 *mmio_base = chip.mmio;
+    double blocked = 0;
+
+    OUTVID(TIC1, GMA_THERMAL_START);
+    chip.run(now);
+
+    for (int i = 0; i < 1000; i++) {
+        if (INVID16(TSS1) & GMA_THERMAL_VALID)
+            break;
+
+        blocked += 10;
+        chip.run(now + blocked);
+    }
+
+    *value = (float)(150 - INVID8(TR1));
+
+    return blocked;
+}
+
+HWSENSORS_TEST(testGmaTwoPhaseReadout)
+{
+    SimulatedGmaThermal chip(30, 62);
+    GmaThermalState state;
+    int staleChanges = 0;
+
+    memset(&state, 0, sizeof(state));
+    state.temperatureStale = true;
+
+    // First tick only starts a conversion, nothing to serve yet
+    gma_tick(chip, state, 0, &staleChanges);
+
+    XCTAssertTrue(state.conversionPending);
+    XCTAssertEqual(state.temperatureTime, 0);
+    XCTAssertTrue(state.temperatureStale);
+
+    // Next one collects it and starts another
+    gma_tick(chip, state, kGmaSensorsConversionPeriod, &staleChanges);
+
+    XCTAssertEqualWithAccuracy(state.temperature, 62, 0.001);
+    XCTAssertEqual(state.temperatureTime, kGmaSensorsConversionPeriod * kNanosecondsPerMillisecond);
+    XCTAssertFalse(state.temperatureStale);
+    XCTAssertEqual(staleChanges, 1);
+
+    // A change is served one tick later, each tick runs exactly one conversion
+    chip.reading = 150 - 71;
+
+    for (int tick = 2; tick < 10; tick++)
+        gma_tick(chip, state, tick * kGmaSensorsConversionPeriod, &staleChanges);
+
+    XCTAssertEqualWithAccuracy(state.temperature, 71, 0.001);
+    XCTAssertEqual(chip.starts, 10);
+    XCTAssertEqual(staleChanges, 1);
+}
+
+HWSENSORS_TEST(testGmaStuckConversionGoesStale)
+{
+    SimulatedGmaThermal chip(30, 55);
+    GmaThermalState state;
+    int staleChanges = 0;
+    double now = 0;
+
+    memset(&state, 0, sizeof(state));
+    state.temperatureStale = true;
+
+    gma_tick(chip, state, now, &staleChanges);
+    gma_tick(chip, state, now += kGmaSensorsConversionPeriod, &staleChanges);
+
+    XCTAssertFalse(state.temperatureStale);
+
+    chip.stuck = true;
+    int starts = chip.starts;
+
+    // Last value is kept and flagged stale once older than kGmaSensorsStaleTime
+    for (int tick = 0; tick < 25; tick++) {
+        gma_tick(chip, state, now += kGmaSensorsConversionPeriod, &staleChanges);
+
+        if (tick == 3)
+            XCTAssertFalse(state.temperatureStale);
+    }
+
+    XCTAssertTrue(state.temperatureStale);
+    XCTAssertEqualWithAccuracy(state.temperature, 55, 0.001);
+    XCTAssertEqual(staleChanges, 2);
+
+    // Conversion is restarted every kGmaSensorsConversionMaxTicks ticks, not each one
+    XCTAssertEqual(chip.starts - starts, 25 / kGmaSensorsConversionMaxTicks);
+
+    // Sensor recovers, the restarted conversion brings the flag back
+    chip.stuck = false;
+
+    for (int tick = 0; tick < kGmaSensorsConversionMaxTicks + 1; tick++)
+        gma_tick(chip, state, now += kGmaSensorsConversionPeriod, &staleChanges);
+
+    XCTAssertFalse(state.temperatureStale);
+    XCTAssertEqual(staleChanges, 3);
+}
+
+HWSENSORS_TEST(testGmaReadLatencyAgainstLegacyLoop)
+{
+    const double conversions[] = { 5, 30, 120 };
+
+    printf("    %-12s %16s %16s %14s\n", "conversion", "legacy blocked", "timer blocked", "value age max");
+
+    for (size_t i = 0; i < sizeof(conversions) / sizeof(conversions[0]); i++) {
+        SimulatedGmaThermal legacyChip(conversions[i], 60), chip(conversions[i], 60);
+        GmaThermalState state;
+        float value;
+
+        memset(&state, 0, sizeof(state));
+
+        double blocked = legacy_read(legacyChip, 0, &value);
+
+        XCTAssertEqualWithAccuracy(value, 60, 0.001);
+
+        // Key reads only copy the cached value, it is less than a tick old
+        double age = 0;
+
+        for (int tick = 0; tick < 10; tick++) {
+            gma_tick(chip, state, tick * kGmaSensorsConversionPeriod, NULL);
+
+            double now = (tick + 1) * kGmaSensorsConversionPeriod - 1;
+
+            if (state.temperatureTime && now - state.temperatureTime / kNanosecondsPerMillisecond > age)
+                age = now - state.temperatureTime / kNanosecondsPerMillisecond;
+        }
+
+        printf("    %10.0fms %14.0fms %14.0fms %12.0fms\n", conversions[i], blocked, 0.0, age);
+
+        XCTAssertTrue(blocked >= conversions[i]);
+        XCTAssertLessThanOrEqual(age, kGmaSensorsConversionPeriod);
+    }
+
+    // A stuck sensor held the SMC read for 10 s
+    SimulatedGmaThermal stuck(30, 60);
+    float value;
+
+    stuck.stuck = true;
+
+    double blocked = legacy_read(stuck, 0, &value);
+
+    printf("    %12s %14.0fms %14.0fms %14s\n", "stuck", blocked, 0.0, "stale flag");
+
+    XCTAssertEqual(blocked, 10000);
+}
@@ -0,0 +1,51 @@
+//
+//  HWSensorsTests.cpp
+//  HWSensorsTests
+//
+//  Runs every registered test case, the exit status is the number of failures.
+//
+
+#include "HWSensorsTests.h"
+
+#include <string.h>
+
+int HWSensorsTestFailures = 0;
+
+static HWSensorsTestCase *tests = NULL;
+static HWSensorsTestCase **last = &tests;
+
+// Registered from static constructors, runs in link order and file order within a file
+HWSensorsTestCase::HWSensorsTestCase(const char *name, HWSensorsTestFunction function) : name(name), function(function), next(NULL)
+{
+    *last = this;
+    last = &next;
+}
+
+int main(int argc, const char *argv[])
+{
+    int count = 0;
+
+    for (HWSensorsTestCase *test = tests; test; test = test->next) {
+        // Optional arguments select tests by name prefix
+        if (argc > 1) {
+            bool selected = false;
+
+            for (int i = 1; i < argc && !selected; i++)
+                selected = !strncmp(test->name, argv[i], strlen(argv[i]));
+
+            if (!selected)
+                continue;
+        }
+
+        int failures = HWSensorsTestFailures;
+
+        test->function();
+        count++;
+
+        printf("%s %s\n", HWSensorsTestFailures > failures ? "FAIL" : "ok  ", test->name);
+    }
+
+    printf("%d tests, %d failures\n", count, HWSensorsTestFailures);
+
+    return HWSensorsTestFailures ? 1 : 0;
+}
@@ -0,0 +1,62 @@
+//
+//  HWSensorsTests.h
+//  HWSensorsTests
+//
+//  Minimal host test runner for the IOKit free parts of the plugins.
+//  Assertions follow the XCTest names used by HWMonitorTests.
+//
+
+#ifndef HWSensorsTests_h
+#define HWSensorsTests_h
+
+#include <stdio.h>
+#include <math.h>
+
+typedef void (*HWSensorsTestFunction)(void);
+
+struct HWSensorsTestCase {
+    const char *name;
+    HWSensorsTestFunction function;
+    HWSensorsTestCase *next;
+
+    HWSensorsTestCase(const char *name, HWSensorsTestFunction function);
+};
+
+extern int HWSensorsTestFailures;
+
+#define HWSENSORS_TEST(name) \
+    static void name(void); \
+    static HWSensorsTestCase name##Case(#name, name); \
+    static void name(void)
+
+#define HWSENSORS_FAIL(format, ...) \
+    do { \
+        HWSensorsTestFailures++; \
+        fprintf(stderr, "%s:%d: " format "\n", __FILE__, __LINE__, ##__VA_ARGS__); \
+    } while (0)
+
+#define XCTAssertTrue(expression) \
+    do { if (!(expression)) HWSENSORS_FAIL("XCTAssertTrue failed: %s", #expression); } while (0)
+
+#define XCTAssertFalse(expression) \
+    do { if ((expression)) HWSENSORS_FAIL("XCTAssertFalse failed: %s", #expression); } while (0)
+
+#define XCTAssertEqual(a, b) \
+    do { \
+        long long _a = (long long)(a), _b = (long long)(b); \
+        if (_a != _b) HWSENSORS_FAIL("XCTAssertEqual failed: %s (%lld) != %s (%lld)", #a, _a, #b, _b); \
+    } while (0)
+
+#define XCTAssertEqualWithAccuracy(a, b, accuracy) \
+    do { \
+        double _a = (double)(a), _b = (double)(b); \
+        if (fabs(_a - _b) > (double)(accuracy)) HWSENSORS_FAIL("XCTAssertEqualWithAccuracy failed: %s (%g) != %s (%g)", #a, _a, #b, _b); \
+    } while (0)
+
+#define XCTAssertLessThanOrEqual(a, b) \
+    do { \
+        double _a = (double)(a), _b = (double)(b); \
+        if (!(_a <= _b)) HWSENSORS_FAIL("XCTAssertLessThanOrEqual failed: %s (%g) > %s (%g)", #a, _a, #b, _b); \
+    } while (0)
+
+#endif
@@ -0,0 +1,340 @@
+//
+//  I2CModels.cpp
+//  HWSensorsTests
+//
+//  Bit level bus and slave models behind the xf86 bit-bang hooks.
+//
+
+#include "I2CModels.h"
+
+#include <string.h>
+
+SimulatedI2CSlave::SimulatedI2CSlave(UInt8 address) :
+    address(address), pointer(0), autoIncrement(true), outputDelay(0), stretch(0), minimumHigh(0), starts(0), stops(0),
+    sdaLow(false), sclLow(false), state(kIdle), bits(0), shift(0), reading(false), pointerSet(false), acked(false),
+    risen(false), risenSda(false), risenAt(0),
+    sdaPending(false), sdaNext(false), sdaAt(0), sclUntil(0)
+{
+    memset(registers, 0, sizeof(registers));
+}
+
+// SDA follows SCL falling edge after the output delay, a newer value replaces one not yet out
+void SimulatedI2CSlave::output(double now, bool low)
+{
+    sdaPending = true;
+    sdaNext = low;
+    sdaAt = now + outputDelay;
+}
+
+void SimulatedI2CSlave::start()
+{
+    starts++;
+    risen = false;
+    state = kAddress;
+    bits = 0;
+    shift = 0;
+    sdaPending = false;
+    sdaLow = false;
+}
+
+void SimulatedI2CSlave::stop()
+{
+    stops++;
+    risen = false;
+    state = kIdle;
+    sdaPending = false;
+    sdaLow = false;
+}
+
+// Data is sampled on the rising edge but the bit only counts once SCL stayed high long enough
+void SimulatedI2CSlave::rise(double now, bool sda)
+{
+    risen = true;
+    risenSda = sda;
+    risenAt = now;
+}
+
+void SimulatedI2CSlave::take(bool sda)
+{
+    switch (state) {
+        case kAddress:
+        case kWrite:
+            shift = shift << 1 | (sda ? 1 : 0);
+            bits++;
+            break;
+
+        case kRead:
+            bits++;
+            break;
+
+        case kReadAck:
+            acked = !sda;
+            break;
+
+        default:
+            break;
+    }
+}
+
+void SimulatedI2CSlave::fall(double now)
+{
+    if (!risen || now - risenAt < minimumHigh) {
+        risen = false;
+        return;
+    }
+
+    risen = false;
+    take(risenSda);
+
+    switch (state) {
+        case kAddress:
+            if (bits < 8)
+                break;
+
+            if (shift >> 1 != address) {
+                state = kIdle;
+                break;
+            }
+
+            reading = shift & 1;
+            pointerSet = false;
+            state = kAddressAck;
+            output(now, true);
+            break;
+
+        case kAddressAck:
+            if (stretch > 0) {
+                sclLow = true;
+                sclUntil = now + stretch;
+            }
+
+            bits = 0;
+            shift = 0;
+
+            if (reading) {
+                shift = registers[pointer];
+                if (autoIncrement) pointer++;
+                state = kRead;
+                output(now, !(shift & 0x80));
+            }
+            else {
+                state = kWrite;
+                output(now, false);
+            }
+            break;
+
+        case kWrite:
+            if (bits < 8)
+                break;
+
+            if (!pointerSet) {
+                pointer = shift;
+                pointerSet = true;
+            }
+            else {
+                registers[pointer] = shift;
+                if (autoIncrement) pointer++;
+            }
+
+            state = kWriteAck;
+            output(now, true);
+            break;
+
+        case kWriteAck:
+            state = kWrite;
+            bits = 0;
+            shift = 0;
+            output(now, false);
+            break;
+
+        case kRead:
+            if (bits < 8) {
+                output(now, !((shift << bits) & 0x80));
+                break;
+            }
+
+            state = kReadAck;
+            output(now, false);
+            break;
+
+        case kReadAck:
+            if (!acked) {
+                state = kIdle;
+                output(now, false);
+                break;
+            }
+
+            shift = registers[pointer];
+            if (autoIncrement) pointer++;
+            bits = 0;
+            state = kRead;
+            output(now, !(shift & 0x80));
+            break;
+
+        default:
+            break;
+    }
+}
+
+double SimulatedI2CSlave::next() const
+{
+    double at = -1;
+
+    if (sdaPending)
+        at = sdaAt;
+
+    if (sclLow && (at < 0 || sclUntil < at))
+        at = sclUntil;
+
+    return at;
+}
+
+void SimulatedI2CSlave::apply(double now)
+{
+    if (sdaPending && sdaAt <= now) {
+        sdaLow = sdaNext;
+        sdaPending = false;
+    }
+
+    if (sclLow && sclUntil <= now)
+        sclLow = false;
+}
+
+static SimulatedI2CBus *simulated_i2c_bus(I2CBusPtr b)
+{
+    return (SimulatedI2CBus *)b->DriverPrivate.ptr;
+}
+
+static void simulated_i2c_delay(I2CBusPtr b, int usec)
+{
+    simulated_i2c_bus(b)->advance(usec);
+}
+
+static void simulated_i2c_put_bits(I2CBusPtr b, int scl, int sda)
+{
+    simulated_i2c_bus(b)->drive(scl != 0, sda != 0);
+}
+
+static void simulated_i2c_get_bits(I2CBusPtr b, int *scl, int *sda)
+{
+    SimulatedI2CBus *bus = simulated_i2c_bus(b);
+
+    *scl = bus->lineScl;
+    *sda = bus->lineSda;
+}
+
+SimulatedI2CBus::SimulatedI2CBus(const char *name, int holdTime, int timeout) :
+    now(0), scl(true), sda(true), lineScl(true), lineSda(true)
+{
+    memset(&bus, 0, sizeof(bus));
+
+    bus.BusName = (char *)name;
+    bus.scrnIndex = -1;
+    bus.I2CUDelay = simulated_i2c_delay;
+    bus.I2CPutBits = simulated_i2c_put_bits;
+    bus.I2CGetBits = simulated_i2c_get_bits;
+    bus.DriverPrivate.ptr = this;
+    bus.HoldTime = holdTime;
+    bus.BitTimeout = timeout;
+    bus.ByteTimeout = timeout;
+    bus.AcknTimeout = timeout;
+    bus.StartTimeout = timeout;
+    bus.RiseFallTime = 2;
+
+    xf86I2CBusInit(&bus);
+}
+
+SimulatedI2CBus::~SimulatedI2CBus()
+{
+    xf86DestroyI2CBusRec(&bus, FALSE, TRUE);
+}
+
+void SimulatedI2CBus::attach(SimulatedI2CSlave *slave)
+{
+    slaves.push_back(slave);
+}
+
+void SimulatedI2CBus::drive(bool newScl, bool newSda)
+{
+    scl = newScl;
+    sda = newSda;
+
+    settle(true);
+}
+
+// Runs the slaves' pending line changes up to now + usec in time order
+void SimulatedI2CBus::advance(double usec)
+{
+    double target = now + usec;
+
+    for (;;) {
+        double at = -1;
+
+        for (size_t i = 0; i < slaves.size(); i++) {
+            double next = slaves[i]->next();
+
+            if (next >= 0 && (at < 0 || next < at))
+                at = next;
+        }
+
+        if (at < 0 || at > target)
+            break;
+
+        if (at > now)
+            now = at;
+
+        settle(false);
+    }
+
+    now = target;
+}
+
+// Applies due slave outputs and passes line edges to the slaves until the lines are stable.
+// START and STOP are SDA edges made by the master while SCL is high, a late slave
+// changing SDA there doesn't confuse itself
+void SimulatedI2CBus::settle(bool master)
+{
+    for (int pass = 0; pass < 8; pass++) {
+        bool newScl = scl, newSda = sda;
+
+        for (size_t i = 0; i < slaves.size(); i++) {
+            slaves[i]->apply(now);
+            newScl = newScl && !slaves[i]->sclLow;
+            newSda = newSda && !slaves[i]->sdaLow;
+        }
+
+        if (newScl == lineScl && newSda == lineSda)
+            return;
+
+        bool oldScl = lineScl, oldSda = lineSda;
+
+        lineScl = newScl;
+        lineSda = newSda;
+
+        for (size_t i = 0; i < slaves.size(); i++) {
+            if (!oldScl && newScl)
+                slaves[i]->rise(now, newSda);
+            else if (oldScl && !newScl)
+                slaves[i]->fall(now);
+            else if (master && oldScl && newScl && oldSda != newSda) {
+                if (newSda)
+                    slaves[i]->stop();
+                else
+                    slaves[i]->start();
+            }
+        }
+
+        master = false;
+    }
+}
+
+void simulated_i2c_device(I2CDevRec *device, SimulatedI2CBus *bus, UInt8 address)
+{
+    memset(device, 0, sizeof(*device));
+
+    device->DevName = (char *)"Simulated";
+    device->SlaveAddr = address << 1;
+    device->pI2CBus = &bus->bus;
+
+    xf86I2CDevInit(device);
+}
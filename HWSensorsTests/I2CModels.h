@@ -0,0 +1,94 @@
+//
+//  I2CModels.h
+//  HWSensorsTests
+//
+//  Open-drain I2C bus driven through the I2CPutBits/I2CGetBits/I2CUDelay hooks
+//  of an xf86 I2CBusRec. Lines are the wired AND of the master and the attached
+//  slaves, time is virtual and only advances when the master delays. Slaves are
+//  register files with a configurable output delay, minimum SCL high time and
+//  clock stretching.
+//
+
+#ifndef HWSensorsTests_I2CModels_h
+#define HWSensorsTests_I2CModels_h
+
+#include <vector>
+
+#include "xf86i2c.h"
+
+class SimulatedI2CSlave
+{
+public:
+    UInt8                       address;        // 7 bit
+    UInt8                       registers[256];
+    UInt8                       pointer;        // register addressed by the first byte written
+    bool                        autoIncrement;
+    double                      outputDelay;    // us from SCL falling edge to valid SDA
+    double                      stretch;        // us SCL is held low after the address is acknowledged
+    double                      minimumHigh;    // us SCL has to stay high for a bit to be taken, shorter pulses are missed
+
+    int                         starts;         // conditions seen on the bus, repeated starts included
+    int                         stops;
+
+    bool                        sdaLow;         // lines pulled by the slave
+    bool                        sclLow;
+
+    SimulatedI2CSlave(UInt8 address);
+
+    void start();
+    void stop();
+    void rise(double now, bool sda);
+    void fall(double now);
+
+    // Earliest pending line change after now, or a negative value
+    double next() const;
+    void apply(double now);
+
+private:
+    enum { kIdle, kAddress, kAddressAck, kWrite, kWriteAck, kRead, kReadAck } state;
+
+    int                         bits;
+    UInt8                       shift;
+    bool                        reading;
+    bool                        pointerSet;
+    bool                        acked;
+
+    bool                        risen;          // SCL pulse in progress, taken on its falling edge
+    bool                        risenSda;
+    double                      risenAt;
+
+    bool                        sdaPending;
+    bool                        sdaNext;
+    double                      sdaAt;
+    double                      sclUntil;
+
+    void output(double now, bool low);
+    void take(bool sda);
+};
+
+class SimulatedI2CBus
+{
+public:
+    I2CBusRec                   bus;
+    double                      now;            // us
+    bool                        scl, sda;       // driven by the master, true when released
+    bool                        lineScl, lineSda;
+    std::vector<SimulatedI2CSlave *> slaves;
+
+    // Registers an xf86 bus with the given hold time, timeouts default to it like xf86I2CBusInit does
+    SimulatedI2CBus(const char *name, int holdTime, int timeout);
+    ~SimulatedI2CBus();
+
+    void attach(SimulatedI2CSlave *slave);
+
+    void drive(bool newScl, bool newSda);
+    void advance(double usec);
+
+private:
+    void settle(bool master);
+};
+
+// Initializes and registers a device at the 7 bit address, timeouts come from the bus
+void simulated_i2c_device(I2CDevRec *device, SimulatedI2CBus *bus, UInt8 address);
+
+#endif
@@ -0,0 +1,333 @@
+//
+//  I2CTests.cpp
+//  HWSensorsTests
+//
+//  xf86 I2C transactions of NouveauSensors clocked over the simulated open-drain
+//  bus from I2CModels.h: message layout, clock stretching, hold time tuning and
+//  the fall back to configured timing.
+//
+
+#include "HWSensorsTests.h"
+#include "I2CModels.h"
+
+#include <string.h>
+#include <vector>
+
+#define kMonitorAddress     0x4c    // LM99
+#define kMonitorID          0xfe    // manufacturer ID register
+#define kMonitorIDValue     0x01    // National Semiconductor
+#define kEmptyAddress       0x2e
+
+// Port adapters stand in for AUX channels, transfers are recorded and read back 0xa5
+static std::vector<i2c_msg> port_messages;
+static int port_transfers;
+
+int i2c_transfer(struct i2c_adapter *adap, struct i2c_msg *msgs, int num)
+{
+    port_transfers++;
+
+    for (int i = 0; i < num; i++) {
+        port_messages.push_back(msgs[i]);
+
+        if (msgs[i].flags & I2C_M_RD)
+            memset(msgs[i].buf, 0xa5, msgs[i].len);
+    }
+
+    return num;
+}
+
+static void monitor_registers(SimulatedI2CSlave &slave)
+{
+    for (int reg = 0; reg < 256; reg++)
+        slave.registers[reg] = (UInt8)(reg * 7 + 3);
+
+    slave.registers[kMonitorID] = kMonitorIDValue;
+}
+
+// Lowest hold time reading the ID register reliably, searched one by one
+static int minimum_hold_time(SimulatedI2CBus &bus, I2CDevRec *device)
+{
+    int hold;
+
+    for (hold = 1; hold < bus.bus.HoldTimeSafe; hold++) {
+        int good = 0;
+
+        bus.bus.HoldTime = hold;
+
+        for (int i = 0; i < 8; i++) {
+            I2CByte value = 0;
+
+            if (xf86I2CReadByte(device, kMonitorID, &value) && value == kMonitorIDValue)
+                good++;
+        }
+
+        if (good == 8)
+            break;
+    }
+
+    bus.bus.HoldTime = bus.bus.HoldTimeSafe;
+
+    return hold;
+}
+
+// Bus time of one register read at the current timing, in us
+static double register_read_time(SimulatedI2CBus &bus, I2CDevRec *device)
+{
+    I2CByte value;
+    double from = bus.now;
+
+    xf86I2CReadByte(device, kMonitorID, &value);
+
+    return bus.now - from;
+}
+
+HWSENSORS_TEST(testI2CTransactionsEndWithSingleStop)
+{
+    SimulatedI2CBus bus("I2C0", 5, 5);
+    SimulatedI2CSlave slave(kMonitorAddress);
+    I2CDevRec device;
+
+    monitor_registers(slave);
+    bus.attach(&slave);
+    simulated_i2c_device(&device, &bus, kMonitorAddress);
+
+    // Register pointer write, repeated start, read
+    I2CByte value = 0;
+
+    XCTAssertTrue(xf86I2CReadByte(&device, kMonitorID, &value));
+    XCTAssertEqual(value, kMonitorIDValue);
+    XCTAssertEqual(slave.starts, 2);
+    XCTAssertEqual(slave.stops, 1);
+
+    XCTAssertTrue(xf86I2CWriteByte(&device, 0x19, 0x55));
+    XCTAssertEqual(slave.registers[0x19], 0x55);
+    XCTAssertEqual(slave.stops, 2);
+
+    // Auto-increment read of adjacent registers, acknowledged up to the last byte
+    I2CByte bytes[3];
+
+    XCTAssertTrue(xf86I2CReadBytes(&device, 0x10, bytes, 3));
+    XCTAssertEqual(bytes[0], slave.registers[0x10]);
+    XCTAssertEqual(bytes[2], slave.registers[0x12]);
+    XCTAssertEqual(slave.stops, 3);
+
+    // Vector of registers in one transaction: a write-read pair each, one STOP at the end
+    const I2CByte regs[4] = { 0x00, 0x01, 0x10, kMonitorID };
+    I2CByte values[4];
+    int starts = slave.starts;
+
+    XCTAssertTrue(xf86I2CReadVec(&device, regs, values, 4));
+
+    for (int i = 0; i < 4; i++)
+        XCTAssertEqual(values[i], slave.registers[regs[i]]);
+
+    XCTAssertEqual(slave.starts - starts, 8);
+    XCTAssertEqual(slave.stops, 4);
+
+    // Register/value pairs with repeated starts
+    I2CByte vec[4] = { 0x20, 0x11, 0x22, 0x33 };
+
+    XCTAssertTrue(xf86I2CWriteVec(&device, vec, 2));
+    XCTAssertEqual(slave.registers[0x20], 0x11);
+    XCTAssertEqual(slave.registers[0x22], 0x33);
+    XCTAssertEqual(slave.stops, 5);
+}
+
+HWSENSORS_TEST(testI2CProbeEmptyAddressNaks)
+{
+    SimulatedI2CBus bus("I2C0", 5, 5);
+    SimulatedI2CSlave slave(kMonitorAddress);
+    I2CDevRec device;
+
+    bus.attach(&slave);
+
+    XCTAssertTrue(xf86I2CProbeAddress(&bus.bus, kMonitorAddress << 1));
+    XCTAssertFalse(xf86I2CProbeAddress(&bus.bus, kEmptyAddress << 1));
+
+    // Every transfer left the bus idle
+    XCTAssertEqual(slave.starts, slave.stops);
+    XCTAssertTrue(bus.lineScl && bus.lineSda);
+
+    I2CByte value;
+
+    simulated_i2c_device(&device, &bus, kEmptyAddress);
+
+    XCTAssertFalse(xf86I2CReadByte(&device, kMonitorID, &value));
+    XCTAssertTrue(bus.lineScl && bus.lineSda);
+}
+
+HWSENSORS_TEST(testI2CClockStretching)
+{
+    SimulatedI2CBus bus("I2C0", 5, 40);
+    SimulatedI2CSlave slave(kMonitorAddress);
+    I2CDevRec device;
+
+    monitor_registers(slave);
+    bus.attach(&slave);
+    simulated_i2c_device(&device, &bus, kMonitorAddress);
+
+    double plain = register_read_time(bus, &device);
+
+    // Held low after each of the two address bytes, the master waits up to ByteTimeout.
+    // Part of each stretch overlaps the low half of the clock the master keeps anyway
+    slave.stretch = 30;
+
+    I2CByte value = 0;
+    double from = bus.now;
+
+    XCTAssertTrue(xf86I2CReadByte(&device, kMonitorID, &value));
+    XCTAssertEqual(value, kMonitorIDValue);
+    XCTAssertLessThanOrEqual(plain + 2 * (30 - 2 * 5), bus.now - from);
+
+    // Longer than the timeout: the transfer fails in bounded time
+    slave.stretch = 100;
+    from = bus.now;
+
+    XCTAssertFalse(xf86I2CReadByte(&device, kMonitorID, &value));
+    XCTAssertLessThanOrEqual(bus.now - from, plain + 100);
+}
+
+HWSENSORS_TEST(testI2CTuneBusFindsMinimumHoldTime)
+{
+    // Slaves slower to drive SDA or to take SCL need a longer hold time
+    static const struct { double outputDelay, minimumHigh; } slaves[] = {
+        { 0, 0 }, { 3, 0 }, { 4, 0 }, { 5, 0 }, { 6, 0 }, { 0, 4 }, { 0, 6 }, { 4, 4 },
+    };
+
+    printf("    %6s %6s %8s %6s %10s %10s %8s\n", "delay", "high", "minimum", "tuned", "safe us", "tuned us", "speedup");
+
+    for (unsigned int i = 0; i < sizeof(slaves) / sizeof(slaves[0]); i++) {
+        SimulatedI2CBus bus("I2C0", 5, 5);
+        SimulatedI2CSlave slave(kMonitorAddress);
+        I2CDevRec device;
+
+        monitor_registers(slave);
+        slave.outputDelay = slaves[i].outputDelay;
+        slave.minimumHigh = slaves[i].minimumHigh;
+        bus.attach(&slave);
+        simulated_i2c_device(&device, &bus, kMonitorAddress);
+
+        int minimum = minimum_hold_time(bus, &device);
+        double safe = register_read_time(bus, &device);
+        int expected = minimum + (minimum + 3) / 4;
+
+        if (expected > bus.bus.HoldTimeSafe)
+            expected = bus.bus.HoldTimeSafe;
+
+        int tuned = xf86I2CTuneBus(&device, kMonitorID);
+        double fast = register_read_time(bus, &device);
+
+        printf("    %5.0fus %5.0fus %6dus %4dus %10.0f %10.0f %7.2fx\n", slaves[i].outputDelay, slaves[i].minimumHigh,
+               minimum, tuned, safe, fast, safe / fast);
+
+        // Binary search lands on the lowest working hold time plus the margin
+        XCTAssertEqual(tuned, expected);
+        XCTAssertEqual(bus.bus.HoldTime, expected);
+        XCTAssertEqual(bus.bus.Tuned, expected < bus.bus.HoldTimeSafe);
+
+        // and reads keep working at tuned timing
+        for (int n = 0; n < 16; n++) {
+            I2CByte value = 0;
+
+            XCTAssertTrue(xf86I2CReadByte(&device, kMonitorID, &value));
+            XCTAssertEqual(value, kMonitorIDValue);
+        }
+
+        XCTAssertLessThanOrEqual(fast, safe);
+    }
+}
+
+HWSENSORS_TEST(testI2CFallsBackToSafeTiming)
+{
+    SimulatedI2CBus bus("I2C0", 5, 5);
+    SimulatedI2CSlave slave(kMonitorAddress);
+    I2CDevRec device, empty;
+
+    monitor_registers(slave);
+    bus.attach(&slave);
+    simulated_i2c_device(&device, &bus, kMonitorAddress);
+    simulated_i2c_device(&empty, &bus, kEmptyAddress);
+
+    int tuned = xf86I2CTuneBus(&device, kMonitorID);
+
+    XCTAssertTrue(bus.bus.Tuned);
+
+    I2CByte value = 0;
+
+    // Nothing answers at an empty address at any timing, the tuned timing is kept
+    XCTAssertFalse(xf86I2CReadByte(&empty, kMonitorID, &value));
+    XCTAssertEqual(bus.bus.HoldTime, tuned);
+    XCTAssertTrue(bus.bus.Tuned);
+
+    // The chip slows down (temperature, other master): a write is not repeated at safe timing
+    slave.minimumHigh = 6;
+
+    XCTAssertFalse(xf86I2CWriteByte(&device, 0x19, 0x55));
+    XCTAssertEqual(bus.bus.HoldTime, tuned);
+
+    // a read is, it works and the bus stays at configured timing
+    XCTAssertTrue(xf86I2CReadByte(&device, kMonitorID, &value));
+    XCTAssertEqual(value, kMonitorIDValue);
+    XCTAssertEqual(bus.bus.HoldTime, bus.bus.HoldTimeSafe);
+    XCTAssertFalse(bus.bus.Tuned);
+
+    const I2CByte regs[2] = { 0x00, kMonitorID };
+    I2CByte values[2];
+
+    XCTAssertTrue(xf86I2CReadVec(&device, regs, values, 2));
+    XCTAssertEqual(values[1], kMonitorIDValue);
+}
+
+HWSENSORS_TEST(testI2CPortTransferLayout)
+{
+    SimulatedI2CBus bus("AUX0", 5, 5);
+    struct nouveau_i2c_port port;
+    I2CDevRec device;
+
+    memset(&port, 0, sizeof(port));
+    bus.bus.port = &port;
+    simulated_i2c_device(&device, &bus, kMonitorAddress);
+
+    port_messages.clear();
+    port_transfers = 0;
+
+    // Write-read pairs of single bytes, one transfer
+    const I2CByte regs[3] = { 0x00, 0x01, kMonitorID };
+    I2CByte values[3];
+
+    XCTAssertTrue(xf86I2CReadVec(&device, regs, values, 3));
+    XCTAssertEqual(port_transfers, 1);
+    XCTAssertEqual(port_messages.size(), 6);
+
+    for (int i = 0; i < 6; i++) {
+        XCTAssertEqual(port_messages[i].addr, kMonitorAddress);
+        XCTAssertEqual(port_messages[i].flags & I2C_M_RD, i & 1 ? I2C_M_RD : 0);
+        XCTAssertEqual(port_messages[i].len, 1);
+    }
+
+    XCTAssertEqual(values[2], 0xa5);
+
+    // Register/value pairs in transfers of I2C_VEC_MAX
+    I2CByte vec[40];
+
+    memset(vec, 0, sizeof(vec));
+    port_messages.clear();
+    port_transfers = 0;
+
+    XCTAssertTrue(xf86I2CWriteVec(&device, vec, 20));
+    XCTAssertEqual(port_transfers, 2);
+    XCTAssertEqual(port_messages.size(), 20);
+    XCTAssertEqual(port_messages[19].len, 2);
+    XCTAssertEqual(port_messages[19].buf, &vec[38]);
+
+    // Adapters can't send an address alone, probing reads a byte
+    port_messages.clear();
+
+    XCTAssertTrue(xf86I2CProbeAddress(&bus.bus, kMonitorAddress << 1 | 1));
+    XCTAssertEqual(port_messages.size(), 1);
+    XCTAssertEqual(port_messages[0].flags & I2C_M_RD, I2C_M_RD);
+    XCTAssertEqual(port_messages[0].len, 1);
+
+    // No bit timing to tune
+    XCTAssertEqual(xf86I2CTuneBus(&device, kMonitorID), 5);
+}
@@ -0,0 +1,156 @@
+//
+//  PMUTests.cpp
+//  HWSensorsTests
+//
+//  Fixed counter ownership helpers from IntelDefinitions.h over a simulated MSR backend.
+//
+
+#include "HWSensorsTests.h"
+#include "SimulatedMsr.h"
+
+#include <libkern/OSTypes.h>
+
+#include "IntelDefinitions.h"
+
+// Architectural PMU v4, 3 fixed counters of 48 bits (Skylake)
+static void setup_pmu(SimulatedCpu &cpu, UInt8 version = 4, UInt8 fixed = 3, UInt8 width = 48)
+{
+    cpu.cpuid_0a[eax] = version;
+    cpu.cpuid_0a[edx] = fixed | (width << 5);
+    cpu.implement(MSR_IA32_CR_FIXED_CTR_CTRL);
+    cpu.implement(MSR_IA32_CR_PERF_GLOBAL_CTRL);
+}
+
+// One sampling pass of CPUSensors update_counters on the current CPU: returns true when the
+// interval had to be restarted because another agent reprogrammed the counters
+static bool sample_pass(void)
+{
+    bool rearmed = !pmu_fixed_counters_armed();
+
+    if (rearmed)
+        pmu_arm_fixed_counters();
+
+    return rearmed;
+}
+
+HWSENSORS_TEST(testPmuFixedCountersSupported)
+{
+    SimulatedCpu cpu;
+    simulated_cpu = &cpu;
+
+    setup_pmu(cpu);
+    XCTAssertTrue(pmu_fixed_counters_supported());
+
+    // Version 1 has no global control, two fixed counters do not include the reference clock
+    setup_pmu(cpu, 1, 3);
+    XCTAssertFalse(pmu_fixed_counters_supported());
+
+    setup_pmu(cpu, 3, 2);
+    XCTAssertFalse(pmu_fixed_counters_supported());
+
+    XCTAssertEqual(cpu.faults, 0);
+}
+
+HWSENSORS_TEST(testPmuFixedCountersMask)
+{
+    SimulatedCpu cpu;
+    simulated_cpu = &cpu;
+
+    setup_pmu(cpu, 4, 3, 48);
+    XCTAssertEqual(pmu_fixed_counters_mask(), (1ULL << 48) - 1);
+
+    // Width not reported, keep the full difference
+    setup_pmu(cpu, 4, 3, 0);
+    XCTAssertTrue(pmu_fixed_counters_mask() == UINT64_MAX);
+}
+
+HWSENSORS_TEST(testPmuArmKeepsForeignBits)
+{
+    SimulatedCpu cpu;
+    simulated_cpu = &cpu;
+
+    setup_pmu(cpu);
+
+    // Another agent counts instructions on fixed counter 0 with PMI and two general purpose counters
+    cpu.msrs[MSR_IA32_CR_FIXED_CTR_CTRL] = 0x00B;
+    cpu.msrs[MSR_IA32_CR_PERF_GLOBAL_CTRL] = (1ULL << 32) | 0x3;
+
+    XCTAssertFalse(pmu_fixed_counters_armed());
+
+    pmu_arm_fixed_counters();
+
+    XCTAssertTrue(pmu_fixed_counters_armed());
+    XCTAssertEqual(cpu.msrs[MSR_IA32_CR_FIXED_CTR_CTRL], 0x33B);
+    XCTAssertEqual(cpu.msrs[MSR_IA32_CR_PERF_GLOBAL_CTRL], (1ULL << 32) | (1ULL << 33) | (1ULL << 34) | 0x3);
+    XCTAssertEqual(cpu.faults, 0);
+}
+
+HWSENSORS_TEST(testPmuArmedReadsWithoutWriting)
+{
+    SimulatedCpu cpu;
+    simulated_cpu = &cpu;
+
+    setup_pmu(cpu);
+    pmu_arm_fixed_counters();
+
+    int writes = cpu.writes[MSR_IA32_CR_FIXED_CTR_CTRL] + cpu.writes[MSR_IA32_CR_PERF_GLOBAL_CTRL];
+
+    // Steady state: every pass only reads the control registers
+    for (int pass = 0; pass < 100; pass++)
+        XCTAssertFalse(sample_pass());
+
+    XCTAssertEqual(cpu.writes[MSR_IA32_CR_FIXED_CTR_CTRL] + cpu.writes[MSR_IA32_CR_PERF_GLOBAL_CTRL], writes);
+}
+
+HWSENSORS_TEST(testPmuReprogrammedControlIsRearmed)
+{
+    SimulatedCpu cpu;
+    simulated_cpu = &cpu;
+
+    setup_pmu(cpu);
+    pmu_arm_fixed_counters();
+
+    // A profiler takes fixed counter 1 for sampling with PMI on ring 0 only
+    cpu.msrs[MSR_IA32_CR_FIXED_CTR_CTRL] = (cpu.msrs[MSR_IA32_CR_FIXED_CTR_CTRL] & ~0xF0ULL) | 0x90;
+
+    XCTAssertTrue(sample_pass());
+    XCTAssertEqual(cpu.msrs[MSR_IA32_CR_FIXED_CTR_CTRL] & PMU_FIXED_CTR_CTRL_MASK, PMU_FIXED_CTR_CTRL_OWNED);
+    XCTAssertFalse(sample_pass());
+}
+
+HWSENSORS_TEST(testPmuDisabledGlobalControlIsRearmed)
+{
+    SimulatedCpu cpu;
+    simulated_cpu = &cpu;
+
+    setup_pmu(cpu);
+    pmu_arm_fixed_counters();
+
+    // Reference clock counter stopped by another agent, the core clock counter still runs
+    cpu.msrs[MSR_IA32_CR_PERF_GLOBAL_CTRL] &= ~(1ULL << 34);
+
+    XCTAssertTrue(sample_pass());
+    XCTAssertEqual(cpu.msrs[MSR_IA32_CR_PERF_GLOBAL_CTRL] & PMU_GLOBAL_CTRL_OWNED, PMU_GLOBAL_CTRL_OWNED);
+    XCTAssertFalse(sample_pass());
+}
+
+HWSENSORS_TEST(testPmuRearmIsPerCore)
+{
+    SimulatedCpu cores[4];
+
+    for (int i = 0; i < 4; i++) {
+        simulated_cpu = &cores[i];
+        setup_pmu(cores[i]);
+        init_cpu_turbo_counters(NULL);
+    }
+
+    // Only core 2 is reprogrammed, the rendezvous re-arms it alone
+    cores[2].msrs[MSR_IA32_CR_FIXED_CTR_CTRL] = 0;
+
+    for (int i = 0; i < 4; i++) {
+        simulated_cpu = &cores[i];
+        XCTAssertEqual(sample_pass(), i == 2);
+        XCTAssertTrue(pmu_fixed_counters_armed());
+        XCTAssertEqual(cores[i].faults, 0);
+    }
+}
@@ -0,0 +1,112 @@
+//
+//  RAPLTests.cpp
+//  HWSensorsTests
+//
+//  RAPL decoding from CPUSensorsMath.h replayed over recorded MSR traces.
+//
+
+#include "HWSensorsTests.h"
+#include "CPUSensorsMath.h"
+
+#define kRaplDomains    5   // PKG, PP0, PP1, DRAM, PSYS like kCPUSensorsRaplDomains
+
+struct RaplSample {
+    double time;
+    UInt32 energy[kRaplDomains];    // low 32 bits of the *_ENERGY_STATUS MSRs
+};
+
+// Core i7-6700K, MSR_RAPL_POWER_UNIT 0x000A0E03: 1/8 W, 1/16384 J, 1/1024 s
+static const UInt64 skylakeUnits = 0x000A0E03;
+
+// MSR_PKG_POWER_LIMIT with PL1 91 W (0x2D8) and PL2 113.75 W (0x38E) enabled, clamping and time windows set
+static const UInt64 skylakeLimits = 0x0042838E00DD82D8ULL;
+
+// Package counter wraps between the second and third sample, PSYS is not reported by this board
+static const RaplSample skylakeTrace[] = {
+    { 0.0, { 0xFFF00000, 0x12340000, 0x00100000, 0x00200000, 0x00000000 } },
+    { 0.5, { 0xFFF80000, 0x12368000, 0x00101000, 0x00208000, 0x00000000 } },
+    { 1.0, { 0x00080000, 0x123A0000, 0x00102000, 0x00210000, 0x00000000 } },
+    { 2.0, { 0x00180000, 0x12400000, 0x00104000, 0x00220000, 0x00000000 } },
+};
+
+// Core i7-8550U, same units, PSYS reports the whole platform
+static const RaplSample kabylakeTrace[] = {
+    { 0.0, { 0x00400000, 0x00200000, 0x00010000, 0x00040000, 0xFFFC0000 } },
+    { 1.0, { 0x00418000, 0x00208000, 0x00011000, 0x00044000, 0x00020000 } },
+};
+
+static double replay_watts(const RaplSample *trace, int sample, int domain, float energyUnits)
+{
+    return energyUnits * get_rapl_energy_rate(trace[sample - 1].energy[domain], trace[sample].energy[domain], trace[sample].time - trace[sample - 1].time);
+}
+
+HWSENSORS_TEST(testRaplUnitsDecoding)
+{
+    XCTAssertEqual(get_rapl_power_units(skylakeUnits), 3);
+    XCTAssertEqual(get_rapl_energy_units(skylakeUnits), 14);
+    XCTAssertEqual(get_rapl_time_units(skylakeUnits), 10);
+
+    XCTAssertEqualWithAccuracy(get_rapl_unit_scale(get_rapl_power_units(skylakeUnits)), 0.125, 1e-9);
+    XCTAssertEqualWithAccuracy(get_rapl_unit_scale(get_rapl_energy_units(skylakeUnits)), 1.0 / 16384, 1e-12);
+    XCTAssertEqualWithAccuracy(get_rapl_unit_scale(get_rapl_time_units(skylakeUnits)), 1.0 / 1024, 1e-12);
+
+    // Reserved bits around the fields are ignored
+    XCTAssertEqual(get_rapl_energy_units(0xFFFFE0FF | (0x0EULL << 8)), 14);
+}
+
+HWSENSORS_TEST(testRaplPowerLimitDecoding)
+{
+    float powerUnits = get_rapl_unit_scale(get_rapl_power_units(skylakeUnits));
+
+    XCTAssertEqualWithAccuracy(get_rapl_power_limit(skylakeLimits, 0, powerUnits), 91.0, 1e-3);
+    XCTAssertEqualWithAccuracy(get_rapl_power_limit(skylakeLimits, 1, powerUnits), 113.75, 1e-3);
+
+    // Lock bit does not leak into PL2, disabled limits read zero
+    XCTAssertEqualWithAccuracy(get_rapl_power_limit(skylakeLimits | (1ULL << 63), 1, powerUnits), 113.75, 1e-3);
+    XCTAssertEqualWithAccuracy(get_rapl_power_limit(skylakeLimits & ~0x8000ULL, 0, powerUnits), 0, 1e-6);
+    XCTAssertEqualWithAccuracy(get_rapl_power_limit(skylakeLimits & ~(1ULL << 47), 1, powerUnits), 0, 1e-6);
+}
+
+HWSENSORS_TEST(testRaplEnergyAcrossWrap)
+{
+    float energyUnits = get_rapl_unit_scale(get_rapl_energy_units(skylakeUnits));
+
+    // 0x80000 units per 0.5 s = 64 W, both before and after the package counter wraps
+    XCTAssertEqualWithAccuracy(replay_watts(skylakeTrace, 1, 0, energyUnits), 64.0, 1e-3);
+    XCTAssertEqualWithAccuracy(replay_watts(skylakeTrace, 2, 0, energyUnits), 128.0, 1e-3);
+    XCTAssertEqualWithAccuracy(replay_watts(skylakeTrace, 3, 0, energyUnits), 64.0, 1e-3);
+
+    XCTAssertEqualWithAccuracy(replay_watts(skylakeTrace, 1, 1, energyUnits), 20.0, 1e-3);
+    XCTAssertEqualWithAccuracy(replay_watts(skylakeTrace, 3, 3, energyUnits), 4.0, 1e-3);
+}
+
+HWSENSORS_TEST(testRaplPlatformDomain)
+{
+    float energyUnits = get_rapl_unit_scale(get_rapl_energy_units(skylakeUnits));
+
+    // Not reported: the counter never moves and the sensor is not added (start() checks for zero)
+    XCTAssertEqual(skylakeTrace[0].energy[4], 0);
+    XCTAssertEqualWithAccuracy(replay_watts(skylakeTrace, 3, 4, energyUnits), 0.0, 1e-6);
+
+    // Reported and wrapping: 0x60000 units in 1 s = 24 W, at least the package power
+    double platform = replay_watts(kabylakeTrace, 1, 4, energyUnits);
+
+    XCTAssertEqualWithAccuracy(platform, 24.0, 1e-3);
+    XCTAssertLessThanOrEqual(replay_watts(kabylakeTrace, 1, 0, energyUnits), platform);
+}
+
+HWSENSORS_TEST(testRaplEnergyWithoutInterval)
+{
+    XCTAssertEqualWithAccuracy(get_rapl_energy_rate(0x100, 0x200, 0), 0, 1e-9);
+}
+
+HWSENSORS_TEST(testRaplThrottlePercent)
+{
+    float timeUnits = get_rapl_unit_scale(get_rapl_time_units(skylakeUnits));
+
+    // 256 time units of 1/1024 s in 1 s, then across the 32 bit wrap
+    XCTAssertEqualWithAccuracy(get_rapl_throttle_percent(1000, 1256, timeUnits, 1.0), 25.0, 1e-3);
+    XCTAssertEqualWithAccuracy(get_rapl_throttle_percent(0xFFFFFF80, 0x80, timeUnits, 1.0), 25.0, 1e-3);
+    XCTAssertEqualWithAccuracy(get_rapl_throttle_percent(0, 4096, timeUnits, 1.0), 100.0, 1e-3);
+    XCTAssertEqualWithAccuracy(get_rapl_throttle_percent(0, 4096, timeUnits, 0), 0.0, 1e-3);
+}
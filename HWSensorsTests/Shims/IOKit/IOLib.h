@@ -0,0 +1,39 @@
+//
+//  IOLib.h
+//  HWSensorsTests
+//
+//  Host stand-in for the parts of IOLib used by the shared Linux headers.
+//
+
+#ifndef HWSensorsTests_IOLib_h
+#define HWSensorsTests_IOLib_h
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include <libkern/OSTypes.h>
+
+#define IOLog(format, ...) printf(format, ##__VA_ARGS__)
+
+typedef UInt32 clock_sec_t;
+typedef UInt32 clock_usec_t;
+
+inline void clock_get_system_microtime(clock_sec_t *secs, clock_usec_t *microsecs)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    *secs = (clock_sec_t)now.tv_sec;
+    *microsecs = (clock_usec_t)(now.tv_nsec / 1000);
+}
+
+inline void IOPause(unsigned nanoseconds)
+{
+    struct timespec pause = { 0, (long)nanoseconds };
+
+    nanosleep(&pause, NULL);
+}
+
+#endif
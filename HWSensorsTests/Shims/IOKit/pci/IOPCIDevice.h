@@ -0,0 +1,33 @@
+//
+//  IOPCIDevice.h
+//  HWSensorsTests
+//
+//  Host stand-in for the PCI nub and its register mapping, enough for the
+//  nouveau headers and their log macros to compile.
+//
+
+#ifndef HWSensorsTests_IOPCIDevice_h
+#define HWSensorsTests_IOPCIDevice_h
+
+#include <IOKit/IOLib.h>
+#include <libkern/OSByteOrder.h>
+
+typedef uintptr_t IOVirtualAddress;
+
+class IOMemoryMap
+{
+public:
+    IOVirtualAddress            address;
+
+    IOVirtualAddress getVirtualAddress() { return address; }
+};
+
+class IOPCIDevice
+{
+public:
+    UInt8                       bus;
+
+    UInt8 getBusNumber() { return bus; }
+};
+
+#endif
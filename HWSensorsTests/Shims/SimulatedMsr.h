@@ -0,0 +1,72 @@
+//
+//  SimulatedMsr.h
+//  HWSensorsTests
+//
+//  Host stand-in for rdmsr64/wrmsr64/do_cpuid. Each simulated CPU has its own
+//  register file, tests switch simulated_cpu to emulate per-core execution.
+//  Accessing an MSR that is not implemented counts a fault (#GP on hardware).
+//
+
+#ifndef HWSensorsTests_SimulatedMsr_h
+#define HWSensorsTests_SimulatedMsr_h
+
+#include <stdint.h>
+#include <map>
+
+typedef enum { eax, ebx, ecx, edx } cpuid_register_t;
+
+struct SimulatedCpu {
+    std::map<uint32_t, uint64_t> msrs;
+    std::map<uint32_t, int> reads;
+    std::map<uint32_t, int> writes;
+    uint32_t cpuid_0a[4];
+    int faults;
+
+    SimulatedCpu() : faults(0)
+    {
+        cpuid_0a[eax] = cpuid_0a[ebx] = cpuid_0a[ecx] = cpuid_0a[edx] = 0;
+    }
+
+    void implement(uint32_t msr, uint64_t value = 0)
+    {
+        msrs[msr] = value;
+    }
+};
+
+static SimulatedCpu *simulated_cpu = NULL;
+
+static inline uint64_t rdmsr64(uint32_t msr)
+{
+    simulated_cpu->reads[msr]++;
+
+    std::map<uint32_t, uint64_t>::iterator entry = simulated_cpu->msrs.find(msr);
+
+    if (entry == simulated_cpu->msrs.end()) {
+        simulated_cpu->faults++;
+        return 0;
+    }
+
+    return entry->second;
+}
+
+static inline void wrmsr64(uint32_t msr, uint64_t value)
+{
+    simulated_cpu->writes[msr]++;
+
+    std::map<uint32_t, uint64_t>::iterator entry = simulated_cpu->msrs.find(msr);
+
+    if (entry == simulated_cpu->msrs.end()) {
+        simulated_cpu->faults++;
+        return;
+    }
+
+    entry->second = value;
+}
+
+static inline void do_cpuid(uint32_t selector, uint32_t *data)
+{
+    for (int i = 0; i < 4; i++)
+        data[i] = selector == 0xA ? simulated_cpu->cpuid_0a[i] : 0;
+}
+
+#endif
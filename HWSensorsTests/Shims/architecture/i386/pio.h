@@ -0,0 +1,14 @@
+//
+//  pio.h
+//  HWSensorsTests
+//
+//  Host stand-in for the port I/O type, ports are only reached through the
+//  SuperIOPortIO hook in the tests.
+//
+
+#ifndef HWSensorsTests_pio_h
+#define HWSensorsTests_pio_h
+
+typedef unsigned short i386_ioport_t;
+
+#endif
@@ -0,0 +1,55 @@
+//
+//  OSByteOrder.h
+//  HWSensorsTests
+//
+//  Host stand-in for the MMIO accessors, the tests run on little endian hosts
+//  like the kexts do.
+//
+
+#ifndef HWSensorsTests_OSByteOrder_h
+#define HWSensorsTests_OSByteOrder_h
+
+#include <string.h>
+
+#include <libkern/OSTypes.h>
+
+inline UInt16 OSReadLittleInt16(const volatile void *base, uintptr_t offset)
+{
+    UInt16 value;
+    memcpy(&value, (const UInt8 *)base + offset, sizeof(value));
+    return value;
+}
+
+inline UInt32 OSReadLittleInt32(const volatile void *base, uintptr_t offset)
+{
+    UInt32 value;
+    memcpy(&value, (const UInt8 *)base + offset, sizeof(value));
+    return value;
+}
+
+inline void OSWriteLittleInt32(volatile void *base, uintptr_t offset, UInt32 value)
+{
+    memcpy((UInt8 *)base + offset, &value, sizeof(value));
+}
+
+inline UInt16 _OSReadInt16(const volatile void *base, uintptr_t offset)
+{
+    return OSReadLittleInt16(base, offset);
+}
+
+inline UInt32 _OSReadInt32(const volatile void *base, uintptr_t offset)
+{
+    return OSReadLittleInt32(base, offset);
+}
+
+inline void _OSWriteInt16(volatile void *base, uintptr_t offset, UInt16 value)
+{
+    memcpy((UInt8 *)base + offset, &value, sizeof(value));
+}
+
+inline void _OSWriteInt32(volatile void *base, uintptr_t offset, UInt32 value)
+{
+    OSWriteLittleInt32(base, offset, value);
+}
+
+#endif
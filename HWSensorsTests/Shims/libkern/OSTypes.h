@@ -0,0 +1,23 @@
+//
+//  OSTypes.h
+//  HWSensorsTests
+//
+//  Host stand-in for the kernel fixed width types used by the shared headers.
+//
+
+#ifndef HWSensorsTests_OSTypes_h
+#define HWSensorsTests_OSTypes_h
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef uint8_t     UInt8;
+typedef int8_t      SInt8;
+typedef uint16_t    UInt16;
+typedef int16_t     SInt16;
+typedef uint32_t    UInt32;
+typedef int32_t     SInt32;
+typedef uint64_t    UInt64;
+typedef int64_t     SInt64;
+
+#endif
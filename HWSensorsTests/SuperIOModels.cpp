@@ -0,0 +1,309 @@
+//
+//  SuperIOModels.cpp
+//  HWSensorsTests
+//
+//  Port I/O backend dispatching to the register-file models, replaces the
+//  native inb/outb backend of SuperIODevice.cpp.
+//
+
+#include "SuperIOModels.h"
+
+#include <algorithm>
+#include <math.h>
+
+#include "W836xxDefinitions.h"
+#include "NCT677xDefinitions.h"
+#include "IT87xxDefinitions.h"
+#include "F718xxDefinitions.h"
+
+static std::vector<SimulatedSuperIO *> simulated_superio_chips;
+
+UInt32 simulated_superio_delay = 0;
+
+// Nothing decodes the port: the LPC bus floats high
+static UInt8 superio_simulated_inb(i386_ioport_t port)
+{
+    for (size_t i = 0; i < simulated_superio_chips.size(); i++)
+        if (simulated_superio_chips[i]->owns(port))
+            return simulated_superio_chips[i]->read(port);
+
+    return 0xFF;
+}
+
+static void superio_simulated_outb(i386_ioport_t port, UInt8 value)
+{
+    for (size_t i = 0; i < simulated_superio_chips.size(); i++)
+        if (simulated_superio_chips[i]->owns(port))
+            simulated_superio_chips[i]->write(port, value);
+}
+
+SuperIOPortIO superio_port_io = { superio_simulated_inb, superio_simulated_outb };
+UInt64 superio_port_operations = 0;
+
+void superio_set_port_io(const SuperIOPortIO *io)
+{
+    superio_port_io.read = io && io->read ? io->read : superio_simulated_inb;
+    superio_port_io.write = io && io->write ? io->write : superio_simulated_outb;
+}
+
+void superio_delay(UInt32 milliseconds)
+{
+    simulated_superio_delay += milliseconds;
+}
+
+// Counts of a fan turning at rpm, saturating at the register width (stopped fans read all ones)
+static UInt32 simulated_fan_count(double clock, float rpm, UInt32 divisor, UInt32 limit)
+{
+    if (rpm <= 0)
+        return limit;
+
+    double count = floor(clock / (rpm * divisor) + 0.5);
+
+    return count < limit ? (UInt32)count : limit;
+}
+
+SimulatedSuperIO::SimulatedSuperIO(SuperIOFamily family, i386_ioport_t port, UInt16 id, UInt8 ldn, UInt16 address, bool banked) :
+    family(family), port(port), hwm(address & 0xFFF8), banked(banked), entered(false), movingAddress(false), configIndex(0),
+    index(0), bankSelect(0), bankSelects(0), keyMatched(0)
+{
+    if (family == kSuperIOFamilyITE) {
+        UInt8 ite[] = { 0x87, 0x01, 0x55, (UInt8)(port == 0x4e ? 0xaa : 0x55) };
+        key.assign(ite, ite + sizeof(ite));
+    }
+    else {
+        key.assign(2, 0x87);
+    }
+
+    config[kSuperIOChipIDRegister] = id >> 8;
+    config[kSuperIOChipIDRegister + 1] = id & 0xFF;
+    config[ldn << 8 | kSuperIOBaseAddressRegister] = address >> 8;
+    config[ldn << 8 | (kSuperIOBaseAddressRegister + 1)] = address & 0xFF;
+
+    simulated_superio_chips.push_back(this);
+}
+
+SimulatedSuperIO::~SimulatedSuperIO()
+{
+    simulated_superio_chips.erase(std::remove(simulated_superio_chips.begin(), simulated_superio_chips.end(), this), simulated_superio_chips.end());
+}
+
+bool SimulatedSuperIO::owns(i386_ioport_t target) const
+{
+    return target == port || target == port + 1 || target == hwm + kSuperIOHWMIndexOffset || target == hwm + kSuperIOHWMDataOffset;
+}
+
+UInt8 &SimulatedSuperIO::configRegister(UInt8 reg)
+{
+    // Registers below 0x30 are global, the rest belong to the selected logical device
+    return reg < 0x30 ? config[reg] : config[config[kSuperIODeviceSelectRegister] << 8 | reg];
+}
+
+void SimulatedSuperIO::enter(UInt8 value)
+{
+    if (value == key[keyMatched])
+        keyMatched++;
+    else
+        keyMatched = value == key[0] ? 1 : 0;
+
+    if (keyMatched == key.size()) {
+        entered = true;
+        keyMatched = 0;
+    }
+}
+
+UInt8 SimulatedSuperIO::read(i386_ioport_t target)
+{
+    if (target == hwm + kSuperIOHWMIndexOffset)
+        return index;
+
+    if (target == hwm + kSuperIOHWMDataOffset) {
+        if (banked && index == kSuperIOHWMBankSelectRegister)
+            return bankSelect;
+
+        return readRegister((banked ? (bankSelect & 0x0F) << 8 : 0) | index);
+    }
+
+    if (!entered)
+        return 0xFF;
+
+    if (target == port)
+        return configIndex;
+
+    UInt8 value = configRegister(configIndex);
+
+    if (movingAddress && configIndex == kSuperIOBaseAddressRegister + 1)
+        configRegister(configIndex) += 8;
+
+    return value;
+}
+
+void SimulatedSuperIO::write(i386_ioport_t target, UInt8 value)
+{
+    if (target == hwm + kSuperIOHWMIndexOffset) {
+        index = value;
+    }
+    else if (target == hwm + kSuperIOHWMDataOffset) {
+        if (banked && index == kSuperIOHWMBankSelectRegister) {
+            bankSelect = value;
+            bankSelects++;
+        }
+        else {
+            writeRegister((banked ? (bankSelect & 0x0F) << 8 : 0) | index, value);
+        }
+    }
+    else if (!entered) {
+        if (target == port)
+            enter(value);
+    }
+    else if (target == port) {
+        if (family == kSuperIOFamilyWinbond && value == 0xAA)
+            entered = false;
+        else
+            configIndex = value;
+    }
+    else if (family == kSuperIOFamilyITE && configIndex == kSuperIOConfigControlRegister) {
+        // Bit 1 returns the chip to the wait for key state
+        if (value & 0x02)
+            entered = false;
+    }
+    else if (configIndex != kSuperIOChipIDRegister && configIndex != kSuperIOChipIDRegister + 1) {
+        configRegister(configIndex) = value;
+    }
+}
+
+UInt8 SimulatedSuperIO::readRegister(UInt16 reg)
+{
+    std::map<UInt16, UInt8>::iterator entry = registers.find(reg);
+
+    return entry != registers.end() ? entry->second : 0xFF;
+}
+
+void SimulatedSuperIO::writeRegister(UInt16 reg, UInt8 value)
+{
+    registers[reg] = value;
+}
+
+void SimulatedSuperIO::firmwareSelectsBank(UInt8 value)
+{
+    bankSelect = value;
+}
+
+void SimulatedSuperIO::firmwareReads(UInt16 reg)
+{
+    if (banked)
+        bankSelect = reg >> 8;
+
+    index = reg & 0xFF;
+}
+
+SimulatedW836xx::SimulatedW836xx(i386_ioport_t port, UInt16 id, UInt16 address) :
+    SimulatedSuperIO(kSuperIOFamilyWinbond, port, id, kWinbondHardwareMonitorLDN, address, true)
+{
+    for (int i = 0; i < 5; i++)
+        fanRPM[i] = 0;
+
+    for (int i = 0; i < 5; i++)
+        registers[WINBOND_TACHOMETER_DIVISOR[i]] = 0;
+}
+
+// Divisor bits as listed in the datasheet, one register/bit pair per divisor bit
+UInt8 SimulatedW836xx::divisorOffset(int fan)
+{
+    return (((registers[WINBOND_TACHOMETER_DIV2[fan]] >> WINBOND_TACHOMETER_DIV2_BIT[fan]) & 1) << 2) |
+           (((registers[WINBOND_TACHOMETER_DIV1[fan]] >> WINBOND_TACHOMETER_DIV1_BIT[fan]) & 1) << 1) |
+            ((registers[WINBOND_TACHOMETER_DIV0[fan]] >> WINBOND_TACHOMETER_DIV0_BIT[fan]) & 1);
+}
+
+UInt8 SimulatedW836xx::readRegister(UInt16 reg)
+{
+    // The vendor ID register returns its high byte while the high byte access bit is set
+    if ((reg & 0xFF) == WINBOND_VENDOR_ID_REGISTER)
+        return bankSelect & WINBOND_HIGH_BYTE ? WINBOND_VENDOR_ID >> 8 : WINBOND_VENDOR_ID & 0xFF;
+
+    for (int i = 0; i < 5; i++)
+        if (reg == WINBOND_TACHOMETER[i])
+            return simulated_fan_count(1.35e6, fanRPM[i], 1 << divisorOffset(i), 0xFF);
+
+    return SimulatedSuperIO::readRegister(reg);
+}
+
+SimulatedNCT677x::SimulatedNCT677x(i386_ioport_t port, UInt16 id, UInt16 address) :
+    SimulatedSuperIO(kSuperIOFamilyWinbond, port, id, kWinbondHardwareMonitorLDN, address, true)
+{
+    for (int i = 0; i < 6; i++)
+        fanRPM[i] = 0;
+}
+
+UInt8 SimulatedNCT677x::readRegister(UInt16 reg)
+{
+    if ((reg & 0xFF) == 0x4F)
+        return bankSelect & 0x80 ? NUVOTON_VENDOR_ID >> 8 : NUVOTON_VENDOR_ID & 0xFF;
+
+    // NCT6779D and later: RPM, big endian, from bank 4
+    for (int i = 0; i < 6; i++) {
+        if (reg == 0x4C0 + 2 * i)
+            return fanRPM[i] >> 8;
+        if (reg == 0x4C0 + 2 * i + 1)
+            return fanRPM[i] & 0xFF;
+    }
+
+    return SimulatedSuperIO::readRegister(reg);
+}
+
+SimulatedIT87xx::SimulatedIT87xx(i386_ioport_t port, UInt16 id, UInt16 address) :
+    SimulatedSuperIO(kSuperIOFamilyITE, port, id, kFintekITEHardwareMonitorLDN, address, false), sixteenBitFans(true)
+{
+    for (int i = 0; i < 5; i++)
+        fanRPM[i] = 0;
+
+    registers[ITE_VENDOR_ID_REGISTER] = ITE_VENDOR_ID;
+    registers[ITE_FAN_TACHOMETER_DIVISOR_REGISTER] = 0;
+}
+
+UInt8 SimulatedIT87xx::readRegister(UInt16 reg)
+{
+    for (int i = 0; i < 5; i++) {
+        if (reg != ITE_FAN_TACHOMETER_REG[i] && reg != ITE_FAN_TACHOMETER_EXT_REG[i])
+            continue;
+
+        // Two pulses per revolution counted at 22.5 kHz
+        if (sixteenBitFans) {
+            UInt32 count = simulated_fan_count(1.35e6, fanRPM[i], 2, 0xFFFF);
+
+            return reg == ITE_FAN_TACHOMETER_REG[i] ? count & 0xFF : count >> 8;
+        }
+
+        if (reg == ITE_FAN_TACHOMETER_EXT_REG[i])
+            return 0;
+
+        UInt8 divisors = registers[ITE_FAN_TACHOMETER_DIVISOR_REGISTER];
+
+        return simulated_fan_count(1.35e6, fanRPM[i], i < 2 ? 1 << ((divisors >> (3 * i)) & 0x7) : 2, 0xFF);
+    }
+
+    return SimulatedSuperIO::readRegister(reg);
+}
+
+SimulatedF718xx::SimulatedF718xx(i386_ioport_t port, UInt16 id, UInt8 ldn, UInt16 address) :
+    SimulatedSuperIO(kSuperIOFamilyWinbond, port, id, ldn, address, false)
+{
+    for (int i = 0; i < 4; i++)
+        fanRPM[i] = 0;
+
+    config[FINTEK_VENDOR_ID_REGISTER] = FINTEK_VENDOR_ID >> 8;
+    config[FINTEK_VENDOR_ID_REGISTER + 1] = FINTEK_VENDOR_ID & 0xFF;
+}
+
+UInt8 SimulatedF718xx::readRegister(UInt16 reg)
+{
+    for (int i = 0; i < 4; i++) {
+        if (reg != FINTEK_FAN_TACHOMETER_REG[i] && reg != FINTEK_FAN_TACHOMETER_REG[i] + 1)
+            continue;
+
+        UInt32 count = simulated_fan_count(1.5e6, fanRPM[i], 1, 0x0FFF);
+
+        return reg == FINTEK_FAN_TACHOMETER_REG[i] ? count >> 8 : count & 0xFF;
+    }
+
+    return SimulatedSuperIO::readRegister(reg);
+}
@@ -0,0 +1,111 @@
+//
+//  SuperIOModels.h
+//  HWSensorsTests
+//
+//  Register-file models of the SuperIO chips, reached through the SuperIOPortIO
+//  hook. Each model decodes its configuration port (entry key, chip ID, logical
+//  devices) and its hardware monitor index/data pair, banked like the real chip.
+//  Fan counts are derived from a simulated fan speed with the chip's divisor.
+//
+
+#ifndef HWSensorsTests_SuperIOModels_h
+#define HWSensorsTests_SuperIOModels_h
+
+#include <stddef.h>
+#include <map>
+#include <vector>
+
+#include "SuperIODefinitions.h"
+
+class SimulatedSuperIO
+{
+public:
+    SuperIOFamily               family;
+    i386_ioport_t               port;           // configuration index port, data at port + 1
+    UInt16                      hwm;            // hardware monitor address, index/data at +5/+6
+    bool                        banked;
+
+    bool                        entered;        // configuration mode
+    bool                        movingAddress;  // firmware reprograms the base address between reads
+    UInt8                       configIndex;
+    std::map<UInt16, UInt8>     config;         // global registers, logical device registers at ldn << 8 | reg
+
+    UInt8                       index;
+    UInt8                       bankSelect;     // last value written to the bank select register
+    std::map<UInt16, UInt8>     registers;      // bank << 8 | reg
+    int                         bankSelects;
+
+    SimulatedSuperIO(SuperIOFamily family, i386_ioport_t port, UInt16 id, UInt8 ldn, UInt16 address, bool banked);
+    virtual ~SimulatedSuperIO();
+
+    bool owns(i386_ioport_t target) const;
+    UInt8 read(i386_ioport_t target);
+    void write(i386_ioport_t target, UInt8 value);
+
+    // Hardware monitor register as seen by the chip, bank in the high byte
+    virtual UInt8 readRegister(UInt16 reg);
+    virtual void writeRegister(UInt16 reg, UInt8 value);
+
+    // Firmware (SMM, EC) accesses the monitor between our transactions
+    void firmwareSelectsBank(UInt8 value);
+    // or in the middle of one, leaving its bank and index selected
+    void firmwareReads(UInt16 reg);
+
+private:
+    std::vector<UInt8>          key;
+    size_t                      keyMatched;
+
+    UInt8 &configRegister(UInt8 reg);
+    void enter(UInt8 value);
+};
+
+// Winbond W836xx, divisors spread over five registers of bank 0
+class SimulatedW836xx : public SimulatedSuperIO
+{
+public:
+    float                       fanRPM[5];
+
+    SimulatedW836xx(i386_ioport_t port, UInt16 id, UInt16 address);
+
+    UInt8 divisorOffset(int fan);
+    virtual UInt8 readRegister(UInt16 reg);
+};
+
+// Nuvoton NCT677x, fan speeds are reported in RPM
+class SimulatedNCT677x : public SimulatedSuperIO
+{
+public:
+    UInt16                      fanRPM[6];
+
+    SimulatedNCT677x(i386_ioport_t port, UInt16 id, UInt16 address);
+
+    virtual UInt8 readRegister(UInt16 reg);
+};
+
+// ITE IT87xx, 16 bit counts or 8 bit counts with divisors
+class SimulatedIT87xx : public SimulatedSuperIO
+{
+public:
+    float                       fanRPM[5];
+    bool                        sixteenBitFans;
+
+    SimulatedIT87xx(i386_ioport_t port, UInt16 id, UInt16 address);
+
+    virtual UInt8 readRegister(UInt16 reg);
+};
+
+// Fintek F718xx, 12 bit counts of a 1.5 MHz clock
+class SimulatedF718xx : public SimulatedSuperIO
+{
+public:
+    float                       fanRPM[4];
+
+    SimulatedF718xx(i386_ioport_t port, UInt16 id, UInt8 ldn, UInt16 address);
+
+    virtual UInt8 readRegister(UInt16 reg);
+};
+
+// Total time the detection code asked to wait
+extern UInt32 simulated_superio_delay;
+
+#endif
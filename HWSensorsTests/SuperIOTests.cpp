@@ -0,0 +1,709 @@
+//
+//  SuperIOTests.cpp
+//  HWSensorsTests
+//
+//  Chip detection, banked hardware monitor access, fan count conversion, port
+//  operations per sensor sweep and firmware lock contention from SuperIODefinitions.h,
+//  LPCSensorsLock.h and the chip definitions, run against register-file models.
+//
+
+#include "HWSensorsTests.h"
+#include "SuperIOModels.h"
+
+#include <algorithm>
+
+#include "LPCSensorsLock.h"
+#include "W836xxDefinitions.h"
+#include "NCT677xDefinitions.h"
+#include "IT87xxDefinitions.h"
+#include "F718xxDefinitions.h"
+
+HWSENSORS_TEST(testSuperIODetectsNuvotonOnPrimaryPort)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    SuperIOChipInfo info;
+
+    XCTAssertTrue(superio_detect_winbond_family(0x2e, &info));
+    XCTAssertEqual(info.id, 0xC562);
+    XCTAssertEqual(info.model, NCT6779D);
+    XCTAssertEqual(info.ldn, kWinbondHardwareMonitorLDN);
+    XCTAssertEqual(info.address, 0x290);
+
+    // Left in the wait for key state, the ITE key does not open a Winbond family chip
+    XCTAssertFalse(chip.entered);
+    XCTAssertFalse(superio_detect_ite_family(0x2e, &info));
+    XCTAssertEqual(info.model, 0);
+    XCTAssertFalse(chip.entered);
+}
+
+HWSENSORS_TEST(testSuperIODetectsWinbondOnSecondaryPort)
+{
+    SimulatedW836xx chip(0x4e, 0xA023, 0xA10);
+    SuperIOChipInfo info;
+
+    XCTAssertFalse(superio_detect_winbond_family(0x2e, &info));
+    XCTAssertEqual(info.id, 0xFFFF);
+
+    XCTAssertTrue(superio_detect_winbond_family(0x4e, &info));
+    XCTAssertEqual(info.model, W83627DHG);
+    XCTAssertEqual(info.address, 0xA10);
+    XCTAssertFalse(chip.entered);
+}
+
+HWSENSORS_TEST(testSuperIODetectsITEWithPortKey)
+{
+    SimulatedIT87xx primary(0x2e, IT8728F, 0xA40);
+    SimulatedIT87xx secondary(0x4e, IT8792E, 0xA60);
+    SuperIOChipInfo info;
+
+    simulated_superio_delay = 0;
+
+    XCTAssertTrue(superio_detect_ite_family(0x2e, &info));
+    XCTAssertEqual(info.model, IT8728F);
+    XCTAssertEqual(info.ldn, kFintekITEHardwareMonitorLDN);
+    XCTAssertEqual(info.address, 0xA40);
+    XCTAssertFalse(primary.entered);
+
+    // The second chip only answers to the 0xAA key, the 0x55 key of port 0x2E leaves it idle
+    XCTAssertTrue(superio_detect_ite_family(0x4e, &info));
+    XCTAssertEqual(info.model, IT8792E);
+    XCTAssertEqual(info.address, 0xA60);
+    XCTAssertFalse(secondary.entered);
+
+    // Settle, verify and exit delays of both probes
+    XCTAssertEqual(simulated_superio_delay, 60);
+}
+
+HWSENSORS_TEST(testSuperIOWrongKeyKeepsChipClosed)
+{
+    SimulatedIT87xx chip(0x4e, IT8792E, 0xA60);
+    SuperIOChipInfo info;
+
+    // 0x87 0x01 0x55 0x55 is the key of port 0x2E only
+    superio_outb(0x4e, 0x87);
+    superio_outb(0x4e, 0x01);
+    superio_outb(0x4e, 0x55);
+    superio_outb(0x4e, 0x55);
+    XCTAssertFalse(chip.entered);
+
+    XCTAssertFalse(superio_detect_winbond_family(0x4e, &info));
+    XCTAssertFalse(chip.entered);
+}
+
+HWSENSORS_TEST(testSuperIOFintekAddressOffset)
+{
+    // F71889ED reports its base address with the index register offset added
+    SimulatedF718xx chip(0x2e, F71889ED, kFintekITEHardwareMonitorLDN, 0x295);
+    SuperIOChipInfo info;
+
+    XCTAssertTrue(superio_detect_winbond_family(0x2e, &info));
+    XCTAssertEqual(info.model, F71889ED);
+    XCTAssertEqual(info.address, 0x290);
+    XCTAssertEqual(superio_listen_port_word(0x2e, FINTEK_VENDOR_ID_REGISTER), 0xFFFF);
+}
+
+HWSENSORS_TEST(testSuperIORejectsUnstableAddress)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    SuperIOChipInfo info;
+
+    chip.movingAddress = true;
+
+    XCTAssertFalse(superio_detect_winbond_family(0x2e, &info));
+    XCTAssertEqual(info.model, NCT6779D);
+    XCTAssertFalse(chip.entered);
+}
+
+HWSENSORS_TEST(testSuperIORejectsAddressOutOfBounds)
+{
+    SuperIOChipInfo info;
+
+    {
+        SimulatedIT87xx chip(0x2e, IT8728F, 0x0000);
+        XCTAssertFalse(superio_detect_ite_family(0x2e, &info));
+    }
+
+    {
+        SimulatedIT87xx chip(0x2e, IT8728F, 0xA44);
+        XCTAssertFalse(superio_detect_ite_family(0x2e, &info));
+    }
+}
+
+HWSENSORS_TEST(testSuperIOUnknownChip)
+{
+    // Chip ID present but not in the database, only the raw ID is reported
+    SimulatedW836xx chip(0x2e, 0x1234, 0x290);
+    SuperIOChipInfo info;
+
+    XCTAssertFalse(superio_detect_winbond_family(0x2e, &info));
+    XCTAssertEqual(info.id, 0x1234);
+    XCTAssertEqual(info.model, 0);
+    XCTAssertFalse(chip.entered);
+}
+
+HWSENSORS_TEST(testSuperIOBankedVendorID)
+{
+    SimulatedW836xx chip(0x2e, 0xA023, 0x290);
+    SInt16 bank = -1;
+
+    // High byte access bit selects which half of the vendor ID is returned
+    UInt16 vendor = (superio_hwm_read_banked(0x290, &bank, (WINBOND_HIGH_BYTE << 8) | WINBOND_VENDOR_ID_REGISTER) << 8) |
+                    superio_hwm_read_banked(0x290, &bank, WINBOND_VENDOR_ID_REGISTER);
+
+    XCTAssertEqual(vendor, WINBOND_VENDOR_ID);
+    XCTAssertEqual(chip.bankSelects, 2);
+}
+
+HWSENSORS_TEST(testSuperIOBankIsCached)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    SInt16 bank = -1;
+
+    chip.registers[0x0020] = 0x11;
+    chip.registers[0x0550] = 0x55;
+    chip.registers[0x0551] = 0x56;
+
+    superio_port_operations = 0;
+
+    // First access selects bank 5, the second one stays there
+    XCTAssertEqual(superio_hwm_read_banked(0x290, &bank, 0x550), 0x55);
+    XCTAssertEqual(superio_hwm_read_banked(0x290, &bank, 0x551), 0x56);
+    XCTAssertEqual(chip.bankSelects, 1);
+    XCTAssertEqual(superio_port_operations, 6);
+
+    XCTAssertEqual(superio_hwm_read_banked(0x290, &bank, 0x020), 0x11);
+    XCTAssertEqual(chip.bankSelects, 2);
+    XCTAssertEqual(bank, 0);
+
+    superio_hwm_write_banked(0x290, &bank, 0x0109, 0x80);
+    XCTAssertEqual(chip.registers[0x0109], 0x80);
+    XCTAssertEqual(chip.bankSelects, 3);
+}
+
+HWSENSORS_TEST(testSuperIOStaleBankAfterFirmwareAccess)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    SInt16 bank = -1;
+
+    chip.registers[0x0020] = 0x11;
+    chip.registers[0x0120] = 0x22;
+
+    XCTAssertEqual(superio_hwm_read_banked(0x290, &bank, 0x020), 0x11);
+
+    // Firmware leaves bank 1 selected: the cached bank reads the wrong register
+    // until the cache is invalidated, as the drivers do at the start of a transaction
+    chip.firmwareSelectsBank(1);
+    XCTAssertEqual(superio_hwm_read_banked(0x290, &bank, 0x020), 0x22);
+
+    bank = -1;
+    XCTAssertEqual(superio_hwm_read_banked(0x290, &bank, 0x020), 0x11);
+}
+
+HWSENSORS_TEST(testWinbondDivisorBitsMatchDatasheet)
+{
+    // The packed divisor bit positions used by the driver and the register/bit pairs agree
+    for (int fan = 0; fan < 5; fan++) {
+        for (UInt8 offset = 0; offset < 8; offset++) {
+            SimulatedW836xx chip(0x2e, 0xA023, 0x290);
+            UInt64 bits = 0;
+
+            bits = winbond_set_bit(bits, WINBOND_TACHOMETER_DIVISOR2[fan], (offset >> 2) & 1);
+            bits = winbond_set_bit(bits, WINBOND_TACHOMETER_DIVISOR1[fan], (offset >> 1) & 1);
+            bits = winbond_set_bit(bits, WINBOND_TACHOMETER_DIVISOR0[fan],  offset       & 1);
+
+            for (int i = 4; i >= 0; i--, bits >>= 8)
+                chip.registers[WINBOND_TACHOMETER_DIVISOR[i]] = bits & 0xFF;
+
+            XCTAssertEqual(chip.divisorOffset(fan), offset);
+        }
+    }
+}
+
+HWSENSORS_TEST(testWinbondDivisorAutoRanging)
+{
+    SimulatedW836xx chip(0x2e, 0xA023, 0x290);
+    SInt16 bank = -1;
+    UInt16 values[5] = { 0 };
+
+    // Unrelated bits sharing the divisor registers
+    chip.registers[0x47] = 0x0F;
+    chip.registers[0x5D] = 0x1F;
+
+    chip.fanRPM[0] = 600;       // count saturates at divisor 1
+    chip.fanRPM[1] = 12000;     // in range at divisor 1
+    chip.fanRPM[3] = 1500;
+    chip.fanRPM[4] = 900;       // count in bank 5
+
+    for (int pass = 0; pass < 8; pass++)
+        winbond_update_tachometers(0x290, &bank, 5, values);
+
+    XCTAssertEqualWithAccuracy(values[0], 600, 6);
+    XCTAssertEqualWithAccuracy(values[1], 12000, 120);
+    XCTAssertEqual(values[2], 0);
+    XCTAssertEqualWithAccuracy(values[3], 1500, 15);
+    XCTAssertEqualWithAccuracy(values[4], 900, 9);
+
+    // Settled counts are within the window where one count is under 1% of the speed
+    for (int fan = 0; fan < 5; fan++) {
+        if (chip.fanRPM[fan] > 0) {
+            UInt8 count = chip.readRegister(WINBOND_TACHOMETER[fan]);
+            XCTAssertTrue(count >= 96 && count <= 192);
+        }
+    }
+
+    XCTAssertEqual(chip.registers[0x47] & 0x0F, 0x0F);
+    XCTAssertEqual(chip.registers[0x5D] & 0x1F, 0x1F);
+
+    // Steady state reads the divisors and counts without writing them back
+    int selects = chip.bankSelects;
+    std::map<UInt16, UInt8> divisors = chip.registers;
+
+    winbond_update_tachometers(0x290, &bank, 5, values);
+
+    XCTAssertTrue(divisors == chip.registers);
+    XCTAssertEqual(chip.bankSelects - selects, 2);
+}
+
+HWSENSORS_TEST(testWinbondStoppedFan)
+{
+    XCTAssertEqual(winbond_fan_rpm(0xFF, 3), 0);
+    XCTAssertEqual(winbond_fan_rpm(0, 3), 0);
+    XCTAssertEqualWithAccuracy(winbond_fan_rpm(150, 3), 1125, 1);
+
+    XCTAssertEqual(winbond_next_divisor_offset(0xFF, 7), 7);
+    XCTAssertEqual(winbond_next_divisor_offset(0xFF, 2), 3);
+    XCTAssertEqual(winbond_next_divisor_offset(10, 0), 0);
+}
+
+HWSENSORS_TEST(testNuvotonFanSpeed)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    SInt16 bank = -1;
+    int minFanRPM = (int)(1.35e6 / 0x1FFF);
+
+    chip.fanRPM[0] = 1234;
+    chip.fanRPM[2] = 100;
+
+    XCTAssertEqual(nuvoton_fan_rpm(superio_hwm_read_banked(0x290, &bank, 0x4C0), superio_hwm_read_banked(0x290, &bank, 0x4C1), minFanRPM), 1234);
+    XCTAssertEqual(nuvoton_fan_rpm(superio_hwm_read_banked(0x290, &bank, 0x4C2), superio_hwm_read_banked(0x290, &bank, 0x4C3), minFanRPM), 0);
+
+    // Under the count limit of a 13 bit tachometer
+    XCTAssertEqual(nuvoton_fan_rpm(superio_hwm_read_banked(0x290, &bank, 0x4C4), superio_hwm_read_banked(0x290, &bank, 0x4C5), minFanRPM), 0);
+    XCTAssertEqual(chip.bankSelects, 1);
+}
+
+HWSENSORS_TEST(testITEFanSpeed16Bit)
+{
+    SimulatedIT87xx chip(0x2e, IT8728F, 0xA40);
+
+    chip.fanRPM[0] = 2000;
+    chip.fanRPM[3] = 650;
+
+    for (int fan = 0; fan < 5; fan++) {
+        UInt32 count = superio_hwm_read(0xA40, ITE_FAN_TACHOMETER_REG[fan]) | (superio_hwm_read(0xA40, ITE_FAN_TACHOMETER_EXT_REG[fan]) << 8);
+
+        XCTAssertEqualWithAccuracy(ite_fan_rpm16(count), chip.fanRPM[fan], chip.fanRPM[fan] / 100);
+    }
+
+    // Counts under 0x40 are out of range for the 16 bit counter
+    XCTAssertEqual(ite_fan_rpm16(0x3f), 0);
+}
+
+HWSENSORS_TEST(testITEFanSpeed8Bit)
+{
+    SimulatedIT87xx chip(0x2e, IT8712F, 0xA40);
+
+    chip.sixteenBitFans = false;
+    chip.registers[ITE_FAN_TACHOMETER_DIVISOR_REGISTER] = 3 | (2 << 3);
+
+    chip.fanRPM[0] = 900;
+    chip.fanRPM[1] = 2500;
+    chip.fanRPM[2] = 4000;
+
+    UInt8 divisors = superio_hwm_read(0xA40, ITE_FAN_TACHOMETER_DIVISOR_REGISTER);
+
+    for (int fan = 0; fan < 3; fan++) {
+        UInt8 count = superio_hwm_read(0xA40, ITE_FAN_TACHOMETER_REG[fan]);
+
+        XCTAssertEqualWithAccuracy(ite_fan_rpm8(count, divisors, fan), chip.fanRPM[fan], chip.fanRPM[fan] / 50);
+    }
+
+    // Stopped fan saturates the counter
+    XCTAssertEqual(ite_fan_rpm8(superio_hwm_read(0xA40, ITE_FAN_TACHOMETER_REG[4]), divisors, 4), 0);
+}
+
+HWSENSORS_TEST(testFintekFanSpeed)
+{
+    SimulatedF718xx chip(0x2e, F71889ED, kFintekITEHardwareMonitorLDN, 0x295);
+
+    chip.fanRPM[0] = 1500;
+    chip.fanRPM[1] = 3700;
+
+    for (int fan = 0; fan < 4; fan++) {
+        float rpm = fintek_fan_rpm(superio_hwm_read(0x290, FINTEK_FAN_TACHOMETER_REG[fan]), superio_hwm_read(0x290, FINTEK_FAN_TACHOMETER_REG[fan] + 1));
+
+        XCTAssertEqualWithAccuracy(rpm, chip.fanRPM[fan], chip.fanRPM[fan] / 100 + 1);
+    }
+}
+
+static int hook_reads = 0, hook_writes = 0;
+
+static UInt8 hook_read(i386_ioport_t port)
+{
+    hook_reads++;
+    return 0x5A;
+}
+
+static void hook_write(i386_ioport_t port, UInt8 value)
+{
+    hook_writes++;
+}
+
+HWSENSORS_TEST(testSuperIOPortIOHook)
+{
+    // Replacing the backend reroutes every access, a NULL backend restores the default one
+    SuperIOPortIO io = { hook_read, hook_write };
+
+    superio_set_port_io(&io);
+    XCTAssertEqual(superio_hwm_read(0x290, 0x20), 0x5A);
+    superio_set_port_io(NULL);
+
+    XCTAssertEqual(hook_reads, 1);
+    XCTAssertEqual(hook_writes, 1);
+    XCTAssertEqual(superio_hwm_read(0x290, 0x20), 0xFF);
+}
+
+// One sensor sweep: every register read once in the given order, the bank cache is invalidated at the
+// start like in didBeginTransaction. Uncached, the bank is reprogrammed before each access as readByte
+// did before the cache: four port operations per register instead of two
+static UInt64 sweep_port_operations(const std::vector<UInt16> &registers, bool cached, std::vector<UInt8> &values)
+{
+    UInt64 operations = superio_port_operations;
+    SInt16 bank = -1;
+
+    values.clear();
+
+    for (size_t i = 0; i < registers.size(); i++) {
+        if (!cached)
+            bank = -1;
+
+        values.push_back(superio_hwm_read_banked(0x290, &bank, registers[i]));
+    }
+
+    return superio_port_operations - operations;
+}
+
+// NCT6779D registers in the order the driver reads them: temperatures, voltages (VBAT checks the
+// monitor enable bit in bank 0), fans
+static std::vector<UInt16> nuvoton_sweep_registers(const NuvotonChipDescriptor *chip)
+{
+    std::vector<UInt16> registers;
+
+    for (int i = 0; i < chip->temperatureLimit; i++)
+        registers.push_back(chip->temperatureRegisters[i]);
+
+    for (int i = 0; i < chip->voltageLimit; i++) {
+        registers.push_back(chip->voltageRegisters[i]);
+
+        if (chip->voltageRegisters[i] == chip->voltageVBatRegister)
+            registers.push_back(0x5D);
+    }
+
+    for (int i = 0; i < chip->fanLimit; i++) {
+        registers.push_back(chip->fanRpmBaseRegister + (i << 1));
+        registers.push_back(chip->fanRpmBaseRegister + (i << 1) + 1);
+    }
+
+    return registers;
+}
+
+HWSENSORS_TEST(testNuvotonSweepPortOperations)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    std::vector<UInt16> registers = nuvoton_sweep_registers(&NUVOTON_CHIPS[2]);
+    std::vector<UInt8> before, after, sorted;
+
+    XCTAssertEqual(NUVOTON_CHIPS[2].model, NCT6779D);
+    XCTAssertEqual(registers.size(), 33);
+
+    for (size_t i = 0; i < registers.size(); i++)
+        chip.registers[registers[i]] = (UInt8)i;
+
+    chip.fanRPM[0] = 1200;
+
+    UInt64 uncached = sweep_port_operations(registers, false, before);
+    UInt64 cached = sweep_port_operations(registers, true, after);
+
+    // Bank 0, 1, 4, 0 for the VBAT enable bit, back to 4
+    XCTAssertEqual(uncached, 132);
+    XCTAssertEqual(cached, 2 * 33 + 2 * 5);
+    XCTAssertTrue(before == after);
+
+    // The register snapshot refreshes in register order, each bank is selected once
+    std::sort(registers.begin(), registers.end());
+
+    XCTAssertEqual(sweep_port_operations(registers, true, sorted), 2 * 33 + 2 * 3);
+}
+
+HWSENSORS_TEST(testWinbondSweepPortOperations)
+{
+    SimulatedW836xx chip(0x2e, 0xA023, 0x290);
+    std::vector<UInt8> before, after;
+
+    // W83627DHG: temperatures with their half degree bits, voltages with VBAT, then the
+    // divisors and counts of the tachometer update
+    const UInt16 sweep[] = {
+        0x150, 0x151, 0x250, 0x251, 0x027,
+        0x020, 0x021, 0x022, 0x023, 0x024, 0x025, 0x026, 0x550, 0x05D, 0x551,
+        0x047, 0x04B, 0x04C, 0x059, 0x05D, 0x028, 0x029, 0x02A, 0x03F, 0x553,
+    };
+
+    std::vector<UInt16> registers(sweep, sweep + sizeof(sweep) / sizeof(sweep[0]));
+
+    chip.fanRPM[0] = 1500;
+    chip.fanRPM[4] = 900;
+
+    UInt64 uncached = sweep_port_operations(registers, false, before);
+    UInt64 cached = sweep_port_operations(registers, true, after);
+
+    // Bank 1, 2, 0, 5, 0, 5, 0, 5
+    XCTAssertEqual(uncached, 4 * 25);
+    XCTAssertEqual(cached, 2 * 25 + 2 * 8);
+    XCTAssertTrue(before == after);
+}
+
+HWSENSORS_TEST(testNuvotonCurveSource)
+{
+    const NuvotonChipDescriptor *nct6779d = &NUVOTON_CHIPS[2];
+    const NuvotonChipDescriptor *nct6776f = &NUVOTON_CHIPS[1];
+
+    // SYSTIN, CPUTIN and AUXTIN inputs map to fixed source codes
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 1, 0), 1);
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 2, 0), 2);
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 5, 0), 5);
+    XCTAssertEqual(nuvoton_curve_source(nct6776f, 3, 0), 3);
+
+    // The first input follows the source select register, reserved bits are dropped
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 0, 0xE2), 2);
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 0, 0x10), 0x10);
+
+    // Inputs with their own source select, and inputs the chip does not have, keep the curve in software
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 6, 0x10), 0);
+    XCTAssertEqual(nuvoton_curve_source(nct6776f, 4, 0), 0);
+    XCTAssertEqual(nuvoton_curve_source(nct6779d, 7, 0), 0);
+}
+
+HWSENSORS_TEST(testFirmwareLockAccounting)
+{
+    LPCSensorsFirmwareLockStatistics statistics = { 0, 0, 0, 0 };
+    int published = 0;
+
+    for (int i = 0; i < 2 * kLPCSensorsFirmwareLockReportInterval; i++)
+        published += lpc_lock_account(&statistics, i == 7 ? 3000 : 1000, true);
+
+    // Timeouts are published at once and don't count as acquisitions
+    XCTAssertTrue(lpc_lock_account(&statistics, 20000, false));
+
+    XCTAssertEqual(published, 2);
+    XCTAssertEqual(statistics.acquired, 2 * kLPCSensorsFirmwareLockReportInterval);
+    XCTAssertEqual(statistics.timeouts, 1);
+    XCTAssertEqual(statistics.waitTotal, 2 * kLPCSensorsFirmwareLockReportInterval * 1000 + 2000 + 20000);
+    XCTAssertEqual(statistics.waitMax, 20000);
+}
+
+// Firmware contender (EC polling, SMM handlers): critical sections on the monitor ports start at
+// random times and hold them for 50-500 us, every 200th one longer than the lock timeout. When it
+// takes the same lock it waits for a transaction in progress, otherwise it reads its own register
+// in the middle of one. Time is virtual, in microseconds
+#define kContenderGap           5000    // between sections on average
+#define kContenderLongHold      30000
+#define kContenderLongEvery     200
+#define kContenderRegister      0x250   // bank 2, nothing the sweep reads
+#define kPortOperationTime      1       // one LPC I/O cycle
+#define kSweepInterval          10000
+#define kSweepCount             5000
+
+struct FirmwareContender {
+    SimulatedSuperIO    *chip;
+    bool                coordinated;
+    bool                driverHolds;
+    UInt32              seed;
+    UInt32              sections;
+    double              time;
+    double              start;          // next section
+    double              busy;           // end of the current section
+
+    double uniform()
+    {
+        seed = seed * 1103515245 + 12345;
+        return ((seed >> 8) & 0xFFFFFF) / 16777216.0;
+    }
+
+    void advance(double now)
+    {
+        time = now;
+
+        // A section due while we hold the lock starts on release
+        while (start <= time && !(coordinated && driverHolds)) {
+            double hold = ++sections % kContenderLongEvery ? 50 + 450 * uniform() : kContenderLongHold;
+
+            busy = start + hold;
+            chip->firmwareReads(kContenderRegister);
+            start = busy + 2 * kContenderGap * uniform();
+        }
+    }
+
+    // Waits for the section in progress, like the ACPI lock does, false on timeout
+    bool acquire(double timeout, double *wait)
+    {
+        double from = time;
+
+        if (coordinated && busy > time) {
+            if (busy - time > timeout) {
+                advance(time + timeout);
+                *wait = timeout;
+                return false;
+            }
+
+            time = busy;
+        }
+
+        driverHolds = true;
+        advance(time);
+        *wait = time - from;
+
+        return true;
+    }
+
+    void release()
+    {
+        driverHolds = false;
+
+        if (start < time)
+            start = time;
+
+        advance(time);
+    }
+};
+
+static FirmwareContender *contender = NULL;
+static SuperIOPortIO contended_io;
+
+// Every port operation takes an I/O cycle, firmware sections due meanwhile run first
+static UInt8 contended_read(i386_ioport_t port)
+{
+    contender->advance(contender->time + kPortOperationTime);
+    return contended_io.read(port);
+}
+
+static void contended_write(i386_ioport_t port, UInt8 value)
+{
+    contender->advance(contender->time + kPortOperationTime);
+    contended_io.write(port, value);
+}
+
+struct ContentionResult {
+    int     corrupted;
+    int     skipped;
+    double  waitMean;
+    double  waitP95;
+    double  waitP99;
+    double  sweepMean;
+    LPCSensorsFirmwareLockStatistics statistics;
+};
+
+// Sweeps the NCT6779D every 10 ms with some jitter for 50 s against the contender
+static ContentionResult run_contention(bool coordinated)
+{
+    SimulatedNCT677x chip(0x2e, 0xC562, 0x290);
+    std::vector<UInt16> registers = nuvoton_sweep_registers(&NUVOTON_CHIPS[2]);
+    std::vector<UInt8> expected, values;
+    std::vector<double> waits;
+    ContentionResult result = { 0, 0, 0, 0, 0, 0, { 0, 0, 0, 0 } };
+    FirmwareContender firmware = { &chip, coordinated, false, 12345, 0, 0, kContenderGap, 0 };
+    double next = 0, swept = 0;
+
+    for (size_t i = 0; i < registers.size(); i++)
+        chip.registers[registers[i]] = (UInt8)i;
+
+    chip.fanRPM[0] = 1200;
+
+    sweep_port_operations(registers, true, expected);
+
+    SuperIOPortIO io = { contended_read, contended_write };
+
+    contender = &firmware;
+    contended_io = superio_port_io;
+    superio_set_port_io(&io);
+
+    for (int sweep = 0; sweep < kSweepCount; sweep++) {
+        double wait;
+
+        next += kSweepInterval * (0.5 + firmware.uniform());
+        firmware.advance(next);
+
+        bool acquired = firmware.acquire(kLPCSensorsFirmwareLockTimeout * 1000, &wait);
+
+        lpc_lock_account(&result.statistics, (UInt64)(wait * 1000), acquired);
+        waits.push_back(wait);
+
+        // Sensors keep their previous values
+        if (!acquired) {
+            result.skipped++;
+            continue;
+        }
+
+        double begin = firmware.time;
+
+        sweep_port_operations(registers, true, values);
+
+        swept += firmware.time - begin;
+
+        if (values != expected)
+            result.corrupted++;
+
+        firmware.release();
+    }
+
+    superio_set_port_io(&contended_io);
+    contender = NULL;
+
+    std::sort(waits.begin(), waits.end());
+
+    result.waitMean = result.statistics.waitTotal / 1000.0 / kSweepCount;
+    result.waitP95 = waits[waits.size() * 95 / 100];
+    result.waitP99 = waits[waits.size() * 99 / 100];
+    result.sweepMean = swept / (kSweepCount - result.skipped);
+
+    return result;
+}
+
+HWSENSORS_TEST(testFirmwareLockContention)
+{
+    ContentionResult unlocked = run_contention(false);
+    ContentionResult locked = run_contention(true);
+
+    printf("    %-8s %9s %7s %9s %10s %10s %10s %10s\n", "lock", "corrupted", "skipped", "sweep", "wait mean", "wait p95", "wait p99", "wait max");
+    printf("    %-8s %9d %7d %7.1fus %8.1fus %8.1fus %8.1fus %8.1fus\n", "none", unlocked.corrupted, unlocked.skipped,
+           unlocked.sweepMean, unlocked.waitMean, unlocked.waitP95, unlocked.waitP99, unlocked.statistics.waitMax / 1000.0);
+    printf("    %-8s %9d %7d %7.1fus %8.1fus %8.1fus %8.1fus %8.1fus\n", "firmware", locked.corrupted, locked.skipped,
+           locked.sweepMean, locked.waitMean, locked.waitP95, locked.waitP99, locked.statistics.waitMax / 1000.0);
+
+    // Without coordination the contender lands in the middle of some sweeps
+    XCTAssertTrue(unlocked.corrupted > 0);
+    XCTAssertEqual(unlocked.skipped, 0);
+    XCTAssertEqual(unlocked.statistics.waitMax, 0);
+
+    // With it no sweep is corrupted, sweeps that would wait past the timeout are skipped instead
+    XCTAssertEqual(locked.corrupted, 0);
+    XCTAssertTrue(locked.skipped > 0);
+    XCTAssertEqual(locked.skipped, locked.statistics.timeouts);
+    XCTAssertEqual(locked.statistics.acquired + locked.statistics.timeouts, kSweepCount);
+    XCTAssertEqual(locked.statistics.waitMax, kLPCSensorsFirmwareLockTimeout * 1000000ULL);
+
+    // Short sections cost at most their length, the tail and the mean come from the long ones
+    XCTAssertLessThanOrEqual(locked.skipped * 100, kSweepCount);
+    XCTAssertLessThanOrEqual(locked.waitP95, 500);
+    XCTAssertLessThanOrEqual(locked.waitMean, 1000);
+    XCTAssertEqualWithAccuracy(locked.sweepMean, unlocked.sweepMean, 0.001);
+}
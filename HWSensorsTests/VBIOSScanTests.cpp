@@ -0,0 +1,246 @@
+//
+//  VBIOSScanTests.cpp
+//  HWSensorsTests
+//
+//  Signature search from vbios_scan.h checked against the naive search it
+//  replaced, on random images and on synthetic full-size ROM images.
+//
+
+#include "HWSensorsTests.h"
+#include "vbios_scan.h"
+
+#include <time.h>
+#include <vector>
+
+static const u8 bitSignature[] = { 0xff, 0xb8, 'B', 'I', 'T' };
+static const u8 bmpSignature[] = { 0xff, 0x7f, 'N', 'V', 0x0 };
+static const u8 pcirSignature[] = { 'P', 'C', 'I', 'R' };
+
+static const struct vbios_signature nouveauSignatures[] = {
+    { (const char *)bitSignature, sizeof(bitSignature) },
+    { (const char *)bmpSignature, sizeof(bmpSignature) },
+};
+
+static const struct vbios_signature mixedSignatures[] = {
+    { (const char *)bmpSignature, sizeof(bmpSignature) },
+    { (const char *)pcirSignature, sizeof(pcirSignature) },
+};
+
+// nvbios_findstr of nouveau_bios.cpp before the scanner, without the u16 truncation
+static u32 naive_findstr(const u8 *data, int size, const char *str, int len)
+{
+    int i, j;
+
+    for (i = 0; i <= (size - len); i++) {
+        for (j = 0; j < len; j++)
+            if ((char)data[i + j] != str[j])
+                break;
+        if (j == len)
+            return i;
+    }
+
+    return 0;
+}
+
+// Same search from position 1, position 0 is taken by the ROM header and means "not found"
+static u32 reference_find(const u8 *data, int size, const char *str, int len)
+{
+    for (int i = 1; i + len <= size; i++)
+        if (!memcmp(data + i, str, len))
+            return i;
+
+    return 0;
+}
+
+static UInt32 vbios_seed = 1;
+
+static UInt32 vbios_random(void)
+{
+    vbios_seed = vbios_seed * 1103515245 + 12345;
+    return vbios_seed >> 8;
+}
+
+// Bytes from a small alphabet around the signatures' own bytes, so partial matches are frequent
+static void fill_random_image(u8 *data, int size)
+{
+    static const u8 alphabet[] = { 0xff, 0xff, 0xff, 0xb8, 0x7f, 'B', 'I', 'T', 'N', 'V', 0x00, 'P', 'C', 'R', 0x55, 0xaa };
+
+    for (int i = 0; i < size; i++)
+        data[i] = alphabet[vbios_random() % sizeof(alphabet)];
+}
+
+static void plant(u8 *data, int size, const u8 *signature, int length)
+{
+    if (size < length)
+        return;
+
+    int at = vbios_random() % (size - length + 1);
+
+    memcpy(data + at, signature, length);
+}
+
+HWSENSORS_TEST(testVBIOSScanMatchesNaiveSearch)
+{
+    // Extra room for every start alignment of the image
+    u8 buffer[300 + sizeof(u64)];
+    int mismatches = 0, found = 0;
+
+    vbios_seed = 1;
+
+    for (int round = 0; round < 20000; round++) {
+        int size = 1 + vbios_random() % 300;
+        u8 *data = buffer + vbios_random() % sizeof(u64);
+
+        fill_random_image(data, size);
+
+        if (vbios_random() % 2)
+            plant(data, size, bitSignature, sizeof(bitSignature));
+        if (vbios_random() % 2)
+            plant(data, size, bmpSignature, sizeof(bmpSignature));
+        if (vbios_random() % 4 == 0)
+            plant(data, size, pcirSignature, sizeof(pcirSignature));
+
+        const struct vbios_signature *sets[] = { nouveauSignatures, mixedSignatures };
+
+        for (int set = 0; set < 2; set++) {
+            u32 offsets[2];
+            int count = vbios_find_signatures(data, size, sets[set], 2, offsets);
+            int expected = 0;
+
+            for (int n = 0; n < 2; n++) {
+                u32 naive = reference_find(data, size, sets[set][n].data, sets[set][n].length);
+
+                if (offsets[n] != naive)
+                    mismatches++;
+
+                expected += naive != 0;
+            }
+
+            if (count != expected)
+                mismatches++;
+
+            found += count;
+        }
+
+        // Word test agrees with a bytewise one
+        u64 word = ((u64)vbios_random() << 40) ^ ((u64)vbios_random() << 16) ^ vbios_random();
+        u8 c = (u8)(word >> (8 * (vbios_random() % 10)));
+        bool bytewise = false;
+
+        for (int b = 0; b < 8; b++)
+            bytewise |= (u8)(word >> (8 * b)) == c;
+
+        if (!vbios_scan_word_has_byte(word, VBIOS_SCAN_ONES * c) != !bytewise)
+            mismatches++;
+    }
+
+    XCTAssertEqual(mismatches, 0);
+    XCTAssertTrue(found > 20000);
+}
+
+HWSENSORS_TEST(testVBIOSScanEdgeCases)
+{
+    u8 image[64];
+
+    memset(image, 0xff, sizeof(image));
+
+    // Signature cut by the end of the image, at the very end, and at 0 which means "not found"
+    memcpy(image + sizeof(image) - 3, bitSignature, 3);
+    XCTAssertEqual(vbios_find_signature(image, sizeof(image), (const char *)bitSignature, sizeof(bitSignature)), 0);
+
+    memcpy(image + sizeof(image) - sizeof(bitSignature), bitSignature, sizeof(bitSignature));
+    XCTAssertEqual(vbios_find_signature(image, sizeof(image), (const char *)bitSignature, sizeof(bitSignature)), sizeof(image) - sizeof(bitSignature));
+
+    memcpy(image, bmpSignature, sizeof(bmpSignature));
+    XCTAssertEqual(vbios_find_signature(image, sizeof(image), (const char *)bmpSignature, sizeof(bmpSignature)), 0);
+
+    // First occurrence wins
+    memcpy(image + 16, bmpSignature, sizeof(bmpSignature));
+    memcpy(image + 32, bmpSignature, sizeof(bmpSignature));
+    XCTAssertEqual(vbios_find_signature(image, sizeof(image), (const char *)bmpSignature, sizeof(bmpSignature)), 16);
+
+    XCTAssertEqual(vbios_find_signature(NULL, 0, (const char *)bmpSignature, sizeof(bmpSignature)), 0);
+    XCTAssertEqual(vbios_find_signature(image, 0, (const char *)bmpSignature, sizeof(bmpSignature)), 0);
+}
+
+// Synthetic ROM: 55 AA header and PCIR structure, code and tables of random bytes with the
+// 0xFF density of real images, BIT header at bit (or none) and 0xFF padding over the last quarter
+static void build_rom_image(std::vector<u8> &image, int size, int bit)
+{
+    image.assign(size, 0xff);
+
+    for (int i = 0; i < size * 3 / 4; i++)
+        image[i] = vbios_random() % 16 == 0 ? 0xff : (u8)vbios_random();
+
+    image[0] = 0x55;
+    image[1] = 0xaa;
+    image[2] = size / 512;
+    memcpy(&image[0x40], pcirSignature, sizeof(pcirSignature));
+
+    if (bit)
+        memcpy(&image[bit], bitSignature, sizeof(bitSignature));
+}
+
+static double elapsed_us(const struct timespec &from, const struct timespec &to)
+{
+    return (to.tv_sec - from.tv_sec) * 1e6 + (to.tv_nsec - from.tv_nsec) / 1e3;
+}
+
+HWSENSORS_TEST(testVBIOSScanBenchmark)
+{
+    struct {
+        const char *name;
+        int size;
+        int bit;
+    } roms[] = {
+        { "64K, BIT at 0x1a0",  0x10000, 0x1a0 },
+        { "128K, BIT at 0x1a0", 0x20000, 0x1a0 },
+        { "128K, BMP only",     0x20000, 0 },
+        { "256K, BMP only",     0x40000, 0 },
+    };
+
+    const int iterations = 200;
+    std::vector<u8> image;
+    volatile u32 sink = 0;
+
+    vbios_seed = 7;
+
+    printf("    %-20s %12s %12s %8s\n", "image", "naive", "scanner", "speedup");
+
+    for (size_t r = 0; r < sizeof(roms) / sizeof(roms[0]); r++) {
+        build_rom_image(image, roms[r].size, roms[r].bit);
+
+        const u8 *data = &image[0];
+        int size = (int)image.size();
+        u32 offsets[2] = { 0, 0 };
+        struct timespec t0, t1, t2;
+
+        // Before the scanner BIT and BMP were searched for in two passes
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+
+        for (int i = 0; i < iterations; i++) {
+            sink += naive_findstr(data, size, (const char *)bitSignature, sizeof(bitSignature));
+            sink += naive_findstr(data, size, (const char *)bmpSignature, sizeof(bmpSignature));
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+
+        for (int i = 0; i < iterations; i++) {
+            vbios_find_signatures(data, size, nouveauSignatures, 2, offsets);
+            sink += offsets[0] + offsets[1];
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &t2);
+
+        double naive = elapsed_us(t0, t1) / iterations, scanner = elapsed_us(t1, t2) / iterations;
+
+        printf("    %-20s %10.1fus %10.1fus %7.1fx\n", roms[r].name, naive, scanner, naive / scanner);
+
+        // Anchors other than 0xFF keep the padding and 0xFF filled tables out of the candidates
+        XCTAssertLessThanOrEqual(scanner, naive);
+
+        XCTAssertEqual(offsets[0], roms[r].bit);
+        XCTAssertEqual(offsets[0], naive_findstr(data, size, (const char *)bitSignature, sizeof(bitSignature)));
+        XCTAssertEqual(offsets[1], naive_findstr(data, size, (const char *)bmpSignature, sizeof(bmpSignature)));
+    }
+}
@@ -129,6 +129,7 @@
 #define KEY_CPU_PACKAGE_GFX_POWER               "PCPG" // SNB
 #define KEY_CPU_PACKAGE_TOTAL_POWER             "PCTR" //"PCPT" // SNB
 #define KEY_CPU_PACKAGE_DRAM_POWER              "PCPD" // ??
+#define KEY_CPU_PACKAGE_PLATFORM_POWER          "PCPS" // SKL PSYS domain
 
 
 // FANs
@@ -159,6 +160,15 @@
 #define KEY_FAKESMC_FORMAT_CPU_MULTIPLIER		"MlC%X"
 #define KEY_FAKESMC_CPU_PACKAGE_MULTIPLIER      "MlCP"
 
+#define KEY_FAKESMC_FORMAT_CPU_POWER_LIMIT      "PCL%X" // PL1, PL2, W (sp78, limits are in fractional RAPL power units)
+#define KEY_FAKESMC_CPU_PACKAGE_THROTTLE        "PCTh" // Package time throttled by RAPL, %
+
+#define KEY_FAKESMC_FORMAT_CPU_CORE_EVENTS      "CE%X%c" // Core %X throttle event counter: T thermal, H PROCHOT, C critical, L power limit
+#define KEY_FAKESMC_FORMAT_CPU_PACKAGE_EVENTS   "CEP%c"  // Package throttle event counter
+
+#define KEY_FAKESMC_FORMAT_CPU_CORE_RESIDENCY       "CR%X%X" // Core %X C-state %X residency, %
+#define KEY_FAKESMC_FORMAT_CPU_PACKAGE_RESIDENCY    "CRP%X"  // Package C-state %X residency, %
+
 // Services
 #define kFakeSMCService                         "FakeSMC"
 #define kFakeSMCDeviceService                   "FakeSMCDevice"
@@ -68,7 +68,7 @@ static int sclhi(struct i2c_algo_bit_data *adap)
 		 * chips may hold it low ("clock stretching") while they
 		 * are processing data internally.
 		 */
-		if (end - ptimer_read() <= 0) {
+		if (ptimer_read() >= end) {
 			/* Test one last time, as we may have been preempted
 			 * between last check and timeout test.
 			 */
@@ -0,0 +1,115 @@
+//
+//  vbios_scan.h
+//  HWSensors
+//
+//  Signature search in VBIOS images shared by GPU plugins. Candidate
+//  positions are found a machine word at a time by looking for an anchor
+//  byte of each signature, only candidates are compared in full. Vector
+//  registers are not used as kernel code is built without SSE state.
+//
+
+#ifndef HWSensors_vbios_scan_h
+#define HWSensors_vbios_scan_h
+
+#include "linux_definitions.h"
+
+struct vbios_signature {
+    const char *data;
+    int length;
+};
+
+#define VBIOS_SCAN_ONES     0x0101010101010101ULL
+#define VBIOS_SCAN_HIGHS    0x8080808080808080ULL
+
+// Non zero if any byte of the word is equal to the byte repeated in pattern
+inline u64 vbios_scan_word_has_byte(u64 word, u64 pattern)
+{
+    u64 v = word ^ pattern;
+
+    return (v - VBIOS_SCAN_ONES) & ~v & VBIOS_SCAN_HIGHS;
+}
+
+#define VBIOS_SCAN_MAX_SIGNATURES   4
+
+// Anchor of a signature is its last byte other than 0x00 and 0xFF, these two fill
+// most of an image (padding, empty tables) and would make every position a candidate
+inline int vbios_scan_anchor(const struct vbios_signature *sig)
+{
+    for (int k = sig->length - 1; k > 0; k--)
+        if ((u8)sig->data[k] != 0x00 && (u8)sig->data[k] != 0xff)
+            return k;
+
+    return 0;
+}
+
+// Finds the first occurrence of each signature in a single pass.
+// offsets[n] receives the position of sigs[n] or 0 when not found (0 is
+// not a valid table position as it is taken by ROM header). Returns the
+// number of signatures found.
+inline int vbios_find_signatures(const u8 *data, int size, const struct vbios_signature *sigs, int count, u32 *offsets)
+{
+    int anchors[VBIOS_SCAN_MAX_SIGNATURES];
+    u64 patterns[VBIOS_SCAN_MAX_SIGNATURES];
+    int found = 0, n, i = 0;
+
+    for (n = 0; n < count; n++)
+        offsets[n] = 0;
+
+    if (!data || size <= 0 || count <= 0)
+        return 0;
+
+    if (count > VBIOS_SCAN_MAX_SIGNATURES)
+        return vbios_find_signatures(data, size, sigs, VBIOS_SCAN_MAX_SIGNATURES, offsets) +
+               vbios_find_signatures(data, size, sigs + VBIOS_SCAN_MAX_SIGNATURES, count - VBIOS_SCAN_MAX_SIGNATURES, offsets + VBIOS_SCAN_MAX_SIGNATURES);
+
+    for (n = 0; n < count; n++) {
+        anchors[n] = vbios_scan_anchor(&sigs[n]);
+        patterns[n] = VBIOS_SCAN_ONES * (u8)sigs[n].data[anchors[n]];
+    }
+
+    while (i < size && found < count) {
+        // Aligned words without any anchor byte are skipped whole
+        if (!((uintptr_t)(data + i) & (sizeof(u64) - 1)) && i + (int)sizeof(u64) <= size) {
+            u64 word = *(const u64 *)(data + i);
+            u64 hit = 0;
+
+            for (n = 0; n < count; n++)
+                if (!offsets[n])
+                    hit |= vbios_scan_word_has_byte(word, patterns[n]);
+
+            if (!hit) {
+                i += sizeof(u64);
+                continue;
+            }
+        }
+
+        for (n = 0; n < count; n++) {
+            int start = i - anchors[n];
+
+            // Match at position 0 can't be distinguished from "not found"
+            if (offsets[n] || data[i] != (u8)sigs[n].data[anchors[n]] || start <= 0 || start + sigs[n].length > size)
+                continue;
+
+            if (!memcmp(data + start, sigs[n].data, sigs[n].length)) {
+                offsets[n] = start;
+                found++;
+            }
+        }
+
+        i++;
+    }
+
+    return found;
+}
+
+inline u32 vbios_find_signature(const u8 *data, int size, const char *str, int len)
+{
+    struct vbios_signature sig = { str, len };
+    u32 offset;
+
+    vbios_find_signatures(data, size, &sig, 1, &offset);
+
+    return offset;
+}
+
+#endif
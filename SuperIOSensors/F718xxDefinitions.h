@@ -0,0 +1,59 @@
+//
+//  F718xxDefinitions.h
+//  HWSensors
+//
+//  Fintek hardware monitor registers and chip descriptors, free of IOKit so
+//  they can be used by HWSensorsTests.
+//
+
+#ifndef HWSensors_F718xxDefinitions_h
+#define HWSensors_F718xxDefinitions_h
+
+#include "SuperIODefinitions.h"
+
+// Registers
+const UInt8 FINTEK_VENDOR_ID_REGISTER = 0x23;
+const UInt16 FINTEK_VENDOR_ID = 0x1934;
+
+// Hardware Monitor Registers
+const UInt8 FINTEK_TEMPERATURE_CONFIG_REG   = 0x69;
+const UInt8 FINTEK_TEMPERATURE_BASE_REG     = 0x70;
+const UInt8 FINTEK_VOLTAGE_BASE_REG         = 0x20;
+const UInt8 FINTEK_FAN_TACHOMETER_REG[]     = { 0xA0, 0xB0, 0xC0, 0xD0 };
+const UInt8 FINTEK_TEMPERATURE_EXT_REG[]     = { 0x7A, 0x7B, 0x7C, 0x7E };
+
+// Per-model description, bound once at start so the read path does no model branching
+struct FintekChipDescriptor {
+    UInt16          model;
+    UInt8           temperatureLimit;
+    UInt8           voltageLimit;
+    UInt8           fanLimit;
+    UInt8           reservedVoltage;        // voltage input not to be read, 0xFF if none
+    bool            wideTemperature;        // F71858 reports temperatures in 11 bit table modes
+};
+
+const FintekChipDescriptor FINTEK_CHIPS[] = {
+    { F71858,   3, 0, 4, 0xFF,  true },
+    { F71862,   3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71868A,  3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71869,   3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71869A,  3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71882,   3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 4, 0xFF, false },
+    { F71889AD, 3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71889ED, 3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71889F,  3 + sizeof(FINTEK_TEMPERATURE_EXT_REG), 9, 3, 0xFF, false },
+    { F71808E,  2,                                      9, 3, 6,    false }, // 0x26 is reserved on F71808E
+};
+
+// Fan counts are 12 bit big endian at FINTEK_FAN_TACHOMETER_REG, 0x0FFF and above means the fan is stopped
+inline float fintek_fan_rpm(UInt8 high, UInt8 low)
+{
+    SInt32 value = (high << 8) | low;
+
+    if (value > 0)
+        value = (value < 0x0fff) ? 1.5e6f / (float)value : 0;
+
+    return value;
+}
+
+#endif
@@ -53,42 +53,29 @@
 #define super LPCSensors
 OSDefineMetaClassAndStructors(F718xxSensors, LPCSensors)
 
-UInt8 F718xxSensors::readByte(UInt8 reg) 
+UInt8 F718xxSensors::readRegister(UInt16 reg) 
 {
-	outb(address + FINTEK_ADDRESS_REGISTER_OFFSET, reg);
-	return inb(address + FINTEK_DATA_REGISTER_OFFSET);
+	return superio_hwm_read(address, reg);
 } 
 
 UInt8 F718xxSensors::temperatureSensorsLimit()
 {
-    switch (model)
-	{
-        case F71808E:
-			return 2;
-        default:
-			return 3 + sizeof(FINTEK_TEMPERATURE_EXT_REG);
-	};
+    return chip->temperatureLimit;
 }
 
 UInt8 F718xxSensors::voltageSensorsLimit()
 {
-    switch (model) 
-	{
-        case F71858:
-			return 0;
-        default:
-			return 9;
-	};
+    return chip->voltageLimit;
 }
 
 UInt8 F718xxSensors::tachometerSensorsLimit()
 {
-    return (model == F71882 || model == F71858 ? 4 : 3);
+    return chip->fanLimit;
 }
 
 float F718xxSensors::readTemperature(UInt32 index)
 {
-	if (model == F71858) 
+	if (chip->wideTemperature) 
 	{
         int tableMode = 0x3 & readByte(FINTEK_TEMPERATURE_CONFIG_REG);
         int high = readByte(FINTEK_TEMPERATURE_BASE_REG + 2 * index);
@@ -130,8 +117,7 @@ float F718xxSensors::readTemperature(UInt32 index)
 
 float F718xxSensors::readVoltage(UInt32 index)
 {
-    // 0x26 is reserved on F71808E
-    if (model == F71808E && index == 6)
+    if (index == chip->reservedVoltage)
         return 0;
     
     return (float)(readByte(FINTEK_VOLTAGE_BASE_REG + index)) * 0.008f;
@@ -140,13 +126,7 @@ float F718xxSensors::readVoltage(UInt32 index)
 
 float F718xxSensors::readTachometer(UInt32 index)
 {
-	SInt32 value = readByte(FINTEK_FAN_TACHOMETER_REG[index]) << 8;
-	value |= readByte(FINTEK_FAN_TACHOMETER_REG[index] + 1);
-	
-	if (value > 0)
-		value = (value < 0x0fff) ? 1.5e6f / (float)value : 0;
-	
-	return value;
+	return fintek_fan_rpm(readByte(FINTEK_FAN_TACHOMETER_REG[index]), readByte(FINTEK_FAN_TACHOMETER_REG[index] + 1));
 }
 
 bool F718xxSensors::initialize()
@@ -166,6 +146,20 @@ bool F718xxSensors::initialize()
         HWSensorsFatalLog("wrong vendor id=0x%x", vendor);
         return false;
     }
+
+    chip = NULL;
+
+    for (unsigned int i = 0; i < sizeof(FINTEK_CHIPS) / sizeof(FINTEK_CHIPS[0]); i++) {
+        if (FINTEK_CHIPS[i].model == model) {
+            chip = &FINTEK_CHIPS[i];
+            break;
+        }
+    }
+
+    if (!chip) {
+        HWSensorsFatalLog("no descriptor for model 0x%x", model);
+        return false;
+    }
 	
 	return true;
 }
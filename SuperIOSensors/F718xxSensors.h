@@ -48,28 +48,17 @@
 
 #include <IOKit/IOService.h>
 #include "LPCSensors.h"
-
-// Registers
-const UInt8 FINTEK_VENDOR_ID_REGISTER = 0x23;
-const UInt16 FINTEK_VENDOR_ID = 0x1934;
-
-// Hardware Monitor
-const UInt8 FINTEK_ADDRESS_REGISTER_OFFSET = 0x05;
-const UInt8 FINTEK_DATA_REGISTER_OFFSET = 0x06;
-
-// Hardware Monitor Registers
-const UInt8 FINTEK_TEMPERATURE_CONFIG_REG   = 0x69;
-const UInt8 FINTEK_TEMPERATURE_BASE_REG     = 0x70;
-const UInt8 FINTEK_VOLTAGE_BASE_REG         = 0x20;
-const UInt8 FINTEK_FAN_TACHOMETER_REG[]     = { 0xA0, 0xB0, 0xC0, 0xD0 };
-const UInt8 FINTEK_TEMPERATURE_EXT_REG[]     = { 0x7A, 0x7B, 0x7C, 0x7E };
+#include "SuperIODevice.h"
+#include "F718xxDefinitions.h"
 
 class EXPORT F718xxSensors : public LPCSensors
 {
     OSDeclareDefaultStructors(F718xxSensors)
 	
 private:
-	UInt8					readByte(UInt8 reg);	
+    const FintekChipDescriptor *chip;
+
+	virtual UInt8			readRegister(UInt16 reg);
     
     virtual UInt8           temperatureSensorsLimit();
     virtual UInt8           voltageSensorsLimit();
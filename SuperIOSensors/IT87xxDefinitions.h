@@ -0,0 +1,99 @@
+//
+//  IT87xxDefinitions.h
+//  HWSensors
+//
+//  ITE hardware monitor registers and chip descriptors, free of IOKit so
+//  they can be used by HWSensorsTests.
+//
+
+#ifndef HWSensors_IT87xxDefinitions_h
+#define HWSensors_IT87xxDefinitions_h
+
+#include "SuperIODefinitions.h"
+
+// ITE
+const UInt8 ITE_VENDOR_ID								= 0x90;
+const UInt8 ITE_VERSION_REGISTER                        = 0x22;
+
+// ITE Environment Controller Registers    
+const UInt8 ITE_CONFIGURATION_REGISTER					= 0x00;
+const UInt8 ITE_TEMPERATURE_BASE_REG					= 0x29;
+const UInt8 ITE_VENDOR_ID_REGISTER						= 0x58;
+//const UInt8 ITE_FAN_TACHOMETER_16_BIT_ENABLE_REGISTER	= 0x0c;
+const UInt8 ITE_FAN_TACHOMETER_DIVISOR_REGISTER         = 0x0B;
+const UInt8 ITE_FAN_TACHOMETER_REG[5]					= { 0x0d, 0x0e, 0x0f, 0x80, 0x82 };
+const UInt8 ITE_FAN_TACHOMETER_EXT_REG[5]				= { 0x18, 0x19, 0x1a, 0x81, 0x83 };
+const UInt8 ITE_VOLTAGE_BASE_REG						= 0x20;
+
+const UInt8 ITE_SMARTGUARDIAN_MAIN_CONTROL				= 0x13;
+//const UInt8 ITE_SMARTGUARDIAN_PWM_CONTROL[3]			= { 0x15, 0x16, 0x17};
+
+const UInt8 ITE_SMARTGUARDIAN_TEMPERATURE_STOP[5]		= { 0x60, 0x68, 0x70, 0x90, 0x98 };
+const UInt8 ITE_SMARTGUARDIAN_TEMPERATURE_START[5]		= { 0x61, 0x69, 0x71, 0x91, 0x99 };
+const UInt8 ITE_SMARTGUARDIAN_TEMPERATURE_FULL_ON[5]	= { 0x62, 0x6a, 0x72, 0x92, 0x9a };
+const UInt8 ITE_SMARTGUARDIAN_START_PWM[5]				= { 0x63, 0x6b, 0x73, 0x93, 0x9b };
+const UInt8 ITE_SMARTGUARDIAN_CONTROL[5]				= { 0x64, 0x6c, 0x74, 0x94, 0x9c };
+//const UInt8 ITE_SMARTGUARDIAN_TEMPERATURE_FULL_OFF[5]	= { 0x65, 0x6d, 0x75, 0x95, 0x9d };
+const UInt8 ITE_SMARTGUARDIAN_TEMPERATURE_DELTA[5]      = { 0x65, 0x6d, 0x75, 0x95, 0x9d }; // newer autopwm
+
+#define ITE_SMARTGUARDIAN_AUTOMATIC_MODE                0x80
+#define ITE_SMARTGUARDIAN_SLOPE_MASK                    0x7f    // PWM steps per degree C, 1/8 units
+#define ITE_SMARTGUARDIAN_DELTA_MASK                    0x1f
+
+#define ITE_SMARTGUARDIAN_PWM_CONTROL(nr)               (0x15 + (nr))
+#define ITE_SMARTGUARDIAN_PWM_DUTY(nr)                  (0x63 + (nr) * 8)
+
+#define FEATURE_12MV_ADC		(1 << 0)
+#define FEATURE_NEWER_AUTOPWM	(1 << 1)
+#define FEATURE_OLD_AUTOPWM     (1 << 2)
+#define FEATURE_16BIT_FANS		(1 << 3)
+#define FEATURE_TEMP_OFFSET     (1 << 4)
+#define FEATURE_TEMP_PECI		(1 << 5)
+#define FEATURE_TEMP_OLD_PECI	(1 << 6)
+
+#define FEATURES_NEWER_CHIP     (FEATURE_NEWER_AUTOPWM | FEATURE_12MV_ADC | FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET | FEATURE_TEMP_PECI)
+
+// Per-model description, bound once at start so the read path does no model branching
+struct ITEChipDescriptor {
+    UInt16          model;
+    UInt8           features;
+    UInt8           fanLimit;
+};
+
+const ITEChipDescriptor ITE_CHIPS[] = {
+    { IT8512F,  FEATURE_OLD_AUTOPWM,                                                    5 },
+    { IT8705F,  FEATURE_OLD_AUTOPWM,                                                    3 },
+    { IT8712F,  FEATURE_OLD_AUTOPWM,                                                    5 },
+    { IT8716F,  FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET,                               5 },
+    { IT8718F,  FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET | FEATURE_TEMP_OLD_PECI,       5 },
+    { IT8720F,  FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET | FEATURE_TEMP_OLD_PECI,       5 },
+    { IT8721F,  FEATURES_NEWER_CHIP | FEATURE_TEMP_OLD_PECI,                            5 },
+    { IT8726F,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8620E,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8628E,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8686E,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8728F,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8752F,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8771E,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8772E,  FEATURES_NEWER_CHIP,                                                    5 },
+    { IT8792E,  FEATURES_NEWER_CHIP,                                                    5 },
+};
+
+// Chips missing from the table are treated as newer ones
+const ITEChipDescriptor ITE_CHIP_DEFAULT = { 0, FEATURES_NEWER_CHIP, 5 };
+
+// 16 bit fan counts (low byte in ITE_FAN_TACHOMETER_REG, high in ITE_FAN_TACHOMETER_EXT_REG), rounded to the nearest RPM
+inline float ite_fan_rpm16(UInt32 count)
+{
+    return count > 0x3f && count < 0xffff ? (float)(1.35e6f + count) / (float)(count * 2) : 0;
+}
+
+// 8 bit fan counts, fans 1 and 2 take their divisor from ITE_FAN_TACHOMETER_DIVISOR_REGISTER, others divide by 2
+inline float ite_fan_rpm8(UInt8 count, UInt8 divisors, UInt32 index)
+{
+    int divisor = index < 2 ? 1 << ((divisors >> (3 * index)) & 0x7) : 2;
+
+    return count > 0 && count < 0xff ? 1.35e6f / (float)(count * divisor) : 0;
+}
+
+#endif
@@ -51,27 +51,17 @@
 #include "SuperIODevice.h"
 #include "FakeSMCKey.h"
 
-#define FEATURE_12MV_ADC		(1 << 0)
-#define FEATURE_NEWER_AUTOPWM	(1 << 1)
-#define FEATURE_OLD_AUTOPWM     (1 << 2)
-#define FEATURE_16BIT_FANS		(1 << 3)
-#define FEATURE_TEMP_OFFSET     (1 << 4)
-#define FEATURE_TEMP_PECI		(1 << 5)
-#define FEATURE_TEMP_OLD_PECI	(1 << 6)
-
 #define super LPCSensors
 OSDefineMetaClassAndStructors(IT87xxSensors, LPCSensors)
 
-UInt8 IT87xxSensors::readByte(UInt8 reg)
+UInt8 IT87xxSensors::readRegister(UInt16 reg)
 {
-	outb(address + ITE_ADDRESS_REGISTER_OFFSET, reg);
-	return inb(address + ITE_DATA_REGISTER_OFFSET);
+	return superio_hwm_read(address, reg);
 }
 
-void IT87xxSensors::writeByte(UInt8 reg, UInt8 value)
+void IT87xxSensors::writeRegister(UInt16 reg, UInt8 value)
 {
-	outb(address + ITE_ADDRESS_REGISTER_OFFSET, reg);
-	outb(address + ITE_DATA_REGISTER_OFFSET, value);
+	superio_hwm_write(address, reg, value);
 }
 
 UInt8 IT87xxSensors::temperatureSensorsLimit()
@@ -86,13 +76,7 @@ UInt8 IT87xxSensors::voltageSensorsLimit()
 
 UInt8 IT87xxSensors::tachometerSensorsLimit()
 {
-    switch (model) {
-        case IT8705F:
-            return 3;
-            
-        default:
-            return 5;
-    }
+    return chip->fanLimit;
 }
 
 float IT87xxSensors::readTemperature(UInt32 index)
@@ -108,26 +92,15 @@ float IT87xxSensors::readVoltage(UInt32 index)
 
 float IT87xxSensors::readTachometer(UInt32 index)
 {
-    UInt32 value;
-    
     if (features & FEATURE_16BIT_FANS)
     {
-        value = readByte(ITE_FAN_TACHOMETER_REG[index]);
-        
-        value |= readByte(ITE_FAN_TACHOMETER_EXT_REG[index]) << 8;
-        
-        return value > 0x3f && value < 0xffff ? (float)(1.35e6f + value) / (float)(value * 2) : 0;
+        return ite_fan_rpm16(readByte(ITE_FAN_TACHOMETER_REG[index]) | (readByte(ITE_FAN_TACHOMETER_EXT_REG[index]) << 8));
     }
     else
     {
-        value = readByte(ITE_FAN_TACHOMETER_REG[index]);
-        
-        int divisor = 2;
-        
-        if (index < 2) 
-            divisor = 1 << ((readByte(ITE_FAN_TACHOMETER_DIVISOR_REGISTER) >> (3 * index)) & 0x7);
-        
-        return value > 0 && value < 0xff ? 1.35e6f / (float)(value * divisor) : 0; 
+        UInt8 count = readByte(ITE_FAN_TACHOMETER_REG[index]);
+
+        return ite_fan_rpm8(count, index < 2 ? readByte(ITE_FAN_TACHOMETER_DIVISOR_REGISTER) : 0, index);
     }
 }
 
@@ -198,6 +171,48 @@ void IT87xxSensors::writeTachometerControl(UInt32 index, UInt8 percent)
     }
 }
 
+bool IT87xxSensors::writeTachometerCurve(UInt32 index, const LPCSensorsFanCurve *curve)
+{
+    // Only the newer SmartGuardian has start PWM and slope registers, PWM control registers exist for first 3 fans
+    if (!(features & FEATURE_NEWER_AUTOPWM) || index > 2 || !isTachometerControlable(index) || !curve->count)
+        return false;
+
+    // SmartGuardian selects TMPIN1-3 in the low bits of the PWM control register
+    if (curve->sensor >= temperatureSensorsLimit()) {
+        HWSensorsWarningLog("fan control [%d] temperature %d is not a SmartGuardian source, curve runs in software", index, curve->sensor);
+        return false;
+    }
+
+    UInt8 first = 0, last = curve->count - 1;
+
+    // Linear curve from the first to the last point, points in between are approximated by the line
+    int slope = 0;
+
+    if (last > first && curve->temperature[last] > curve->temperature[first]) {
+        slope = ((curve->control[last] - curve->control[first]) * 255 * 8) / (100 * (curve->temperature[last] - curve->temperature[first]));
+        slope = slope < 0 ? 0 : slope > ITE_SMARTGUARDIAN_SLOPE_MASK ? ITE_SMARTGUARDIAN_SLOPE_MASK : slope;
+    }
+
+    // Fan stops below start temperature minus hysteresis only when first point asks for zero PWM
+    UInt8 stop = curve->control[first] ? 0 : curve->temperature[first] > curve->hysteresis ? curve->temperature[first] - curve->hysteresis : 0;
+
+    writeByte(ITE_SMARTGUARDIAN_TEMPERATURE_STOP[index], stop);
+    writeByte(ITE_SMARTGUARDIAN_TEMPERATURE_START[index], curve->temperature[first]);
+    writeByte(ITE_SMARTGUARDIAN_TEMPERATURE_FULL_ON[index], curve->temperature[last] > curve->temperature[first] ? curve->temperature[last] : 127);
+    writeByte(ITE_SMARTGUARDIAN_START_PWM[index], (float)(curve->control[first]) * 2.55);
+    writeByte(ITE_SMARTGUARDIAN_CONTROL[index], (readByte(ITE_SMARTGUARDIAN_CONTROL[index]) & ~ITE_SMARTGUARDIAN_SLOPE_MASK) | slope);
+    writeByte(ITE_SMARTGUARDIAN_TEMPERATURE_DELTA[index], (readByte(ITE_SMARTGUARDIAN_TEMPERATURE_DELTA[index]) & ~ITE_SMARTGUARDIAN_DELTA_MASK) | (curve->hysteresis & ITE_SMARTGUARDIAN_DELTA_MASK));
+
+    // Follow the curve's temperature input, switch to automatic mode
+    writeByte(ITE_SMARTGUARDIAN_PWM_CONTROL(index), ITE_SMARTGUARDIAN_AUTOMATIC_MODE | curve->sensor);
+    writeByte(ITE_SMARTGUARDIAN_MAIN_CONTROL, readByte(ITE_SMARTGUARDIAN_MAIN_CONTROL) | (1 << index));
+
+    // Next manual write switches back to manual mode
+    fanControlEnabled[index] = false;
+
+    return true;
+}
+
 //void IT87xxSensors::disableTachometerControl(UInt32 index)
 //{
 //    if (index > 3)
@@ -230,48 +245,16 @@ bool IT87xxSensors::initialize()
  		return false;
     }
     
-    switch (model) {
-        case IT8512F:
-            features = FEATURE_OLD_AUTOPWM;
-            break;
-        case IT8705F:
-            features = FEATURE_OLD_AUTOPWM;
-            break;
-        case IT8712F:
-            features = FEATURE_OLD_AUTOPWM;
-            break;
-        case IT8716F:
-            features = FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET;
-            break;
-        case IT8718F:
-            features = FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET | FEATURE_TEMP_OLD_PECI;
-            break;
-        case IT8720F:
-            features = FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET | FEATURE_TEMP_OLD_PECI;
-            break;
-        case IT8721F:
-           features = FEATURE_NEWER_AUTOPWM | FEATURE_12MV_ADC | FEATURE_16BIT_FANS
-            | FEATURE_TEMP_OFFSET | FEATURE_TEMP_OLD_PECI | FEATURE_TEMP_PECI;
-            break;
-            
-        // Default case is for all newer chips
-        case IT8726F:
-        case IT8620E:
-        case IT8628E:
-        case IT8686E:
-        case IT8728F:
-        case IT8752F:
-        case IT8771E:
-        case IT8772E:
-        case IT8792E:
-        default:
-            features = FEATURE_NEWER_AUTOPWM | FEATURE_12MV_ADC | FEATURE_16BIT_FANS
-            | FEATURE_TEMP_OFFSET | FEATURE_TEMP_PECI;
+    chip = &ITE_CHIP_DEFAULT;
+
+    for (unsigned int i = 0; i < sizeof(ITE_CHIPS) / sizeof(ITE_CHIPS[0]); i++) {
+        if (ITE_CHIPS[i].model == model) {
+            chip = &ITE_CHIPS[i];
             break;
-            
-            //case IT8782E:
-            //features = FEATURE_16BIT_FANS | FEATURE_TEMP_OFFSET | FEATURE_TEMP_OLD_PECI;
+        }
     }
+
+    features = chip->features;
 	
 //    switch (model) {
 //        case IT8705F:
@@ -296,6 +279,14 @@ bool IT87xxSensors::initialize()
 
 void IT87xxSensors::hasPoweredOn()
 {
+    LPCSensorsTransaction transaction(this);
+
+    // Firmware still has the chip, the control timer calls us again
+    if (!transaction.isLocked()) {
+        deferPowerOn();
+        return;
+    }
+
     LPCSensors::hasPoweredOn();
     
     // Reset fan control enabled
@@ -34,21 +34,384 @@
 
 #include <IOKit/IOTimerEventSource.h>
 
-// PID fan control algorithm, reference article: http://www.codeproject.com/Articles/36459/PID-process-control-a-Cruise-Control-example
-
-#define kLPCSensorsControlSamplingInterval    2000    // in milliseconds
-#define kLPCSensorsControlSamplingTimeout     60000   // one minute
-#define kLPCSensorsKp   0.01200
-#define kLPCSensorsKi   0.00001
-#define kLPCSensorsKd   0.00600
-
-#define CLIP_CONTROL(x) (x) < 0 ? 0 : (x) > 100 ? 100 : (x)
+#define kLPCSensorsNanosecondsPerMillisecond  1000000ULL
 
 //#define kHWSensorsDebug 1
 
 #define super FakeSMCPlugin
 OSDefineMetaClassAndStructors(LPCSensors, FakeSMCPlugin)
 
+UInt8 LPCSensors::readRegister(UInt16 reg)
+{
+    return 0;
+}
+
+void LPCSensors::writeRegister(UInt16 reg, UInt8 value)
+{
+    //
+}
+
+UInt8 LPCSensors::findSnapshotRegister(UInt16 reg)
+{
+    // Snapshot is kept sorted by register, so banked chips are read bank by bank
+    UInt8 low = 0, high = snapshotCount;
+
+    while (low < high) {
+        UInt8 middle = (low + high) >> 1;
+
+        if (snapshot[middle].reg < reg)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low;
+}
+
+void LPCSensors::updateSnapshot()
+{
+    UInt64 operations = superio_port_operations;
+
+    for (UInt8 index = 0; index < snapshotCount; index++) {
+        snapshot[index].value = readRegister(snapshot[index].reg);
+    }
+
+    HWSensorsDebugLog("snapshot of %d registers took %lld port operations", snapshotCount, superio_port_operations - operations);
+}
+
+UInt8 LPCSensors::readByte(UInt16 reg)
+{
+    if (!snapshotActive)
+        return readRegister(reg);
+
+    UInt64 time = ptimer_read();
+
+    if (time - snapshotTime > kLPCSensorsSnapshotEpoch) {
+        updateSnapshot();
+        snapshotTime = time;
+    }
+
+    UInt8 index = findSnapshotRegister(reg);
+
+    if (index < snapshotCount && snapshot[index].reg == reg)
+        return snapshot[index].value;
+
+    UInt8 value = readRegister(reg);
+
+    if (snapshotCount < kLPCSensorsMaxSnapshotRegisters) {
+        memmove(&snapshot[index + 1], &snapshot[index], (snapshotCount - index) * sizeof(LPCSensorsRegister));
+
+        snapshot[index].reg = reg;
+        snapshot[index].value = value;
+
+        snapshotCount++;
+    }
+
+    return value;
+}
+
+void LPCSensors::writeByte(UInt16 reg, UInt8 value)
+{
+    writeRegister(reg, value);
+
+    UInt8 index = findSnapshotRegister(reg);
+
+    if (index < snapshotCount && snapshot[index].reg == reg)
+        snapshot[index].value = value;
+}
+
+LPCSensorsChannelFilter *LPCSensors::getChannelFilter(UInt32 group, UInt32 index)
+{
+    if (index >= kLPCSensorsMaxFilterChannels)
+        return NULL;
+
+    switch (group) {
+        case kFakeSMCTemperatureSensor:
+            return &filters[0][index];
+
+        case kFakeSMCVoltageSensor:
+            return &filters[1][index];
+
+        case kFakeSMCTachometerSensor:
+            return &filters[2][index];
+    }
+
+    return NULL;
+}
+
+bool LPCSensors::parseChannelFilter(OSDictionary *node, UInt8 *mode, UInt16 *smoothing)
+{
+    if (!node)
+        return false;
+
+    if (OSString *name = OSDynamicCast(OSString, node->getObject("filter"))) {
+        if (name->isEqualTo("median"))
+            *mode = kLPCSensorsFilterMedian;
+        else if (name->isEqualTo("smoothing"))
+            *mode = kLPCSensorsFilterSmoothing;
+        else if (name->isEqualTo("none"))
+            *mode = kLPCSensorsFilterNone;
+        else
+            HWSensorsWarningLog("unknown filter %s", name->getCStringNoCopy());
+    }
+
+    if (OSNumber *number = OSDynamicCast(OSNumber, node->getObject("smoothing"))) {
+        UInt32 value = number->unsigned32BitValue();
+
+        *smoothing = value < 1 ? 1 : value > 1000 ? 1000 : value;
+    }
+
+    return true;
+}
+
+void LPCSensors::setupChannelFilters(OSDictionary *configuration)
+{
+    UInt8 mode = kLPCSensorsFilterNone;
+    UInt16 smoothing = kLPCSensorsFilterDefaultSmoothing;
+
+    // Profile wide default, TEMPIN and VIN nodes given as dictionary may override it
+    parseChannelFilter(OSDynamicCast(OSDictionary, configuration->getObject("FILTER")), &mode, &smoothing);
+
+    const UInt32 groups[3] = { kFakeSMCTemperatureSensor, kFakeSMCVoltageSensor, kFakeSMCTachometerSensor };
+    const char *prefixes[3] = { "TEMPIN", "VIN", "FANIN" };
+    const UInt8 limits[3] = { temperatureSensorsLimit(), voltageSensorsLimit(), tachometerSensorsLimit() };
+
+    for (int group = 0; group < 3; group++) {
+        for (int index = 0; index < limits[group] && index < kLPCSensorsMaxFilterChannels; index++) {
+            LPCSensorsChannelFilter *filter = getChannelFilter(groups[group], index);
+            char key[8];
+
+            filter->mode = mode;
+            filter->smoothing = smoothing;
+
+            snprintf(key, 8, "%s%X", prefixes[group], index);
+
+            parseChannelFilter(OSDynamicCast(OSDictionary, configuration->getObject(key)), &filter->mode, &filter->smoothing);
+        }
+    }
+}
+
+void LPCSensors::countChannelGlitch(LPCSensorsChannelFilter *filter, const char *key)
+{
+    // Runs on the SMC read path: publish the first glitch of a channel and then every
+    // kLPCSensorsGlitchReportInterval-th, a glitching sensor doesn't allocate on each read
+    if (++filter->glitches != 1 && filter->glitches % kLPCSensorsGlitchReportInterval)
+        return;
+
+    if (!key)
+        return;
+
+    // Publish a fresh copy so readers never see the dictionary changing
+    OSDictionary *current = OSDynamicCast(OSDictionary, getProperty(kLPCSensorsFilterGlitches));
+    OSDictionary *glitches = current ? OSDictionary::withDictionary(current) : OSDictionary::withCapacity(1);
+
+    if (glitches) {
+        if (OSNumber *number = OSNumber::withNumber(filter->glitches, 32)) {
+            glitches->setObject(key, number);
+            number->release();
+        }
+
+        setProperty(kLPCSensorsFilterGlitches, glitches);
+        glitches->release();
+    }
+}
+
+float LPCSensors::filterSample(UInt32 group, UInt32 index, float sample, const char *key)
+{
+    LPCSensorsChannelFilter *filter = getChannelFilter(group, index);
+
+    if (!filter)
+        return sample;
+
+    UInt64 time = ptimer_read();
+
+    if (sample == 0) {
+        if (filter->zeros < kLPCSensorsFilterZeroSamples)
+            filter->zeros++;
+
+        if (filter->zeros < kLPCSensorsFilterZeroSamples && filter->time && time - filter->time < kLPCSensorsFilterMaxAge) {
+            HWSensorsDebugLog("%s glitch, serving value taken %lld ms ago", key ? key : "channel", (time - filter->time) / kLPCSensorsNanosecondsPerMillisecond);
+            countChannelGlitch(filter, key);
+            return filter->value;
+        }
+
+        // Fan stopped or input is not connected, start over once it comes back
+        filter->count = 0;
+        filter->value = 0;
+
+        return 0;
+    }
+
+    filter->zeros = 0;
+
+    // Leaving zero, history is of no use
+    if (filter->value == 0)
+        filter->count = 0;
+
+    if (!filter->count)
+        filter->position = 0;
+
+    filter->history[filter->position] = sample;
+    filter->position = (filter->position + 1) % kLPCSensorsFilterHistory;
+
+    if (filter->count < kLPCSensorsFilterHistory)
+        filter->count++;
+
+    switch (filter->mode) {
+        case kLPCSensorsFilterMedian:
+            if (filter->count == kLPCSensorsFilterHistory) {
+                float a = filter->history[0], b = filter->history[1], c = filter->history[2];
+                float low = a < b ? a : b, high = a < b ? b : a;
+                float median = c < low ? low : c > high ? high : c;
+
+                if (CONTROL_ABS(sample - median) > median * kLPCSensorsFilterSpike)
+                    countChannelGlitch(filter, key);
+
+                filter->value = median;
+            }
+            else filter->value = sample;
+            break;
+
+        case kLPCSensorsFilterSmoothing:
+            filter->value = filter->count > 1 ? filter->value + (sample - filter->value) * (float)filter->smoothing / 1000.0f : sample;
+            break;
+
+        default:
+            filter->value = sample;
+            break;
+    }
+
+    filter->time = time;
+
+    return filter->value;
+}
+
+void LPCSensors::setupFirmwareLock(OSDictionary *configuration)
+{
+    OSDictionary *node = OSDynamicCast(OSDictionary, configuration->getObject("ACPI Lock"));
+
+    if (!node)
+        return;
+
+    OSBoolean *global = OSDynamicCast(OSBoolean, node->getObject("global"));
+    OSString *acquire = OSDynamicCast(OSString, node->getObject("acquire"));
+    OSString *release = OSDynamicCast(OSString, node->getObject("release"));
+
+    if (OSNumber *timeout = OSDynamicCast(OSNumber, node->getObject("timeout")))
+        firmwareLockTimeout = timeout->unsigned32BitValue();
+
+    firmwareGlobalLock = global && global->isTrue();
+
+    if (!firmwareGlobalLock && !(acquire && release)) {
+        HWSensorsWarningLog("ACPI lock should use global lock or both acquire and release methods");
+        return;
+    }
+
+    // Any namespace object will do, methods are configured by absolute path
+    IORegistryEntry *entry = IORegistryEntry::fromPath("/_SB", gIOACPIPlane);
+
+    if (!(firmwareLockDevice = OSDynamicCast(IOACPIPlatformDevice, entry))) {
+        HWSensorsWarningLog("ACPI namespace not found, firmware lock disabled");
+        OSSafeReleaseNULL(entry);
+        return;
+    }
+
+    if (acquire && release) {
+        firmwareAcquireMethod = acquire;
+        firmwareAcquireMethod->retain();
+        firmwareReleaseMethod = release;
+        firmwareReleaseMethod->retain();
+    }
+
+    HWSensorsInfoLog("register access is coordinated with firmware%s%s%s", firmwareGlobalLock ? " using global lock" : "", firmwareGlobalLock && firmwareAcquireMethod ? " and" : "", firmwareAcquireMethod ? " using ACPI methods" : "");
+}
+
+bool LPCSensors::acquireFirmwareLock(void)
+{
+    UInt64 start = ptimer_read();
+    bool acquired = true;
+
+    if (firmwareGlobalLock) {
+        mach_timespec_t timeout = { firmwareLockTimeout / 1000, (firmwareLockTimeout % 1000) * (clock_res_t)kLPCSensorsNanosecondsPerMillisecond };
+
+        acquired = kIOReturnSuccess == firmwareLockDevice->acquireGlobalLock(&firmwareLockToken, &timeout);
+    }
+
+    // Method gets the timeout in ms and returns zero once ports are ours, like AML Acquire does
+    if (acquired && firmwareAcquireMethod) {
+        UInt32 result = 1;
+        OSObject *params[1] = { OSNumber::withNumber(firmwareLockTimeout, 32) };
+
+        acquired = kIOReturnSuccess == firmwareLockDevice->evaluateInteger(firmwareAcquireMethod->getCStringNoCopy(), &result, params, 1) && !result;
+
+        OSSafeReleaseNULL(params[0]);
+
+        if (!acquired && firmwareGlobalLock)
+            firmwareLockDevice->releaseGlobalLock(firmwareLockToken);
+    }
+
+    UInt64 wait = ptimer_read() - start;
+
+    if (lpc_lock_account(&firmwareLockStatistics, wait, acquired))
+        publishFirmwareLockStatistics();
+
+    if (!acquired)
+        HWSensorsDebugLog("firmware lock timed out after %lld us", wait / 1000);
+
+    return acquired;
+}
+
+void LPCSensors::releaseFirmwareLock(void)
+{
+    if (firmwareReleaseMethod) {
+        UInt32 result;
+        firmwareLockDevice->evaluateInteger(firmwareReleaseMethod->getCStringNoCopy(), &result);
+    }
+
+    if (firmwareGlobalLock)
+        firmwareLockDevice->releaseGlobalLock(firmwareLockToken);
+}
+
+void LPCSensors::publishFirmwareLockStatistics(void)
+{
+    setProperty(kLPCSensorsFirmwareLockAcquired, firmwareLockStatistics.acquired, 64);
+    setProperty(kLPCSensorsFirmwareLockTimeouts, firmwareLockStatistics.timeouts, 64);
+    setProperty(kLPCSensorsFirmwareLockWaitTotal, firmwareLockStatistics.waitTotal / 1000, 64);
+    setProperty(kLPCSensorsFirmwareLockWaitMax, firmwareLockStatistics.waitMax / 1000, 64);
+}
+
+bool LPCSensors::beginTransaction(void)
+{
+    if (registerLock)
+        IORecursiveLockLock(registerLock);
+
+    // Nested transactions run under the firmware lock taken by the outermost one
+    if (transactionDepth++ == 0) {
+        if (firmwareLockDevice)
+            firmwareLocked = acquireFirmwareLock();
+
+        didBeginTransaction();
+    }
+
+    return !firmwareLockDevice || firmwareLocked;
+}
+
+void LPCSensors::endTransaction(void)
+{
+    if (--transactionDepth == 0 && firmwareLocked) {
+        releaseFirmwareLock();
+        firmwareLocked = false;
+    }
+
+    if (registerLock)
+        IORecursiveLockUnlock(registerLock);
+}
+
+void LPCSensors::didBeginTransaction(void)
+{
+    // Override
+}
+
 bool LPCSensors::checkConfigurationNode(OSObject *node, const char *name)
 {
     if (node) {
@@ -181,11 +544,11 @@ bool LPCSensors::addTachometerSensors(OSDictionary *configuration)
 {
     HWSensorsDebugLog("adding tachometer sensors...");
 
-    char key[7];
+    char key[16]; // FANCURVE<n> + terminator
     UInt16 value = 0;
 
-    // FAN manual control key
-    addSensorForKey(KEY_FAN_MANUAL, SMC_TYPE_UI16, SMC_TYPE_UI16_SIZE, kLPCSensorsFanManualSwitch, 0);
+    // FAN manual control key, one chip owns it when there are several, others follow its value
+    manualSwitchOwner = addSensorForKey(KEY_FAN_MANUAL, SMC_TYPE_UI16, SMC_TYPE_UI16_SIZE, kLPCSensorsFanManualSwitch, 0) != NULL;
 
     int location = LEFT_LOWER_FRONT;
 
@@ -193,7 +556,7 @@ bool LPCSensors::addTachometerSensors(OSDictionary *configuration)
         
         UInt8 fanIndex;
 
-        snprintf(key, 7, "FANIN%X", i);
+        snprintf(key, sizeof(key), "FANIN%X", i);
 
         if (OSString* name = OSDynamicCast(OSString, configuration->getObject(key))){
             if (addTachometer(i, name->getLength() > 0 ? name->getCStringNoCopy() : 0, FAN_RPM, 0, (FanLocationType)location++, &fanIndex)){
@@ -216,6 +579,12 @@ bool LPCSensors::addTachometerSensors(OSDictionary *configuration)
                     // Target RPM and fan control sensor
                     snprintf(key, 5, KEY_FORMAT_FAN_TARGET, fanIndex);
                     addSensorForKey(key, SMC_TYPE_FPE2, SMC_TYPE_FPXX_SIZE, kLPCSensorsFanTargetController, i);
+
+                    // Fan curve
+                    snprintf(key, sizeof(key), "FANCURVE%X", i);
+
+                    if (parseTachometerCurve(OSDynamicCast(OSDictionary, configuration->getObject(key)), &tachometerControls[i].curve))
+                        tachometerCurveInit(i);
                 }
             }
             else HWSensorsWarningLog("failed to add tachometer sensor %d", i);
@@ -275,6 +644,11 @@ void LPCSensors::disableTachometerControl(UInt32 index)
     //
 }
 
+bool LPCSensors::writeTachometerCurve(UInt32 index, const LPCSensorsFanCurve *curve)
+{
+    return false;
+}
+
 bool LPCSensors::initialize()
 {
     return true;
@@ -286,19 +660,28 @@ bool LPCSensors::initialize()
 bool LPCSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
 {
     if (sensor) {
+        LPCSensorsTransaction transaction(this);
+
+        // Firmware is busy with the ports, keep the previous value
+        if (!transaction.isLocked())
+            return false;
+
+        // Serve monitoring registers from the snapshot of the current epoch
+        snapshotActive = true;
+
         switch (sensor->getGroup()) {
             case kFakeSMCTemperatureSensor:
-                *outValue = sensor->getOffset() + readTemperature(sensor->getIndex());
+                *outValue = sensor->getOffset() + filterSample(kFakeSMCTemperatureSensor, sensor->getIndex(), readTemperature(sensor->getIndex()), sensor->getKey());
                 break;
 
             case kFakeSMCVoltageSensor: {
-                float v = readVoltage(sensor->getIndex());
+                float v = filterSample(kFakeSMCVoltageSensor, sensor->getIndex(), readVoltage(sensor->getIndex()), sensor->getKey());
                 *outValue = sensor->getOffset() + v + (v - sensor->getReference()) * sensor->getGain();
                 break;
             }
 
             case kFakeSMCTachometerSensor:
-                *outValue = readTachometer(sensor->getIndex());
+                *outValue = filterSample(kFakeSMCTachometerSensor, sensor->getIndex(), readTachometer(sensor->getIndex()), sensor->getKey());
                 break;
 
             case kLPCSensorsFanManualSwitch:
@@ -306,9 +689,12 @@ bool LPCSensors::willReadSensorValue(FakeSMCSensor *sensor, float *outValue)
             case kLPCSensorsFanTargetController:
             default:
                 // Just return stored key value
+                snapshotActive = false;
                 return false;
         }
 
+        snapshotActive = false;
+
         return true;
     }
 
@@ -357,16 +743,39 @@ bool LPCSensors::didWriteSensorValue(FakeSMCSensor *sensor, float value)
 
 void LPCSensors::hasPoweredOn()
 {
+    LPCSensorsTransaction transaction(this);
+
+    // Expire the snapshot taken before sleep
+    snapshotTime = 0;
+
+    if (!transaction.isLocked()) {
+        deferPowerOn();
+        return;
+    }
+
     // Restore fan speed after wake from sleep if it was set before
     for (int index = 0; index < tachometerSensorsLimit(); index ++) {
         if (tachometerControls[index].target >= 0) {
             tachometerControlInit(index, tachometerControls[index].target);
         }
+        // Firmware reprograms fan control on wake, put the hardware curve back
+        else if (tachometerControls[index].curveHardware) {
+            tachometerCurveInit(index);
+        }
     }
     
     // Override, but call super
 }
 
+void LPCSensors::deferPowerOn(void)
+{
+    HWSensorsDebugLog("firmware holds the ports, wake restore deferred");
+
+    powerOnPending = true;
+
+    tachometerControlSchedule();
+}
+
 #pragma mark
 #pragma mark Tachometer Controller
 
@@ -374,54 +783,51 @@ void LPCSensors::tachometerControlInit(UInt8 number, float target)
 {
     HWSensorsDebugLog("fan control [%d] init with target = %d", number, (int)target);
 
-    tachometerControls[number].target = target;
-    tachometerControls[number].control = readTachometerControl(number);
-    tachometerControls[number].samples = kLPCSensorsControlSamplingTimeout / kLPCSensorsControlSamplingInterval;
-    tachometerControls[number].active = true;
+    LPCSensorsTransaction transaction(this);
 
-    if (!timerScheduled) {
-        timerEventSource->setTimeoutMS(kLPCSensorsControlSamplingInterval);
-        timerScheduled = true;
-        HWSensorsDebugLog("timer scheduled");
+    if (!transaction.isLocked()) {
+        tachometerControls[number].target = target;
+        tachometerControls[number].active = false;
+        tachometerControlDefer(number);
+        return;
     }
-}
 
-bool LPCSensors::tachometerControlSample(UInt8 number)
-{
-    if (tachometerControls[number].active) {
+    UInt64 time = ptimer_read();
+    float base = lpc_control_start(&tachometerControls[number], target, readTachometerControl(number), readTachometer(number));
 
-        float value = readTachometer(number);
+    tachometerControls[number].next = time + kLPCSensorsControlMinInterval * kLPCSensorsNanosecondsPerMillisecond;
+    tachometerControls[number].deadline = time + kLPCSensorsControlSamplingTimeout * kLPCSensorsNanosecondsPerMillisecond;
+    tachometerControls[number].active = true;
 
-        tachometerControls[number].error = tachometerControls[number].target - value;
+    writeTachometerControl(number, base);
 
-        float difference = tachometerControls[number].error - tachometerControls[number].prevError;
-        double derivative = difference / (kLPCSensorsControlSamplingInterval / 1000.0);
+    tachometerControlSchedule();
+}
 
-        tachometerControls[number].integral += tachometerControls[number].error *
-        (kLPCSensorsControlSamplingInterval / 1000.0);
+bool LPCSensors::tachometerControlSample(UInt8 number)
+{
+    if (tachometerControls[number].active) {
 
-        tachometerControls[number].prevError = tachometerControls[number].error;
+        LPCSensorsTachometerControl *fan = &tachometerControls[number];
 
-        float drive =
-            tachometerControls[number].error * kLPCSensorsKp +
-            tachometerControls[number].integral * kLPCSensorsKi +
-            derivative * kLPCSensorsKd;
+        float drive = lpc_control_sample(fan, readTachometer(number));
 
-        tachometerControls[number].control +=  drive;
+        HWSensorsDebugLog("fan control [%d] probe error = %d control = %d drive = %d interval = %d",
+                          number,
+                          (int)fan->error,
+                          (int)fan->control,
+                          (int)drive,
+                          (int)fan->interval);
 
-        tachometerControls[number].control = CLIP_CONTROL(tachometerControls[number].control);
+        writeTachometerControl(number, fan->control);
 
-        HWSensorsDebugLog("fan control [%d] probe error = %d control = %d drive = %d",
-                          number,
-                          (int)tachometerControls[number].error,
-                          (int)tachometerControls[number].control,
-                          (int)drive);
+        UInt64 time = ptimer_read();
 
-        writeTachometerControl(number, tachometerControls[number].control);
+        fan->next = time + fan->interval * kLPCSensorsNanosecondsPerMillisecond;
 
-        if (--tachometerControls[number].samples <= 0) {
+        if (time >= fan->deadline) {
             HWSensorsDebugLog("fan control [%d] finished", number);
-            tachometerControls[number].active = false;
+            fan->active = false;
             return false;
         }
 
@@ -431,33 +837,264 @@ bool LPCSensors::tachometerControlSample(UInt8 number)
     return false;
 }
 
+void LPCSensors::tachometerControlSchedule(void)
+{
+    if (!timerEventSource)
+        return;
+
+    UInt64 time = ptimer_read();
+    UInt64 next = powerOnPending ? time + kLPCSensorsControlMinInterval * kLPCSensorsNanosecondsPerMillisecond : 0;
+
+    for (int index = 0; index < tachometerSensorsLimit(); index ++) {
+        if (tachometerControls[index].active || tachometerControls[index].pending || (tachometerControls[index].target < 0 && tachometerControls[index].curve.count && !tachometerControls[index].curveHardware)) {
+            if (!next || tachometerControls[index].next < next)
+                next = tachometerControls[index].next;
+        }
+    }
+
+    if (next) {
+        UInt32 timeout = next > time ? (UInt32)((next - time) / kLPCSensorsNanosecondsPerMillisecond) : 0;
+
+        timerEventSource->setTimeoutMS(timeout ? timeout : 1);
+        timerScheduled = true;
+
+        HWSensorsDebugLog("timer scheduled in %d ms", timeout);
+    }
+    else {
+        timerScheduled = false;
+    }
+}
+
 void LPCSensors::tachometerControlCancel(UInt8 number)
 {
-    disableTachometerControl(number);
+    LPCSensorsTransaction transaction(this);
 
     tachometerControls[number].active = false;
 
+    if (!transaction.isLocked()) {
+        tachometerControlDefer(number);
+        return;
+    }
+
+    disableTachometerControl(number);
+
     HWSensorsDebugLog("fan control [%d] canceled", number);
+
+    // Manual control overrides the curve, hand the fan back to it
+    if (tachometerControls[number].curve.count)
+        tachometerCurveInit(number);
+}
+
+void LPCSensors::tachometerControlDefer(UInt8 number)
+{
+    HWSensorsDebugLog("fan control [%d] deferred, firmware holds the ports", number);
+
+    tachometerControls[number].pending = true;
+    tachometerControls[number].next = ptimer_read() + kLPCSensorsControlMinInterval * kLPCSensorsNanosecondsPerMillisecond;
+
+    tachometerControlSchedule();
+}
+
+void LPCSensors::tachometerControlRestore(UInt8 number)
+{
+    tachometerControls[number].pending = false;
+
+    // Apply whatever was requested last, manual target has priority over the curve
+    if (tachometerControls[number].target >= 0)
+        tachometerControlInit(number, tachometerControls[number].target);
+    else if (tachometerControls[number].curve.count)
+        tachometerCurveInit(number);
+    else
+        tachometerControlCancel(number);
+}
+
+bool LPCSensors::parseTachometerCurve(OSDictionary *node, LPCSensorsFanCurve *curve)
+{
+    if (!node)
+        return false;
+
+    OSArray *points = OSDynamicCast(OSArray, node->getObject("points"));
+
+    if (!points || !points->getCount()) {
+        HWSensorsWarningLog("fan curve without points ignored");
+        return false;
+    }
+
+    bzero(curve, sizeof(LPCSensorsFanCurve));
+
+    for (unsigned int index = 0; index < points->getCount() && curve->count < kLPCSensorsMaxCurvePoints; index++) {
+        if (OSDictionary *point = OSDynamicCast(OSDictionary, points->getObject(index))) {
+            OSNumber *temperature = OSDynamicCast(OSNumber, point->getObject("temperature"));
+            OSNumber *control = OSDynamicCast(OSNumber, point->getObject("pwm"));
+
+            if (!temperature || !control)
+                continue;
+
+            // Points must go up in temperature
+            if (curve->count && temperature->unsigned8BitValue() <= curve->temperature[curve->count - 1]) {
+                HWSensorsWarningLog("fan curve point %d is out of order", index);
+                continue;
+            }
+
+            curve->temperature[curve->count] = temperature->unsigned8BitValue();
+            curve->control[curve->count] = CLIP_CONTROL(control->unsigned8BitValue());
+            curve->count++;
+        }
+    }
+
+    if (!curve->count)
+        return false;
+
+    if (OSNumber *number = OSDynamicCast(OSNumber, node->getObject("sensor")))
+        curve->sensor = number->unsigned8BitValue();
+
+    if (OSNumber *number = OSDynamicCast(OSNumber, node->getObject("hysteresis")))
+        curve->hysteresis = number->unsigned8BitValue();
+
+    if (OSNumber *number = OSDynamicCast(OSNumber, node->getObject("step-up")))
+        curve->stepUp = number->unsigned16BitValue();
+
+    if (OSNumber *number = OSDynamicCast(OSNumber, node->getObject("step-down")))
+        curve->stepDown = number->unsigned16BitValue();
+
+    return true;
+}
+
+void LPCSensors::tachometerCurveInit(UInt8 number)
+{
+    LPCSensorsTransaction transaction(this);
+
+    if (!transaction.isLocked()) {
+        tachometerControlDefer(number);
+        return;
+    }
+
+    tachometerControls[number].curveHardware = writeTachometerCurve(number, &tachometerControls[number].curve);
+    tachometerControls[number].curveControl = readTachometerControl(number);
+
+    HWSensorsDebugLog("fan control [%d] curve of %d points runs in %s", number, tachometerControls[number].curve.count, tachometerControls[number].curveHardware ? "hardware" : "software");
+
+    // Software curve is sampled by the control timer
+    if (!tachometerControls[number].curveHardware) {
+        tachometerControls[number].next = ptimer_read() + kLPCSensorsControlSamplingInterval * kLPCSensorsNanosecondsPerMillisecond;
+        tachometerControlSchedule();
+    }
+}
+
+float LPCSensors::tachometerCurveEvaluate(UInt8 number, float temperature)
+{
+    LPCSensorsFanCurve *curve = &tachometerControls[number].curve;
+
+    if (temperature <= curve->temperature[0])
+        return curve->control[0];
+
+    for (int index = 1; index < curve->count; index++) {
+        if (temperature < curve->temperature[index]) {
+            float slope = (float)(curve->control[index] - curve->control[index - 1]) / (float)(curve->temperature[index] - curve->temperature[index - 1]);
+
+            return curve->control[index - 1] + (temperature - curve->temperature[index - 1]) * slope;
+        }
+    }
+
+    return curve->control[curve->count - 1];
+}
+
+bool LPCSensors::tachometerCurveSample(UInt8 number)
+{
+    LPCSensorsFanCurve *curve = &tachometerControls[number].curve;
+
+    if (!curve->count || tachometerControls[number].curveHardware)
+        return false;
+
+    float temperature = filterSample(kFakeSMCTemperatureSensor, curve->sensor, readTemperature(curve->sensor), NULL);
+    float control = tachometerControls[number].curveControl;
+    float rising = tachometerCurveEvaluate(number, temperature);
+    float falling = tachometerCurveEvaluate(number, temperature + curve->hysteresis);
+
+    // Go up right away, go down only after temperature fell by hysteresis
+    float target = rising > control ? rising : falling < control ? falling : control;
+
+    // Step times limit the PWM slew rate same way chip does it, one step is 1/255
+    UInt16 step = target > control ? curve->stepUp : curve->stepDown;
+
+    if (step) {
+        float limit = (float)kLPCSensorsControlSamplingInterval / (float)step / 2.55f;
+
+        if (target > control + limit)
+            target = control + limit;
+        else if (target < control - limit)
+            target = control - limit;
+    }
+
+    target = CLIP_CONTROL(target);
+
+    if ((UInt8)target != (UInt8)control) {
+        HWSensorsDebugLog("fan control [%d] curve temperature = %d control = %d", number, (int)temperature, (int)target);
+        writeTachometerControl(number, target);
+    }
+
+    tachometerControls[number].curveControl = target;
+
+    return true;
 }
 
 IOReturn LPCSensors::woorkloopTimerEvent(void)
 {
-    bool active = false;
+    // Manual switch is handled by another chip, cancel control of fans switched back to automatic.
+    // Done before the transaction so key store lock is never taken under the register lock
+    int manual = 0;
+
+    if (!manualSwitchOwner && decodeIntValueForKey(KEY_FAN_MANUAL, &manual)) {
+        for (int index = 0; index < tachometerSensorsLimit(); index++) {
+            if (tachometerControls[index].active && !bit_get(manual, BIT(tachometerControls[index].number))) {
+                tachometerControlCancel(index);
+                tachometerControls[index].target = -1.0;
+            }
+        }
+    }
 
-    for (int index = 0; index < tachometerSensorsLimit(); index ++) {
-        if (tachometerControls[index].active && tachometerControlSample(index)) {
-            active = true;
+    // One transaction for the whole control sample, SMC reads wait until it is done
+    LPCSensorsTransaction transaction(this);
+
+    // Firmware is busy with the ports, postpone due samples instead of spinning on the lock
+    if (!transaction.isLocked()) {
+        UInt64 retry = ptimer_read() + kLPCSensorsControlMinInterval * kLPCSensorsNanosecondsPerMillisecond;
+
+        for (int index = 0; index < tachometerSensorsLimit(); index ++) {
+            if (tachometerControls[index].next < retry)
+                tachometerControls[index].next = retry;
         }
+
+        tachometerControlSchedule();
+        return kIOReturnSuccess;
     }
 
-    if (active) {
-        timerEventSource->setTimeoutMS(kLPCSensorsControlSamplingInterval);
-        timerScheduled = true;
-        HWSensorsDebugLog("timer scheduled");
+    // Wake restore postponed by a busy firmware, runs the chip's override too
+    if (powerOnPending) {
+        powerOnPending = false;
+        hasPoweredOn();
     }
-    else {
-        timerScheduled = false;
+
+    // Fans are sampled each at its own interval, allow a bit of timer slack
+    UInt64 time = ptimer_read() + kLPCSensorsNanosecondsPerMillisecond * 10;
+
+    for (int index = 0; index < tachometerSensorsLimit(); index ++) {
+        if (tachometerControls[index].next > time)
+            continue;
+
+        if (tachometerControls[index].pending) {
+            tachometerControlRestore(index);
+        }
+        else if (tachometerControls[index].active) {
+            tachometerControlSample(index);
+        }
+        // Manual target has priority over the curve
+        else if (tachometerControls[index].target < 0 && tachometerCurveSample(index)) {
+            tachometerControls[index].next = time + kLPCSensorsControlSamplingInterval * kLPCSensorsNanosecondsPerMillisecond;
+        }
     }
+
+    tachometerControlSchedule();
     
     return kIOReturnSuccess;
 }
@@ -473,12 +1110,37 @@ bool LPCSensors::init(OSDictionary *properties)
     address = 0;
     port = 0;
    	model = 0;
+    chipIndex = 0;
+    manualSwitchOwner = false;
+
+    snapshotCount = 0;
+    snapshotTime = 0;
+    snapshotActive = false;
+
+    bzero(filters, sizeof(filters));
 
     modelName = "unknown";
     vendorName = "unknown";
 
     gpuIndex = UINT8_MAX;
 
+    registerLock = NULL;
+    transactionDepth = 0;
+
+    firmwareLockDevice = NULL;
+    firmwareAcquireMethod = NULL;
+    firmwareReleaseMethod = NULL;
+    firmwareGlobalLock = false;
+    firmwareLockToken = 0;
+    firmwareLockTimeout = kLPCSensorsFirmwareLockTimeout;
+    firmwareLocked = false;
+
+    bzero(&firmwareLockStatistics, sizeof(firmwareLockStatistics));
+
+    timerEventSource = NULL;
+    timerScheduled = false;
+    powerOnPending = false;
+
 	return true;
 }
 
@@ -508,6 +1170,10 @@ bool LPCSensors::start(IOService *provider)
         return false;
     }
 
+    // Optional, older nubs publish only one chip
+    if ((number = OSDynamicCast(OSNumber, provider->getProperty(kSuperIOChipIndex))))
+        chipIndex = number->unsigned8BitValue();
+
     OSString *string = OSDynamicCast(OSString, provider->getProperty(kSuperIOModelName));
 
     if (!string || !(modelName = string->getCStringNoCopy())) {
@@ -522,13 +1188,43 @@ bool LPCSensors::start(IOService *provider)
         return false;
     }
 
-    if (!initialize())
+    if (!(registerLock = IORecursiveLockAlloc())) {
+        HWSensorsFatalLog("failed to allocate register lock");
         return false;
+    }
 
     OSString *modelString = OSString::withCString(modelName);
 
-	if (OSDictionary *configuration = getConfigurationNode(modelString))
+    OSDictionary *configuration = getConfigurationNode(modelString);
+
+    // Board profiles describe the first chip, other chips have own "Chip<index>" node there or use the generic profile
+    if (chipIndex && configuration) {
+        char name[8];
+
+        snprintf(name, sizeof(name), "Chip%d", chipIndex);
+
+        OSDictionary *chip = OSDynamicCast(OSDictionary, configuration->getObject(name));
+
+        configuration = chip ? chip : getConfigurationNode(OSDynamicCast(OSDictionary, getProperty("Platform Profile")), "Default");
+    }
+
+    // Chip initialization is the first transaction, firmware must already be kept off the ports
+    if (configuration)
+        setupFirmwareLock(configuration);
+
+    {
+        LPCSensorsTransaction transaction(this);
+
+        if (!transaction.isLocked() || !initialize()) {
+            OSSafeReleaseNULL(modelString);
+            return false;
+        }
+    }
+
+	if (configuration)
     {
+        setupChannelFilters(configuration);
+
         addTemperatureSensors(configuration);
         addVoltageSensors(configuration);
         addTachometerSensors(configuration);
@@ -554,6 +1250,9 @@ bool LPCSensors::start(IOService *provider)
         return false;
     }
 
+    // Start software curves set up before the timer existed
+    tachometerControlSchedule();
+
     // two power states - off and on
 	static const IOPMPowerState powerStates[2] = {
         { 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
@@ -584,3 +1283,17 @@ void LPCSensors::stop(IOService *provider)
     
     super::stop(provider);
 }
+
+void LPCSensors::free()
+{
+    if (registerLock) {
+        IORecursiveLockFree(registerLock);
+        registerLock = NULL;
+    }
+
+    OSSafeReleaseNULL(firmwareAcquireMethod);
+    OSSafeReleaseNULL(firmwareReleaseMethod);
+    OSSafeReleaseNULL(firmwareLockDevice);
+
+    super::free();
+}
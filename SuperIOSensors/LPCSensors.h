@@ -29,9 +29,13 @@
 
 #include <IOKit/IOLib.h>
 #include <IOKit/IOService.h>
+#include <IOKit/IOLocks.h>
 //#include <IOKit/IOTimerEventSource.h>
+#include <IOKit/acpi/IOACPIPlatformDevice.h>
 
 #include "FakeSMCPlugin.h"
+#include "LPCSensorsControl.h"
+#include "LPCSensorsLock.h"
 
 #define kLPCSensorsMinRPM               0000.0
 #define kLPCSensorsMaxRPM               6000.0
@@ -40,21 +44,69 @@
 #define kLPCSensorsFanMinController     2000
 #define kLPCSensorsFanManualSwitch      3000
 
-struct LPCSensorsTachometerControl {
-    UInt8   number;
+#define kLPCSensorsMaxtachometerControls       16
+
+struct LPCSensorsRegister {
+    UInt16  reg;
+    UInt8   value;
+};
+
+// Registers read while serving sensor keys are learned and then refreshed together once per epoch
+#define kLPCSensorsMaxSnapshotRegisters     128
+#define kLPCSensorsSnapshotEpoch            1000000000ULL // 1 s
 
-    bool    active;
-    float   control;
-    float   target;
-    float   error;
-    float   prevError;
-    double  integral;
-    int     samples;
+// Every reading goes through a per channel filter. Drivers report 0 for implausible samples,
+// so zero is taken only once it repeats and the last good value is served meanwhile
+#define kLPCSensorsFilterNone               0
+#define kLPCSensorsFilterMedian             1       // median of last 3 samples
+#define kLPCSensorsFilterSmoothing          2       // exponential moving average
 
-    float   minimum;
+#define kLPCSensorsFilterHistory            3
+#define kLPCSensorsFilterZeroSamples        3       // consecutive zero samples before zero is trusted
+#define kLPCSensorsFilterSpike              0.25    // of median, newest sample rejected by more counts as glitch
+#define kLPCSensorsFilterDefaultSmoothing   300     // weight of a new sample, in thousandths
+#define kLPCSensorsFilterMaxAge             10000000000ULL // 10 s, older good value is not served
+#define kLPCSensorsMaxFilterChannels        16
+
+#define kLPCSensorsFilterGlitches           "sensor-glitches"
+#define kLPCSensorsGlitchReportInterval     16      // glitches of a channel between property updates
+
+struct LPCSensorsChannelFilter {
+    UInt8   mode;
+    UInt8   count;
+    UInt8   position;
+    UInt8   zeros;
+    UInt16  smoothing;
+    float   history[kLPCSensorsFilterHistory];
+    float   value;                                          // last good value
+    UInt64  time;                                           // when last good value was taken
+    UInt32  glitches;
 };
 
-#define kLPCSensorsMaxtachometerControls       16
+// Board firmware (ACPI methods, EC) may drive the same index/data ports. When the profile
+// has an "ACPI Lock" node the outermost transaction also holds the ACPI global lock
+// and/or a pair of firmware methods doing the handshake
+#define kLPCSensorsFirmwareLockAcquired     "acpi-lock-acquired"
+#define kLPCSensorsFirmwareLockTimeouts     "acpi-lock-timeouts"
+#define kLPCSensorsFirmwareLockWaitTotal    "acpi-lock-wait-total"  // in microseconds
+#define kLPCSensorsFirmwareLockWaitMax      "acpi-lock-wait-max"    // in microseconds
+
+class LPCSensors;
+
+// Scoped register transaction. Index/data port sequences of a chip (bank select,
+// index, data) must not interleave, so every batch of register operations runs
+// under the chip lock taken once by this object
+class LPCSensorsTransaction {
+    LPCSensors*             sensors;
+    bool                    locked;
+
+public:
+    inline LPCSensorsTransaction(LPCSensors *owner);
+    inline ~LPCSensorsTransaction();
+
+    // False when firmware lock timed out, ports may be in use by firmware
+    bool                    isLocked() const { return locked; }
+};
 
 class EXPORT LPCSensors : public FakeSMCPlugin {
 	OSDeclareDefaultStructors(LPCSensors)
@@ -65,23 +117,79 @@ private:
     LPCSensorsTachometerControl    tachometerControls[kLPCSensorsMaxtachometerControls];
 
     bool                    timerScheduled;
+    bool                    manualSwitchOwner;
+    bool                    powerOnPending;
+
+    LPCSensorsRegister      snapshot[kLPCSensorsMaxSnapshotRegisters];
+    UInt8                   snapshotCount;
+    UInt64                  snapshotTime;
+    bool                    snapshotActive;
+
+    UInt8                   findSnapshotRegister(UInt16 reg);
+    void                    updateSnapshot();
 
     void                    tachometerControlInit(UInt8 number, float target);
     bool                    tachometerControlSample(UInt8 number);
     void                    tachometerControlCancel(UInt8 number);
+    void                    tachometerControlSchedule(void);
+    void                    tachometerControlDefer(UInt8 number);
+    void                    tachometerControlRestore(UInt8 number);
+
+    bool                    parseTachometerCurve(OSDictionary *node, LPCSensorsFanCurve *curve);
+    void                    tachometerCurveInit(UInt8 number);
+    float                   tachometerCurveEvaluate(UInt8 number, float temperature);
+    bool                    tachometerCurveSample(UInt8 number);
     
     IOReturn                woorkloopTimerEvent(void);
+
+    IOACPIPlatformDevice*   firmwareLockDevice;
+    OSString*               firmwareAcquireMethod;
+    OSString*               firmwareReleaseMethod;
+    bool                    firmwareGlobalLock;
+    UInt32                  firmwareLockToken;
+    UInt32                  firmwareLockTimeout;
+    bool                    firmwareLocked;
+    UInt32                  transactionDepth;
+
+    LPCSensorsFirmwareLockStatistics firmwareLockStatistics;
+
+    LPCSensorsChannelFilter filters[3][kLPCSensorsMaxFilterChannels];
+
+    LPCSensorsChannelFilter* getChannelFilter(UInt32 group, UInt32 index);
+    bool                    parseChannelFilter(OSDictionary *node, UInt8 *mode, UInt16 *smoothing);
+    void                    setupChannelFilters(OSDictionary *configuration);
+    void                    countChannelGlitch(LPCSensorsChannelFilter *filter, const char *key);
+    float                   filterSample(UInt32 group, UInt32 index, float sample, const char *key);
+
+    void                    setupFirmwareLock(OSDictionary *configuration);
+    bool                    acquireFirmwareLock(void);
+    void                    releaseFirmwareLock(void);
+    void                    publishFirmwareLockStatistics(void);
+
+    bool                    beginTransaction(void);
+    void                    endTransaction(void);
+
+    friend class LPCSensorsTransaction;
     
 protected:    
 	UInt16					address;
 	UInt8					port;
 	UInt32					model;
+    UInt8                   chipIndex;
     
 	const char              *modelName;
     const char              *vendorName;
     
     UInt8                   gpuIndex;
+
+    IORecursiveLock*        registerLock;
     
+    virtual UInt8           readRegister(UInt16 reg);
+    virtual void            writeRegister(UInt16 reg, UInt8 value);
+
+    UInt8                   readByte(UInt16 reg);
+    void                    writeByte(UInt16 reg, UInt8 value);
+
     bool                    checkConfigurationNode(OSObject *node, const char *name);
     bool                    addSensorFromConfigurationNode(OSObject *node, const char *key, const char *type, UInt8 size, UInt32 group, UInt32 index);
     
@@ -101,17 +209,36 @@ protected:
     virtual UInt8			readTachometerControl(UInt32 index);
     virtual void			writeTachometerControl(UInt32 index, UInt8 percent);
     virtual void			disableTachometerControl(UInt32 index);
+    virtual bool			writeTachometerCurve(UInt32 index, const LPCSensorsFanCurve *curve);
     
+    // Called under the chip lock when the outermost transaction starts. Firmware may
+    // have used the ports since the previous one, chips drop cached port state here
+    virtual void            didBeginTransaction(void);
+
     virtual bool            willReadSensorValue(FakeSMCSensor *sensor, float *outValue);
     virtual bool            didWriteSensorValue(FakeSMCSensor *sensor, float value);
     
     virtual bool            initialize();
     virtual void            hasPoweredOn();
 
+    // Firmware held the ports on wake, hasPoweredOn is repeated from the control timer
+    void                    deferPowerOn(void);
+
 public:
 	virtual bool			init(OSDictionary *properties=0);
     virtual bool			start(IOService *provider);
     virtual void            stop(IOService* provider);
+    virtual void            free(void);
 };
 
+LPCSensorsTransaction::LPCSensorsTransaction(LPCSensors *owner) : sensors(owner)
+{
+    locked = sensors->beginTransaction();
+}
+
+LPCSensorsTransaction::~LPCSensorsTransaction()
+{
+    sensors->endTransaction();
+}
+
 #endif
@@ -0,0 +1,197 @@
+//
+//  LPCSensorsControl.h
+//  HWSensors
+//
+//  Fan target controller of LPCSensors: PID with feed-forward and adaptive
+//  sampling. Free of IOKit so the same code runs against the simulated fans
+//  in HWSensorsTests.
+//
+
+#ifndef HWSensors_LPCSensorsControl_h
+#define HWSensors_LPCSensorsControl_h
+
+#include <libkern/OSTypes.h>
+
+// PID fan control algorithm, reference article: http://www.codeproject.com/Articles/36459/PID-process-control-a-Cruise-Control-example
+
+#define kLPCSensorsControlSamplingInterval    2000    // software fan curve, in milliseconds
+#define kLPCSensorsControlMinInterval         1000    // tachometers are updated about once a second
+#define kLPCSensorsControlMaxInterval         8000    // converged loop backs off up to this
+#define kLPCSensorsControlSamplingTimeout     60000   // one minute
+#define kLPCSensorsControlSettledError        0.03    // of target RPM
+#define kLPCSensorsControlSettledSamples      3
+#define kLPCSensorsControlIntegralLimit       40.0    // percent of control
+#define kLPCSensorsControlSteadyChange        0.02    // of RPM between samples, fan is steady enough to learn
+#define kLPCSensorsControlDefaultGain         0.05    // PWM percent per RPM, about 20 RPM per percent
+// Gains apply to the error scaled by the estimated plant gain
+#define kLPCSensorsKp   0.90
+#define kLPCSensorsKi   0.30
+#define kLPCSensorsKd   0.08
+
+#define CLIP_CONTROL(x) ((x) < 0 ? 0 : (x) > 100 ? 100 : (x))
+#define CONTROL_ABS(x) ((x) < 0 ? -(x) : (x))
+
+// Temperature to PWM curve, programmed into the chip when it supports
+// automatic fan control, run by the control timer otherwise
+#define kLPCSensorsMaxCurvePoints       4
+
+struct LPCSensorsFanCurve {
+    UInt8   count;
+    UInt8   sensor;                                         // TEMPIN index the curve follows, hardware curves select it as source
+    UInt8   temperature[kLPCSensorsMaxCurvePoints];         // in degrees C
+    UInt8   control[kLPCSensorsMaxCurvePoints];             // in percent
+    UInt8   hysteresis;                                     // in degrees C
+    UInt16  stepUp;                                         // ms per PWM step
+    UInt16  stepDown;                                       // ms per PWM step
+};
+
+// RPM measured at 0, 10 ... 100% PWM, learned while the fan is steady
+#define kLPCSensorsFeedForwardPoints    11
+
+struct LPCSensorsTachometerControl {
+    UInt8   number;
+
+    bool    active;
+    float   control;
+    float   target;
+    float   error;
+    float   base;
+    float   gain;           // estimated PWM percent per RPM, normalizes the PID terms
+    float   prevValue;
+    double  integral;
+    UInt64  deadline;
+    UInt64  next;
+    UInt32  interval;
+    UInt8   settled;
+
+    float   minimum;
+
+    float   feedForward[kLPCSensorsFeedForwardPoints];
+
+    LPCSensorsFanCurve  curve;
+    bool    curveHardware;
+    float   curveControl;
+
+    bool    pending;        // hardware update skipped while firmware held the ports
+};
+
+inline void lpc_control_learn(LPCSensorsTachometerControl *fan, float control, float value)
+{
+    int point = (control + 5) / 10;
+
+    // Only learn close to table points, otherwise the table skews
+    if (value <= 0 || point < 0 || point >= kLPCSensorsFeedForwardPoints || CONTROL_ABS(control - point * 10) > 2.5f)
+        return;
+
+    float *learned = &fan->feedForward[point];
+
+    *learned = *learned > 0 ? *learned * 0.75f + value * 0.25f : value;
+}
+
+// Control expected to reach target from the learned table, -1 if target is outside of it
+inline float lpc_control_feed_forward(const LPCSensorsTachometerControl *fan, float target)
+{
+    const float *table = fan->feedForward;
+    int lower = -1;
+
+    for (int point = 0; point < kLPCSensorsFeedForwardPoints; point++) {
+        if (table[point] <= 0)
+            continue;
+
+        if (table[point] >= target) {
+            // Target is below everything learned so far
+            if (lower < 0)
+                return table[point] == target ? point * 10 : -1;
+
+            if (table[point] <= table[lower])
+                return point * 10;
+
+            return lower * 10 + (target - table[lower]) * (point - lower) * 10 / (table[point] - table[lower]);
+        }
+
+        lower = point;
+    }
+
+    return -1;
+}
+
+// Starts a new target from the fan's current control and speed, returns the control to apply
+inline float lpc_control_start(LPCSensorsTachometerControl *fan, float target, float control, float value)
+{
+    // Fan is usually steady when control starts, good point to learn
+    lpc_control_learn(fan, control, value);
+
+    // Start from the learned operating point, PID only has to correct the rest
+    float base = lpc_control_feed_forward(fan, target);
+
+    // Nothing learned yet, fan speed is roughly proportional to PWM
+    if (base < 0)
+        base = value > 0 ? CLIP_CONTROL(control * target / value) : control;
+
+    fan->target = target;
+    fan->base = base;
+    fan->gain = base > 0 && target > 0 ? base / target : kLPCSensorsControlDefaultGain;
+    fan->control = base;
+    fan->prevValue = value;
+    fan->integral = 0;
+    fan->settled = 0;
+    fan->interval = kLPCSensorsControlMinInterval;
+
+    return base;
+}
+
+// One PID step on the speed measured fan->interval after the previous one. Updates fan->control
+// and the interval to the next sample, returns the PID drive
+inline float lpc_control_sample(LPCSensorsTachometerControl *fan, float value)
+{
+    float applied = fan->control;
+    float dt = fan->interval / 1000.0f;
+
+    fan->error = fan->target - value;
+
+    // Derivative on measurement, a target change doesn't kick the output
+    float derivative = -(value - fan->prevValue) / dt;
+
+    // Integrate only while the output is not saturated in direction of the error.
+    // Error seen after a backed off interval is mostly a fresh disturbance, don't
+    // integrate it over the whole interval
+    if (!((fan->control >= 100 && fan->error > 0) || (fan->control <= 0 && fan->error < 0)))
+        fan->integral += fan->error * (dt > kLPCSensorsControlMinInterval / 1000.0f ? kLPCSensorsControlMinInterval / 1000.0f : dt);
+
+    // Clamp integral contribution
+    double limit = kLPCSensorsControlIntegralLimit / (kLPCSensorsKi * fan->gain);
+
+    if (fan->integral > limit)
+        fan->integral = limit;
+    else if (fan->integral < -limit)
+        fan->integral = -limit;
+
+    float drive = fan->gain * (
+        fan->error * kLPCSensorsKp +
+        fan->integral * kLPCSensorsKi +
+        derivative * kLPCSensorsKd);
+
+    fan->control = CLIP_CONTROL(fan->base + drive);
+
+    // Steady fan at a known control is a feed-forward point
+    if (value > 0 && CONTROL_ABS(value - fan->prevValue) < value * kLPCSensorsControlSteadyChange)
+        lpc_control_learn(fan, applied, value);
+
+    fan->prevValue = value;
+
+    // Back off sampling once converged, come back to full rate on disturbance
+    if (CONTROL_ABS(fan->error) <= fan->target * kLPCSensorsControlSettledError) {
+        if (++fan->settled >= kLPCSensorsControlSettledSamples && fan->interval < kLPCSensorsControlMaxInterval) {
+            fan->interval <<= 1;
+            fan->settled = 0;
+        }
+    }
+    else {
+        fan->interval = kLPCSensorsControlMinInterval;
+        fan->settled = 0;
+    }
+
+    return drive;
+}
+
+#endif
@@ -0,0 +1,42 @@
+//
+//  LPCSensorsLock.h
+//  HWSensors
+//
+//  Accounting of the firmware lock taken around LPCSensors register
+//  transactions. Free of IOKit so the same code runs against the simulated
+//  firmware contender in HWSensorsTests.
+//
+
+#ifndef HWSensors_LPCSensorsLock_h
+#define HWSensors_LPCSensorsLock_h
+
+#include <libkern/OSTypes.h>
+
+#define kLPCSensorsFirmwareLockTimeout          20      // in milliseconds
+#define kLPCSensorsFirmwareLockReportInterval   256     // acquisitions between statistics updates
+
+struct LPCSensorsFirmwareLockStatistics {
+    UInt64  acquired;
+    UInt64  timeouts;
+    UInt64  waitTotal;      // in nanoseconds
+    UInt64  waitMax;        // in nanoseconds
+};
+
+// Accounts one attempt that waited for wait ns. Returns true when the statistics are due
+// to be published: every kLPCSensorsFirmwareLockReportInterval acquisitions and on timeout
+inline bool lpc_lock_account(LPCSensorsFirmwareLockStatistics *statistics, UInt64 wait, bool acquired)
+{
+    statistics->waitTotal += wait;
+
+    if (wait > statistics->waitMax)
+        statistics->waitMax = wait;
+
+    if (!acquired) {
+        statistics->timeouts++;
+        return true;
+    }
+
+    return ++statistics->acquired % kLPCSensorsFirmwareLockReportInterval == 0;
+}
+
+#endif
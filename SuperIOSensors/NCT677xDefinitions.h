@@ -0,0 +1,123 @@
+//
+//  NCT677xDefinitions.h
+//  HWSensors
+//
+//  Nuvoton hardware monitor registers and chip descriptors, free of IOKit so
+//  they can be used by HWSensorsTests.
+//
+
+#ifndef HWSensors_NCT677xDefinitions_h
+#define HWSensors_NCT677xDefinitions_h
+
+#include "SuperIODefinitions.h"
+
+const UInt8 NUVOTON_REG_ENABLE                  = 0x30;
+const UInt8 NUVOTON_HWMON_IO_SPACE_LOCK         = 0x28;
+const UInt16 NUVOTON_VENDOR_ID                  = 0x5CA3;
+
+// Hardware Monitor Registers    
+const UInt16 NUVOTON_VENDOR_ID_HIGH_REGISTER    = 0x804F;
+const UInt16 NUVOTON_VENDOR_ID_LOW_REGISTER     = 0x004F;
+const UInt16 NUVOTON_VOLTAGE_VBAT_REG           = 0x0551;
+
+const UInt16 NUVOTON_TEMPERATURE_REG[]          = { 0x027, 0x073, 0x075, 0x077, 0x150, 0x250, 0x62B, 0x62C, 0x62D };
+const UInt16 NUVOTON_TEMPERATURE_REG_NEW[]      = { 0x027, 0x073, 0x075, 0x077, 0x079, 0x07B, 0x150 };
+const UInt16 NUVOTON_TEMPERATURE_SEL_REG[]      = {	0x100, 0x200, 0x300, 0x800, 0x900, 0xa00 };
+
+// SmartFan source codes of the temperature inputs (SYSTIN 1, CPUTIN 2, AUXTIN0-2 3-5), 0 for inputs with
+// their own source select. The first input (0x027) reports the source chosen by NUVOTON_TEMPERATURE_SOURCE_REG
+const UInt8  NUVOTON_TEMPERATURE_SOURCE[]       = { 0,     1,     2,     3,     0,     0,     0,     0,     0 };
+const UInt8  NUVOTON_TEMPERATURE_SOURCE_NEW[]   = { 0,     1,     2,     3,     4,     5,     0 };
+const UInt16 NUVOTON_TEMPERATURE_SOURCE_REG     = 0x621;
+const UInt8  NUVOTON_TEMPERATURE_SOURCE_MASK    = 0x1F;
+
+const UInt16 NUVOTON_VOLTAGE_REG[]              = { 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x550, 0x551 };
+const float  NUVOTON_VOLTAGE_SCALE[]            = { 8,    8,    16,   16,   8,    8,    8,    16,    16 };
+
+const UInt16 NUVOTON_VOLTAGE_REG_NEW[]          = { 0x480, 0x481, 0x482, 0x483, 0x484, 0x485, 0x486, 0x487, 0x488, 0x489, 0x48A, 0x48B, 0x48C, 0x48D, 0x48E };
+const float  NUVOTON_VOLTAGE_SCALE_NEW[]        = { 8,     8,     16,    16,    8,     8,     8,     16,    16,    8,     8,     8,     8,     8,     8 };
+
+const UInt16 NUVOTON_FAN_RPM_REG[]              = { 0x656, 0x658, 0x65A, 0x65C, 0x65E, 0x660 };
+const UInt16 NUVOTON_FAN_STOP_REG[]             = {	0x105, 0x205, 0x305, 0x805, 0x905, 0xa05 };
+
+//const UInt16 NUVOTON_FAN_PWM_OUT_REG[]          = { 0x001, 0x003, 0x011, 0x013, 0x015, 0xa09 };
+const UInt16 NUVOTON_FAN_PWM_MODE_REG[]         = { 0x04,  0,     0,     0,     0,     0 };
+const UInt16 NUVOTON_PWM_MODE_MASK[]            = { 0x01,  0,     0,     0,     0,     0 };
+
+const UInt16 NUVOTON_FAN_PWM_MODE_OLD_REG[]     = { 0x04,  0x04,  0x12,  0,     0,     0 };
+const UInt16 NUVOTON_PWM_MODE_MASK_OLD[]        = { 0x01,  0x02,  0x01,  0,     0,     0 };
+
+const UInt16 NUVOTON_FAN_PWM_OUT_REG[]          = { 0x001, 0x003, 0x011, 0x013, 0x015, 0x017 };
+const UInt16 NUVOTON_FAN_PWM_COMMAND_REG[]      = { 0x109, 0x209, 0x309, 0x809, 0x909, 0xA09 };
+const UInt16 NUVOTON_FAN_CONTROL_MODE_REG[]     = { 0x102, 0x202, 0x302, 0x802, 0x902, 0xA02 };
+
+/* DC or PWM output fan configuration */
+const UInt16 NUVOTON_NCT6775_REG_PWM_MODE[]     = { 0x04,  0x04,  0x12,  0,     0,     0 };
+const UInt16 NUVOTON_NCT6775_PWM_MODE_MASK[]    = { 0x01,  0x02,  0x01,  0,     0,     0 };
+const UInt16 NUVOTON_NCT6776_REG_PWM_MODE[]     = { 0x04,  0,     0,     0,     0,     0 };
+const UInt16 NUVOTON_NCT6776_PWM_MODE_MASK[]    = { 0x01,  0,     0,     0,     0,     0 };
+
+const UInt16 NUVOTON_NCT6775_REG_PWM[]          = { 0x109, 0x209, 0x309, 0x809, 0x909, 0xa09 };
+const UInt16 NUVOTON_NCT6775_REG_PWM_READ[]     = {	0x01,  0x03,  0x11,  0x13,  0x15,  0xa09 };
+
+const UInt16 NUVOTON_NCT6775_REG_FAN_MODE[]     = {	0x102, 0x202, 0x302, 0x802, 0x902, 0xa02 };
+
+const UInt16 NUVOTON_NCT6775_REG_TEMP_SEL[]     = {	0x100, 0x200, 0x300, 0x800, 0x900, 0xa00 };
+
+/* SmartFan IV */
+const UInt8  NUVOTON_SMARTFAN_IV_MODE           = 0x04;
+const UInt8  NUVOTON_SMARTFAN_IV_POINTS         = 4;
+const UInt16 NUVOTON_NCT6775_REG_FAN_STEP_UP[]  = { 0x103, 0x203, 0x303, 0x803, 0x903, 0xa03 };
+const UInt16 NUVOTON_NCT6775_REG_FAN_STEP_DOWN[]= { 0x104, 0x204, 0x304, 0x804, 0x904, 0xa04 };
+const UInt16 NUVOTON_NCT6775_REG_AUTO_TEMP[]    = { 0x121, 0x221, 0x321, 0x821, 0x921, 0xa21 };
+const UInt16 NUVOTON_NCT6775_REG_AUTO_PWM[]     = { 0x127, 0x227, 0x327, 0x827, 0x927, 0xa27 };
+
+// Per-model description, bound once at start so the read path does no model branching
+struct NuvotonChipDescriptor {
+    UInt16          model;
+    UInt8           fanLimit;
+    UInt8           temperatureLimit;
+    UInt8           voltageLimit;
+    const UInt16    *temperatureRegisters;
+    const UInt8     *temperatureSources;    // SmartFan source code of each temperature input
+    const UInt16    *voltageRegisters;
+    const float     *voltageScale;          // in mV
+    UInt16          fanRpmBaseRegister;
+    UInt16          voltageVBatRegister;
+    int             minFanRPM;              // tachometer count is 16 bit on NCT6771F, 13 bit on later chips
+    bool            ioSpaceLock;            // hardware monitor i/o space can be locked by firmware
+};
+
+const NuvotonChipDescriptor NUVOTON_CHIPS[] = {
+    { NCT6771F, 3, 9, 9,  NUVOTON_TEMPERATURE_REG,     NUVOTON_TEMPERATURE_SOURCE,     NUVOTON_VOLTAGE_REG,     NUVOTON_VOLTAGE_SCALE,     0x656, 0x551, (int)(1.35e6 / 0xFFFF), false },
+    { NCT6776F, 3, 9, 9,  NUVOTON_TEMPERATURE_REG,     NUVOTON_TEMPERATURE_SOURCE,     NUVOTON_VOLTAGE_REG,     NUVOTON_VOLTAGE_SCALE,     0x656, 0x551, (int)(1.35e6 / 0x1FFF), false },
+    { NCT6779D, 5, 7, 15, NUVOTON_TEMPERATURE_REG_NEW, NUVOTON_TEMPERATURE_SOURCE_NEW, NUVOTON_VOLTAGE_REG_NEW, NUVOTON_VOLTAGE_SCALE_NEW, 0x4C0, 0x488, (int)(1.35e6 / 0x1FFF), false },
+    { NCT6791D, 6, 7, 15, NUVOTON_TEMPERATURE_REG_NEW, NUVOTON_TEMPERATURE_SOURCE_NEW, NUVOTON_VOLTAGE_REG_NEW, NUVOTON_VOLTAGE_SCALE_NEW, 0x4C0, 0x488, (int)(1.35e6 / 0x1FFF), true },
+    { NCT6792D, 6, 7, 15, NUVOTON_TEMPERATURE_REG_NEW, NUVOTON_TEMPERATURE_SOURCE_NEW, NUVOTON_VOLTAGE_REG_NEW, NUVOTON_VOLTAGE_SCALE_NEW, 0x4C0, 0x488, (int)(1.35e6 / 0x1FFF), true },
+    { NCT6793D, 6, 7, 15, NUVOTON_TEMPERATURE_REG_NEW, NUVOTON_TEMPERATURE_SOURCE_NEW, NUVOTON_VOLTAGE_REG_NEW, NUVOTON_VOLTAGE_SCALE_NEW, 0x4C0, 0x488, (int)(1.35e6 / 0x1FFF), true },
+    { NCT6795D, 6, 7, 15, NUVOTON_TEMPERATURE_REG_NEW, NUVOTON_TEMPERATURE_SOURCE_NEW, NUVOTON_VOLTAGE_REG_NEW, NUVOTON_VOLTAGE_SCALE_NEW, 0x4C0, 0x488, (int)(1.35e6 / 0x1FFF), true },
+    { NCT6796D, 6, 7, 15, NUVOTON_TEMPERATURE_REG_NEW, NUVOTON_TEMPERATURE_SOURCE_NEW, NUVOTON_VOLTAGE_REG_NEW, NUVOTON_VOLTAGE_SCALE_NEW, 0x4C0, 0x488, (int)(1.35e6 / 0x1FFF), true },
+};
+
+// Fan registers hold the speed in RPM, big endian. Values under the count limit of the chip are noise
+inline float nuvoton_fan_rpm(UInt8 high, UInt8 low, int minFanRPM)
+{
+    int value = (high << 8) | low;
+
+    return value > minFanRPM ? value : 0;
+}
+
+// SmartFan source code for a fan curve following temperature input sensor, 0 if SmartFan can not select it.
+// selected is the value of NUVOTON_TEMPERATURE_SOURCE_REG
+inline UInt8 nuvoton_curve_source(const NuvotonChipDescriptor *chip, UInt8 sensor, UInt8 selected)
+{
+    if (sensor >= chip->temperatureLimit)
+        return 0;
+
+    if (chip->temperatureSources[sensor])
+        return chip->temperatureSources[sensor];
+
+    return sensor == 0 ? selected & NUVOTON_TEMPERATURE_SOURCE_MASK : 0;
+}
+
+#endif
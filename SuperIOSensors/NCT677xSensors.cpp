@@ -52,65 +52,42 @@
 #define super LPCSensors
 OSDefineMetaClassAndStructors(NCT677xSensors, LPCSensors)
 
-UInt8 NCT677xSensors::readByte(UInt16 reg) 
+void NCT677xSensors::didBeginTransaction(void)
 {
-    UInt8 bank = reg >> 8;
-    UInt8 regi = reg & 0xFF;
-    
-    outb((UInt16)(address + NUVOTON_ADDRESS_REGISTER_OFFSET), NUVOTON_BANK_SELECT_REGISTER);
-    outb((UInt16)(address + NUVOTON_DATA_REGISTER_OFFSET), bank);
-    outb((UInt16)(address + NUVOTON_ADDRESS_REGISTER_OFFSET), regi);
-    
-    return inb((UInt16)(address + NUVOTON_DATA_REGISTER_OFFSET));
+    // Firmware may have switched banks since our previous transaction
+    bank = -1;
 }
 
-void NCT677xSensors::writeByte(UInt16 reg, UInt8 value)
+UInt8 NCT677xSensors::readRegister(UInt16 reg) 
 {
-	UInt8 bank = reg >> 8;
-    UInt8 regi = reg & 0xFF;
-    
-    outb((UInt16)(address + NUVOTON_ADDRESS_REGISTER_OFFSET), NUVOTON_BANK_SELECT_REGISTER);
-    outb((UInt16)(address + NUVOTON_DATA_REGISTER_OFFSET), bank);
-    outb((UInt16)(address + NUVOTON_ADDRESS_REGISTER_OFFSET), regi);
-    outb((UInt16)(address + NUVOTON_DATA_REGISTER_OFFSET), value);
+    return superio_hwm_read_banked(address, &bank, reg);
+}
+
+void NCT677xSensors::writeRegister(UInt16 reg, UInt8 value)
+{
+    superio_hwm_write_banked(address, &bank, reg, value);
 }
 
 UInt8 NCT677xSensors::temperatureSensorsLimit()
 {
-    return tempLimit;
+    return chip->temperatureLimit;
 }
 
 UInt8 NCT677xSensors::voltageSensorsLimit()
 {
-    return voltLimit;
+    return chip->voltageLimit;
 }
 
 UInt8 NCT677xSensors::tachometerSensorsLimit()
 {
-    return fanLimit;
+    return chip->fanLimit;
 }
 
 float NCT677xSensors::readTemperature(UInt32 index)
 {
-    if (index < tempLimit) {
+    if (index < chip->temperatureLimit) {
         
-        int value = 0;
-        
-        switch (model) {
-            case NCT6771F:
-            case NCT6776F:    
-                value = readByte(NUVOTON_TEMPERATURE_REG[index]) << 1;
-                break;
-                
-            case NCT6779D:
-            case NCT6791D:
-            case NCT6792D:
-            case NCT6793D:
-            case NCT6795D:
-            case NCT6796D:
-                value = readByte(NUVOTON_TEMPERATURE_REG_NEW[index]) << 1;
-                break;
-        }
+        int value = readByte(chip->temperatureRegisters[index]) << 1;
 
         float t = 0.5f * (float)value;
         
@@ -123,30 +100,14 @@ float NCT677xSensors::readTemperature(UInt32 index)
 
 float NCT677xSensors::readVoltage(UInt32 index)
 {
-    if (index < voltLimit) {
-        
-        float value = 0;
+    if (index < chip->voltageLimit) {
         
-        switch (model) {
-            case NCT6771F:
-            case NCT6776F:    
-                value = readByte(NUVOTON_VOLTAGE_REG[index]) * NUVOTON_VOLTAGE_SCALE[index] * 0.001f;
-                break;
-                
-            case NCT6779D:
-            case NCT6791D:
-            case NCT6792D:
-            case NCT6793D:
-            case NCT6795D:
-            case NCT6796D:
-                value = readByte(NUVOTON_VOLTAGE_REG_NEW[index]) * NUVOTON_VOLTAGE_SCALE[index] * 0.001f;
-                break;
-        }
+        float value = readByte(chip->voltageRegisters[index]) * chip->voltageScale[index] * 0.001f;
 
         bool valid = value > 0;
         
         // check if battery voltage monitor is enabled
-        if (valid && NUVOTON_VOLTAGE_REG[index] == voltageVBatRegister) {
+        if (valid && chip->voltageRegisters[index] == chip->voltageVBatRegister) {
             valid = (readByte(0x5D) & 0x01) > 0;
         }
         
@@ -158,13 +119,11 @@ float NCT677xSensors::readVoltage(UInt32 index)
 
 float NCT677xSensors::readTachometer(UInt32 index)
 {
-    if (index < fanLimit) {
-        UInt8 high = readByte(fanRpmBaseRegister + (index << 1));
-        UInt8 low = readByte(fanRpmBaseRegister + (index << 1) + 1);
-        
-        int value = (high << 8) | low;
+    if (index < chip->fanLimit) {
+        UInt8 high = readByte(chip->fanRpmBaseRegister + (index << 1));
+        UInt8 low = readByte(chip->fanRpmBaseRegister + (index << 1) + 1);
         
-        return value > minFanRPM ? value : 0;
+        return nuvoton_fan_rpm(high, low, chip->minFanRPM);
     }
     
     return 0;
@@ -182,7 +141,7 @@ UInt8 NCT677xSensors::readTachometerControl(UInt32 index)
 
 void NCT677xSensors::writeTachometerControl(UInt32 index, UInt8 percent)
 {
-    if (index < fanLimit && !fanControlEnabled[index]) {
+    if (index < chip->fanLimit && !fanControlEnabled[index]) {
 
         fanDefaultMode[index] = readByte(NUVOTON_FAN_CONTROL_MODE_REG[index]);
 
@@ -219,6 +178,45 @@ void NCT677xSensors::writeTachometerControl(UInt32 index, UInt8 percent)
     }
 }
 
+bool NCT677xSensors::writeTachometerCurve(UInt32 index, const LPCSensorsFanCurve *curve)
+{
+    if (index >= chip->fanLimit || !curve->count)
+        return false;
+
+    // SmartFan must follow the same input as the software curve would
+    UInt8 source = nuvoton_curve_source(chip, curve->sensor, curve->sensor ? 0 : readByte(NUVOTON_TEMPERATURE_SOURCE_REG));
+
+    if (!source) {
+        HWSensorsWarningLog("fan control [%d] temperature %d is not a SmartFan source, curve runs in software", index, curve->sensor);
+        return false;
+    }
+
+    writeByte(NUVOTON_NCT6775_REG_TEMP_SEL[index], (readByte(NUVOTON_NCT6775_REG_TEMP_SEL[index]) & ~NUVOTON_TEMPERATURE_SOURCE_MASK) | source);
+
+    // Points beyond the configured ones repeat the last point
+    for (UInt8 point = 0; point < NUVOTON_SMARTFAN_IV_POINTS; point++) {
+        UInt8 source = point < curve->count ? point : curve->count - 1;
+
+        writeByte(NUVOTON_NCT6775_REG_AUTO_TEMP[index] + point, curve->temperature[source]);
+        writeByte(NUVOTON_NCT6775_REG_AUTO_PWM[index] + point, (float)(curve->control[source]) * 2.55);
+    }
+
+    // Step times are in 0.1 s units
+    if (curve->stepUp)
+        writeByte(NUVOTON_NCT6775_REG_FAN_STEP_UP[index], curve->stepUp < 25500 ? curve->stepUp / 100 : 255);
+
+    if (curve->stepDown)
+        writeByte(NUVOTON_NCT6775_REG_FAN_STEP_DOWN[index], curve->stepDown < 25500 ? curve->stepDown / 100 : 255);
+
+    // Mode goes to the high nibble, low nibble holds temperature tolerance
+    writeByte(NUVOTON_NCT6775_REG_FAN_MODE[index], (NUVOTON_SMARTFAN_IV_MODE << 4) | (curve->hysteresis & 0x0f));
+
+    // Next manual write switches back to manual mode
+    fanControlEnabled[index] = false;
+
+    return true;
+}
+
 void NCT677xSensors::disableTachometerControl(UInt32 index)
 {
 //    if (fanControlEnabled[index]) {
@@ -231,6 +229,8 @@ void NCT677xSensors::disableTachometerControl(UInt32 index)
 
 bool NCT677xSensors::initialize()
 {
+    bank = -1;
+
     UInt16 vendor = (UInt16)(readByte(NUVOTON_VENDOR_ID_HIGH_REGISTER) << 8) | readByte(NUVOTON_VENDOR_ID_LOW_REGISTER);
     
     if (vendor != NUVOTON_VENDOR_ID)
@@ -239,49 +239,18 @@ bool NCT677xSensors::initialize()
         //return false;
     }
     
-    switch (model) {
-        case NCT6771F:
-            fanLimit = 3;
-            tempLimit = 9;
-            voltLimit = 9;
-            fanRpmBaseRegister = 0x656;
-            voltageVBatRegister = 0x551;
-            minFanRPM = (int)(1.35e6 / 0xFFFF);
-            break;
-            
-        case NCT6776F:
-            fanLimit = 3;
-            tempLimit = 9;
-            voltLimit = 9;
-            fanRpmBaseRegister = 0x656;
-            voltageVBatRegister = 0x551;
-            minFanRPM = (int)(1.35e6 / 0x1FFF);
-            break;
-            
-        case NCT6779D:
-            fanLimit = 5;
-            tempLimit = 7;
-            voltLimit = 15;
-            fanRpmBaseRegister = 0x4C0;
-            voltageVBatRegister = 0x488;
-            minFanRPM = (int)(1.35e6 / 0x1FFF);
-            break;
-
-        case NCT6791D:
-        case NCT6792D:
-        case NCT6793D:
-        case NCT6795D:
-        case NCT6796D:
-            fanLimit = 6;
-            tempLimit = 7;
-            voltLimit = 15;
-            fanRpmBaseRegister = 0x4C0;
-            voltageVBatRegister = 0x488;
-            minFanRPM = (int)(1.35e6 / 0x1FFF);
+    chip = NULL;
 
-
-            
+    for (unsigned int i = 0; i < sizeof(NUVOTON_CHIPS) / sizeof(NUVOTON_CHIPS[0]); i++) {
+        if (NUVOTON_CHIPS[i].model == model) {
+            chip = &NUVOTON_CHIPS[i];
             break;
+        }
+    }
+
+    if (!chip) {
+        HWSensorsFatalLog("no descriptor for model 0x%x", model);
+        return false;
     }
 
 	return true;
@@ -289,38 +258,41 @@ bool NCT677xSensors::initialize()
 
 void NCT677xSensors::hasPoweredOn()
 {
-    LPCSensors::hasPoweredOn();
-    
-    switch (model) {
-        case NCT6791D:
-        case NCT6792D:
-        case NCT6793D:
-        case NCT6795D: 
-        case NCT6796D: {
-            // disable the hardware monitor i/o space lock on NCT679xD chips
-            winbond_family_enter(port);
+    LPCSensorsTransaction transaction(this);
 
-            superio_select_logical_device(port, kWinbondHardwareMonitorLDN);
+    // Firmware still has the chip, the control timer calls us again
+    if (!transaction.isLocked()) {
+        deferPowerOn();
+        return;
+    }
 
-            /* Activate logical device if needed */
-            UInt8 options = superio_listen_port_byte(port, NUVOTON_REG_ENABLE);
+    // Firmware had the chip during sleep, don't trust the cached bank
+    bank = -1;
 
-            if (!(options & 0x01)) {
-                superio_write_port_byte(port, NUVOTON_REG_ENABLE, options | 0x01);
-            }
+    LPCSensors::hasPoweredOn();
+    
+    if (chip->ioSpaceLock) {
+        // disable the hardware monitor i/o space lock on NCT679xD chips
+        winbond_family_enter(port);
 
-            options = superio_listen_port_byte(port, NUVOTON_HWMON_IO_SPACE_LOCK);
+        superio_select_logical_device(port, kWinbondHardwareMonitorLDN);
 
-            // if the i/o space lock is enabled
-            if (options & 0x10) {
-                // disable the i/o space lock
-                superio_write_port_byte(port, NUVOTON_HWMON_IO_SPACE_LOCK, (UInt8)(options & ~0x10));
-            }
+        /* Activate logical device if needed */
+        UInt8 options = superio_listen_port_byte(port, NUVOTON_REG_ENABLE);
 
-            winbond_family_exit(port);
+        if (!(options & 0x01)) {
+            superio_write_port_byte(port, NUVOTON_REG_ENABLE, options | 0x01);
+        }
 
-            break;
+        options = superio_listen_port_byte(port, NUVOTON_HWMON_IO_SPACE_LOCK);
+
+        // if the i/o space lock is enabled
+        if (options & 0x10) {
+            // disable the i/o space lock
+            superio_write_port_byte(port, NUVOTON_HWMON_IO_SPACE_LOCK, (UInt8)(options & ~0x10));
         }
+
+        winbond_family_exit(port);
     }
 
     // Reset fan control enabled
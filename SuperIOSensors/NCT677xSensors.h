@@ -47,72 +47,23 @@
 
 #include <IOKit/IOService.h>
 #include "LPCSensors.h"
-
-const UInt8 NUVOTON_ADDRESS_REGISTER_OFFSET     = 0x05;
-const UInt8 NUVOTON_DATA_REGISTER_OFFSET        = 0x06;
-const UInt8 NUVOTON_BANK_SELECT_REGISTER        = 0x4E;
-const UInt8 NUVOTON_REG_ENABLE                  = 0x30;
-const UInt8 NUVOTON_HWMON_IO_SPACE_LOCK         = 0x28;
-const UInt16 NUVOTON_VENDOR_ID                  = 0x5CA3;
-
-// Hardware Monitor Registers    
-const UInt16 NUVOTON_VENDOR_ID_HIGH_REGISTER    = 0x804F;
-const UInt16 NUVOTON_VENDOR_ID_LOW_REGISTER     = 0x004F;
-const UInt16 NUVOTON_VOLTAGE_VBAT_REG           = 0x0551;
-
-const UInt16 NUVOTON_TEMPERATURE_REG[]          = { 0x027, 0x073, 0x075, 0x077, 0x150, 0x250, 0x62B, 0x62C, 0x62D };
-const UInt16 NUVOTON_TEMPERATURE_REG_NEW[]      = { 0x027, 0x073, 0x075, 0x077, 0x079, 0x07B, 0x150 };
-const UInt16 NUVOTON_TEMPERATURE_SEL_REG[]      = {	0x100, 0x200, 0x300, 0x800, 0x900, 0xa00 };
-
-const UInt16 NUVOTON_VOLTAGE_REG[]              = { 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x550, 0x551 };
-const float  NUVOTON_VOLTAGE_SCALE[]            = { 8,    8,    16,   16,   8,    8,    8,    16,    16 };
-
-const UInt16 NUVOTON_VOLTAGE_REG_NEW[]          = { 0x480, 0x481, 0x482, 0x483, 0x484, 0x485, 0x486, 0x487, 0x488, 0x489, 0x48A, 0x48B, 0x48C, 0x48D, 0x48E };
-
-const UInt16 NUVOTON_FAN_RPM_REG[]              = { 0x656, 0x658, 0x65A, 0x65C, 0x65E, 0x660 };
-const UInt16 NUVOTON_FAN_STOP_REG[]             = {	0x105, 0x205, 0x305, 0x805, 0x905, 0xa05 };
-
-//const UInt16 NUVOTON_FAN_PWM_OUT_REG[]          = { 0x001, 0x003, 0x011, 0x013, 0x015, 0xa09 };
-const UInt16 NUVOTON_FAN_PWM_MODE_REG[]         = { 0x04,  0,     0,     0,     0,     0 };
-const UInt16 NUVOTON_PWM_MODE_MASK[]            = { 0x01,  0,     0,     0,     0,     0 };
-
-const UInt16 NUVOTON_FAN_PWM_MODE_OLD_REG[]     = { 0x04,  0x04,  0x12,  0,     0,     0 };
-const UInt16 NUVOTON_PWM_MODE_MASK_OLD[]        = { 0x01,  0x02,  0x01,  0,     0,     0 };
-
-const UInt16 NUVOTON_FAN_PWM_OUT_REG[]          = { 0x001, 0x003, 0x011, 0x013, 0x015, 0x017 };
-const UInt16 NUVOTON_FAN_PWM_COMMAND_REG[]      = { 0x109, 0x209, 0x309, 0x809, 0x909, 0xA09 };
-const UInt16 NUVOTON_FAN_CONTROL_MODE_REG[]     = { 0x102, 0x202, 0x302, 0x802, 0x902, 0xA02 };
-
-/* DC or PWM output fan configuration */
-const UInt16 NUVOTON_NCT6775_REG_PWM_MODE[]     = { 0x04,  0x04,  0x12,  0,     0,     0 };
-const UInt16 NUVOTON_NCT6775_PWM_MODE_MASK[]    = { 0x01,  0x02,  0x01,  0,     0,     0 };
-const UInt16 NUVOTON_NCT6776_REG_PWM_MODE[]     = { 0x04,  0,     0,     0,     0,     0 };
-const UInt16 NUVOTON_NCT6776_PWM_MODE_MASK[]    = { 0x01,  0,     0,     0,     0,     0 };
-
-const UInt16 NUVOTON_NCT6775_REG_PWM[]          = { 0x109, 0x209, 0x309, 0x809, 0x909, 0xa09 };
-const UInt16 NUVOTON_NCT6775_REG_PWM_READ[]     = {	0x01,  0x03,  0x11,  0x13,  0x15,  0xa09 };
-
-const UInt16 NUVOTON_NCT6775_REG_FAN_MODE[]     = {	0x102, 0x202, 0x302, 0x802, 0x902, 0xa02 };
-
-const UInt16 NUVOTON_NCT6775_REG_TEMP_SEL[]     = {	0x100, 0x200, 0x300, 0x800, 0x900, 0xa00 };
+#include "SuperIODevice.h"
+#include "NCT677xDefinitions.h"
 
 class EXPORT NCT677xSensors : public LPCSensors
 {
     OSDeclareDefaultStructors(NCT677xSensors)
 	
 private:   
-    UInt8					fanLimit;
-    UInt8					tempLimit;
-    UInt8                   voltLimit;
-    UInt16                  fanRpmBaseRegister;
-    int                     minFanRPM;
-    UInt16                  voltageVBatRegister;
+    const NuvotonChipDescriptor *chip;
     bool                    fanControlEnabled[6];
 
     UInt8                   fanDefaultMode[6];
-    
-   	UInt8					readByte(UInt16 reg);
-    void					writeByte(UInt16 reg, UInt8 value);
+
+    SInt16                  bank;
+
+   	virtual UInt8			readRegister(UInt16 reg);
+    virtual void			writeRegister(UInt16 reg, UInt8 value);
 	
     virtual UInt8           temperatureSensorsLimit();
     virtual UInt8           voltageSensorsLimit();
@@ -126,9 +77,11 @@ private:
     virtual bool			isTachometerControlable(UInt32 index);
     virtual UInt8			readTachometerControl(UInt32 index);
     virtual void			writeTachometerControl(UInt32 index, UInt8 percent);
+    virtual bool			writeTachometerCurve(UInt32 index, const LPCSensorsFanCurve *curve);
     virtual void			disableTachometerControl(UInt32 index);
     
 	virtual bool			initialize();
+    virtual void            didBeginTransaction(void);
     virtual void            hasPoweredOn();
     
 public:
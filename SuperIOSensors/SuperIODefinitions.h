@@ -0,0 +1,400 @@
+//
+//  SuperIODefinitions.h
+//  HWSensors
+//
+//  Port I/O layer, chip database and detection shared by SuperIODevice and
+//  the chip drivers. Free of IOKit so the same code runs against register-file
+//  models of the chips in HWSensorsTests.
+//
+
+#ifndef HWSensors_SuperIODefinitions_h
+#define HWSensors_SuperIODefinitions_h
+
+#include <libkern/OSTypes.h>
+#include <architecture/i386/pio.h>
+
+// Entering ports
+const UInt8 kSuperIOPorts[]               = {0x2e, 0x4e};
+
+// Registers
+const UInt8 kSuperIOConfigControlRegister = 0x02;
+const UInt8 kSuperIOChipIDRegister        = 0x20;
+const UInt8 kSuperIOBaseAddressRegister   = 0x60;
+const UInt8 kSuperIODeviceSelectRegister  = 0x07;
+
+// Logical device number
+const UInt8 kWinbondHardwareMonitorLDN    = 0x0B;
+const UInt8 kF71858HardwareMonitorLDN     = 0x02;
+const UInt8 kFintekITEHardwareMonitorLDN  = 0x04;
+
+enum SuperIOModel
+{
+    // ITE
+	IT8512F     = 0x8512,
+    IT8705F     = 0x8705,
+    IT8712F     = 0x8712,
+    IT8716F     = 0x8716,
+    IT8718F     = 0x8718,
+    IT8720F     = 0x8720,
+    IT8721F     = 0x8721,
+    IT8726F     = 0x8726,
+    IT8620E     = 0x8620,
+    IT8628E     = 0x8628,
+    IT8686E     = 0x8686,
+	IT8728F     = 0x8728,
+	IT8752F     = 0x8752,
+    IT8771E     = 0x8771,
+    IT8772E     = 0x8772,
+    IT8792E     = 0x8792,
+    
+    // Winbond
+    W83627DHG	= 0xA020,
+	W83627UHG	= 0xA230,
+    W83627DHGP	= 0xB070,
+    W83627EHF	= 0x8800,    
+    W83627HF	= 0x5200,
+	W83627THF	= 0x8280,
+	W83627SF	= 0x5950,
+	W83637HF	= 0x7080,
+    W83667HG	= 0xA510,
+    W83667HGB	= 0xB350,
+    W83687THF	= 0x8541,
+	W83697HF	= 0x6010,
+	W83697SF	= 0x6810,
+    
+    // Fintek
+    F71858		= 0x0507,
+    F71862		= 0x0601,
+    F71868A     = 0x1106,
+    F71869		= 0x0814,
+    F71869A     = 0x1007,
+    F71882		= 0x0541,
+    F71889AD    = 0x1005,
+    F71889ED	= 0x0909,
+    F71889F		= 0x0723,
+    F71808E     = 0x0901,
+    
+    // Nuvoton
+    NCT6771F    = 0xB470,
+    NCT6776F    = 0xC330,
+    NCT6779D    = 0xC560,
+    NCT6791D    = 0xC803,
+    NCT6792D    = 0xC911,
+    NCT6793D    = 0xD121,
+    NCT6795D    = 0xD352,
+    NCT6796D    = 0xD423,
+};
+
+// Port I/O backend, native by default. Can be replaced to run the drivers
+// against register-file models of the chips instead of real LPC hardware
+struct SuperIOPortIO
+{
+    UInt8   (*read)(i386_ioport_t port);
+    void    (*write)(i386_ioport_t port, UInt8 value);
+};
+
+extern SuperIOPortIO    superio_port_io;
+extern UInt64           superio_port_operations;
+
+void superio_set_port_io(const SuperIOPortIO *io);
+
+inline UInt8 superio_inb(i386_ioport_t port)
+{
+    superio_port_operations++;
+    return superio_port_io.read(port);
+}
+
+inline void superio_outb(i386_ioport_t port, UInt8 value)
+{
+    superio_port_operations++;
+    superio_port_io.write(port, value);
+}
+
+inline UInt8 superio_listen_port_byte(i386_ioport_t port, UInt8 reg)
+{
+	superio_outb(port, reg);
+	return superio_inb(port + 1);
+}
+
+inline UInt16 superio_listen_port_word(i386_ioport_t port, UInt8 reg)
+{
+	return ((superio_listen_port_byte(port, reg) << 8) | superio_listen_port_byte(port, reg + 1));
+}
+
+inline void superio_write_port_byte(i386_ioport_t port, UInt8 reg, UInt8 value)
+{
+	superio_outb(port, reg);
+	superio_outb(port + 1, value);
+}
+
+inline void superio_select_logical_device(i386_ioport_t port, UInt8 reg)
+{
+	superio_outb(port, kSuperIODeviceSelectRegister);
+	superio_outb(port + 1, reg);
+}
+
+inline void ite_family_enter(i386_ioport_t port)
+{
+    superio_outb(port, 0x87);
+	superio_outb(port, 0x01);
+	superio_outb(port, 0x55);
+	superio_outb(port, port == 0x4e ? 0xaa : 0x55);
+}
+
+inline void ite_family_exit(i386_ioport_t port)
+{
+    superio_outb(port, kSuperIOConfigControlRegister);
+	superio_outb(port + 1, 0x02);
+}
+
+inline void winbond_family_enter(i386_ioport_t port)
+{
+    superio_outb(port, 0x87);
+	superio_outb(port, 0x87);
+}
+
+inline void winbond_family_exit(i386_ioport_t port)
+{
+    superio_outb(port, 0xAA);
+}
+
+// Chip database, adding a chip means adding a row here and to the driver's own descriptor table
+enum SuperIOFamily
+{
+    kSuperIOFamilyWinbond   = 0,    // Winbond, Nuvoton and Fintek entry sequence
+    kSuperIOFamilyITE       = 1,
+};
+
+struct SuperIOChipDescriptor
+{
+    UInt16          id;             // chip ID register value with revision bits cleared
+    UInt16          mask;           // chip ID bits identifying the model, the rest is revision
+    UInt16          model;
+    UInt8           ldn;
+    UInt8           family;
+    const char      *vendor;
+    const char      *name;
+};
+
+const SuperIOChipDescriptor kSuperIOChips[] =
+{
+    // ITE
+    { IT8512F,  0xFFFF, IT8512F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8512F" },
+    { IT8705F,  0x0000, IT8705F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8705F" }, // name only, not detected
+    { IT8712F,  0xFFFF, IT8712F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8712F" },
+    { IT8716F,  0xFFFF, IT8716F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8716F" },
+    { IT8718F,  0xFFFF, IT8718F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8718F" },
+    { IT8720F,  0xFFFF, IT8720F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8720F" },
+    { IT8721F,  0xFFFF, IT8721F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8721F" },
+    { IT8726F,  0xFFFF, IT8726F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8726F" },
+    { IT8620E,  0xFFFF, IT8620E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8620E" }, // monitoring device of IT8620E is compatible with IT8728F
+    { IT8628E,  0xFFFF, IT8628E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8628E" },
+    { IT8686E,  0xFFFF, IT8686E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8686E" },
+    { IT8728F,  0xFFFF, IT8728F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8728F" },
+    { IT8752F,  0xFFFF, IT8752F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8752F" },
+    { IT8771E,  0xFFFF, IT8771E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8771E" },
+    { IT8772E,  0xFFFF, IT8772E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8772E" },
+    { IT8792E,  0xFFFF, IT8792E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyITE,      "ITE",      "IT8792E" },
+
+    // Fintek
+    { F71858,   0xFFFF, F71858,     kF71858HardwareMonitorLDN,      kSuperIOFamilyWinbond,  "Fintek",   "F71858" },
+    { F71862,   0xFFFF, F71862,     kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71862" },
+    { F71868A,  0xFFFF, F71868A,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71868A" },
+    { F71869,   0xFFFF, F71869,     kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71869" },
+    { F71869A,  0xFFFF, F71869A,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71869A" },
+    { F71882,   0xFFFF, F71882,     kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71882" },
+    { F71889AD, 0xFFFF, F71889AD,   kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71889AD" },
+    { F71889ED, 0xFFFF, F71889ED,   kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71889ED" },
+    { F71889F,  0xFFFF, F71889F,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71889F" },
+    { F71808E,  0xFFFF, F71808E,    kFintekITEHardwareMonitorLDN,   kSuperIOFamilyWinbond,  "Fintek",   "F71808E" },
+
+    // Winbond
+    { 0x5217,   0xFFFF, W83627HF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627HF" },
+    { 0x523A,   0xFFFF, W83627HF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627HF" },
+    { 0x5241,   0xFFFF, W83627HF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627HF" },
+    { 0x8280,   0xFFF0, W83627THF,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627THF" },
+    { 0x8541,   0xFFFF, W83687THF,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83687THF" },
+    { 0x8850,   0xFFF0, W83627EHF,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627EHF" },
+    { 0x8860,   0xFFF0, W83627EHF,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627EHF" },
+    { 0xA020,   0xFFF0, W83627DHG,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627DHG" },
+    { 0xA510,   0xFFF0, W83667HG,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83667HG" },
+    { 0xB070,   0xFFF0, W83627DHGP, kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627DHGP" },
+    { 0xB350,   0xFFF0, W83667HGB,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83667HGB" },
+    { W83627UHG,0x0000, W83627UHG,  kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627UHG" }, // name only, not detected
+    { W83627SF, 0x0000, W83627SF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83627SF" },  // name only, not detected
+    { W83637HF, 0x0000, W83637HF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83637HF" },  // name only, not detected
+    { W83697HF, 0x0000, W83697HF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83697HF" },  // name only, not detected
+    { W83697SF, 0x0000, W83697SF,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Winbond",  "W83697SF" },  // name only, not detected
+
+    // Nuvoton
+    { 0xB470,   0xFFF0, NCT6771F,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6771F" },
+    { 0xC330,   0xFFF0, NCT6776F,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6776F" },
+    { 0xC560,   0xFFF0, NCT6779D,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6779D" },
+    { 0xC803,   0xFFFF, NCT6791D,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6791D" },
+    { 0xC911,   0xFFFF, NCT6792D,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6792D" },
+    { 0xD121,   0xFFFF, NCT6793D,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6793D" },
+    { 0xD352,   0xFFFF, NCT6795D,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6795D" },
+    { 0xD423,   0xFFFF, NCT6796D,   kWinbondHardwareMonitorLDN,     kSuperIOFamilyWinbond,  "Nuvoton",  "NCT6796D" },
+};
+
+inline const SuperIOChipDescriptor* superio_find_chip(UInt16 id, UInt8 family)
+{
+    for (unsigned int i = 0; i < sizeof(kSuperIOChips) / sizeof(kSuperIOChips[0]); i++) {
+        const SuperIOChipDescriptor *chip = &kSuperIOChips[i];
+
+        if (chip->mask && chip->family == family && (id & chip->mask) == chip->id)
+            return chip;
+    }
+
+    return NULL;
+}
+
+inline const char* superio_get_model_name(UInt16 model)
+{
+    for (unsigned int i = 0; i < sizeof(kSuperIOChips) / sizeof(kSuperIOChips[0]); i++) {
+        if (kSuperIOChips[i].model == model)
+            return kSuperIOChips[i].name;
+    }
+    
+    return "unknown";
+}
+
+// Hardware monitor index/data pair, relative to the address read from the logical device
+const UInt8 kSuperIOHWMIndexOffset        = 0x05;
+const UInt8 kSuperIOHWMDataOffset         = 0x06;
+
+// Winbond and Nuvoton monitors are banked, the bank is the high byte of the register number
+const UInt8 kSuperIOHWMBankSelectRegister = 0x4E;
+
+inline UInt8 superio_hwm_read(UInt16 address, UInt8 reg)
+{
+    superio_outb(address + kSuperIOHWMIndexOffset, reg);
+    return superio_inb(address + kSuperIOHWMDataOffset);
+}
+
+inline void superio_hwm_write(UInt16 address, UInt8 reg, UInt8 value)
+{
+    superio_outb(address + kSuperIOHWMIndexOffset, reg);
+    superio_outb(address + kSuperIOHWMDataOffset, value);
+}
+
+// bank caches the selected bank, -1 when unknown (firmware may have switched it)
+inline void superio_hwm_select_bank(UInt16 address, SInt16 *bank, UInt8 value)
+{
+    if (*bank != value) {
+        superio_hwm_write(address, kSuperIOHWMBankSelectRegister, value);
+        *bank = value;
+    }
+}
+
+inline UInt8 superio_hwm_read_banked(UInt16 address, SInt16 *bank, UInt16 reg)
+{
+    superio_hwm_select_bank(address, bank, reg >> 8);
+    return superio_hwm_read(address, reg & 0xFF);
+}
+
+inline void superio_hwm_write_banked(UInt16 address, SInt16 *bank, UInt16 reg, UInt8 value)
+{
+    superio_hwm_select_bank(address, bank, reg >> 8);
+    superio_hwm_write(address, reg & 0xFF, value);
+}
+
+// Chip found on a configuration port
+struct SuperIOChipInfo
+{
+    UInt16          id;             // raw chip ID, valid even if the chip is not supported
+    UInt16          model;
+    UInt8           ldn;
+    const char      *vendor;
+    UInt16          address;        // hardware monitor base address
+};
+
+// Waits between configuration accesses, IOSleep in the kernel
+void superio_delay(UInt32 milliseconds);
+
+inline void superio_clear_chip_info(SuperIOChipInfo *info)
+{
+    info->model = 0;
+    info->ldn = 0;
+    info->vendor = "";
+    info->address = 0;
+}
+
+// Reads the base address twice, the configuration space is shared with firmware
+inline bool superio_read_base_address(i386_ioport_t port, UInt8 ldn, UInt32 settle, UInt32 verify, UInt16 *address)
+{
+    superio_select_logical_device(port, ldn);
+
+    if (settle)
+        superio_delay(settle);
+
+    *address = superio_listen_port_word(port, kSuperIOBaseAddressRegister);
+
+    superio_delay(verify);
+
+    return superio_listen_port_word(port, kSuperIOBaseAddressRegister) == *address;
+}
+
+inline bool superio_detect_winbond_family(i386_ioport_t port, SuperIOChipInfo *info)
+{
+    superio_clear_chip_info(info);
+
+    winbond_family_enter(port);
+
+    info->id = superio_listen_port_word(port, kSuperIOChipIDRegister);
+
+    const SuperIOChipDescriptor *chip = superio_find_chip(info->id, kSuperIOFamilyWinbond);
+
+    if (!chip || !chip->ldn) {
+        winbond_family_exit(port);
+        return false;
+    }
+
+    info->model = chip->model;
+    info->ldn = chip->ldn;
+    info->vendor = chip->vendor;
+
+    bool stable = superio_read_base_address(port, chip->ldn, 0, 50, &info->address);
+
+    winbond_family_exit(port);
+
+    if (!stable)
+        return false;
+
+    // some Fintek chips have address register offset 0x05 added already
+    if ((info->address & 0x07) == 0x05)
+        info->address &= 0xFFF8;
+
+    return info->address >= 0x100 && (info->address & 0xF007) == 0;
+}
+
+inline bool superio_detect_ite_family(i386_ioport_t port, SuperIOChipInfo *info)
+{
+    superio_clear_chip_info(info);
+
+    // Secondary IT87XX (IT8792E and alike) sits on port 0x4E and uses own entry key
+    ite_family_enter(port);
+
+    info->id = superio_listen_port_word(port, kSuperIOChipIDRegister);
+
+    const SuperIOChipDescriptor *chip = superio_find_chip(info->id, kSuperIOFamilyITE);
+
+    if (!chip || !chip->ldn) {
+        ite_family_exit(port);
+        return false;
+    }
+
+    info->model = chip->model;
+    info->ldn = chip->ldn;
+    info->vendor = chip->vendor;
+
+    bool stable = superio_read_base_address(port, chip->ldn, 10, 10, &info->address);
+
+    superio_delay(10);
+
+    ite_family_exit(port);
+
+    return stable && info->address >= 0x100 && (info->address & 0xF007) == 0;
+}
+
+#endif
@@ -14,315 +14,78 @@ void* _org_rehabman_dontstrip[] =
     (void*)&OSKextGetCurrentVersionString,
 };
 
+static UInt8 superio_native_inb(i386_ioport_t port)
+{
+    return inb(port);
+}
+
+static void superio_native_outb(i386_ioport_t port, UInt8 value)
+{
+    outb(port, value);
+}
+
+SuperIOPortIO superio_port_io = { superio_native_inb, superio_native_outb };
+UInt64 superio_port_operations = 0;
+
+void superio_set_port_io(const SuperIOPortIO *io)
+{
+    superio_port_io.read = io && io->read ? io->read : superio_native_inb;
+    superio_port_io.write = io && io->write ? io->write : superio_native_outb;
+}
+
+void superio_delay(UInt32 milliseconds)
+{
+    IOSleep(milliseconds);
+}
+
 #define Debug FALSE
 
 #define super IOService
 OSDefineMetaClassAndStructors(SuperIODevice, IOService)
 
-bool SuperIODevice::detectWinbondFamilyChip()
+bool SuperIODevice::detectFamilyChip(i386_ioport_t probePort, bool ite)
 {
-    for (int i = 0; i < 2; i++) {
-        port = kSuperIOPorts[i];
-        
-        winbond_family_enter(port);
-        
-        id = superio_listen_port_word(port, kSuperIOChipIDRegister);
-
-        HWSensorsDebugLog("probing device on 0x%x, id=0x%x", port, id);
-        
-        switch (id) {
-                // Fintek
-            case F71858:
-                model = id;
-                ldn = kF71858HardwareMonitorLDN;
-                vendor = "Fintek";
-                break;
-                
-            case F71862:
-            case F71868A:
-            case F71869:
-            case F71869A:
-            case F71882:
-            case F71889AD:
-            case F71889ED:
-            case F71889F:
-            case F71808E:
-                model = id;
-                ldn = kFintekITEHardwareMonitorLDN;
-                vendor = "Fintek";
-                break;
-                
-            default:
-                switch (id >> 8) {
-                        // Winbond
-                    case 0x52:
-                        switch (id & 0xff) {
-                            case 0x17:
-                            case 0x3A:
-                            case 0x41:
-                                model = W83627HF;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0x82:
-                        switch (id & 0xf0) {
-                            case 0x80:
-                                model = W83627THF;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0x85:
-                        switch (id & 0xff) {
-                            case 0x41:
-                                model = W83687THF;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0x88:
-                        switch (id & 0xf0) {
-                            case 0x50:
-                            case 0x60:
-                                model = W83627EHF;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0xA0:
-                        switch (id & 0xf0) {
-                            case 0x20:
-                                model = W83627DHG;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0xA5:
-                        switch (id & 0xf0) {
-                            case 0x10:
-                                model = W83667HG;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0xB0:
-                        switch (id & 0xf0) {
-                            case 0x70:
-                                model = W83627DHGP;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                    case 0xB3:
-                        switch (id & 0xf0) {
-                            case 0x50:
-                                model = W83667HGB;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Winbond";
-                                break;
-                        }
-                        break;
-                        
-                        // Nuvoton
-                    case 0xB4:
-                        switch (id & 0xf0) {
-                            case 0x70:
-                                model = NCT6771F;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        }
-                        break;
-                        
-                    case 0xC3:
-                        switch (id & 0xf0) {
-                            case 0x30:
-                                model = NCT6776F;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        }
-                        break;
-                        
-                    case 0xC5:
-                        switch (id & 0xf0) {
-                            case 0x60:
-                                model = NCT6779D;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        } break;
-
-                    case 0xC8:
-                        switch (id & 0xff) {
-                            case 0x03:
-                                model = NCT6791D;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        } break;
-                        
-                    case 0xC9:
-                        switch (id & 0xff) {
-                            case 0x11:
-                                model = NCT6792D;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        } break;
-                        
-                    case 0xD1:
-                        switch (id & 0xff) {
-                            case 0x21:
-                                model = NCT6793D;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        } break;
-
-                    case 0xD3:
-                        switch (id & 0xff) {
-                            case 0x52:
-                                model = NCT6795D;
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        } break;
-                    
-                    case 0xD4:
-                        switch (id & 0xff) {
-                            case 0x23:
-                                model = NCT6796D;
-
-                                ldn = kWinbondHardwareMonitorLDN;
-                                vendor = "Nuvoton";
-                                break;
-                        } break;
-
-                } break;
-        }
-        
-        UInt16 verify = 0;
-        
-        if (model != 0 && ldn != 0) {
-
-            HWSensorsDebugLog("detected %s %s, starting address sanity checks", vendor, superio_get_model_name(model));
-            
-            superio_select_logical_device(port, ldn);
-            
-            address = superio_listen_port_word(port, kSuperIOBaseAddressRegister);
-            
-            IOSleep(50);
-            
-            verify = superio_listen_port_word(port, kSuperIOBaseAddressRegister);
-
-            winbond_family_exit(port);
-            
-            if (address != verify) {
-                HWSensorsDebugLog("address verify check error!");
-                continue;
-            }
-            
-            // some Fintek chips have address register offset 0x05 added already
-            if ((address & 0x07) == 0x05)
-                address &= 0xFFF8;
-            
-            if (address < 0x100 || (address & 0xF007) != 0) {
-                HWSensorsDebugLog("address is out of bounds!");
-                continue;
-            }
+    SuperIOChipInfo info;
 
-            return true;
-        }
-        else winbond_family_exit(port);
-    }
-    
-    return false;
-}
+    bool found = ite ? superio_detect_ite_family(probePort, &info) : superio_detect_winbond_family(probePort, &info);
 
-bool SuperIODevice::detectITEFamilyChip()
-{
-    // IT87XX can enter only on port 0x2E
-    port = 0x2E;
+    HWSensorsDebugLog("probing device on 0x%x, id=0x%x", probePort, info.id);
 
-    ite_family_enter(port);
-    
-    id = superio_listen_port_word(port, kSuperIOChipIDRegister);
+    port = probePort;
+    id = info.id;
+    model = info.model;
+    ldn = info.ldn;
+    vendor = info.vendor;
+    address = info.address;
 
-    HWSensorsDebugLog("probing device on 0x%x, id=0x%x", port, id);
+    if (model && !found)
+        HWSensorsDebugLog("detected %s %s, address 0x%x failed sanity checks", vendor, superio_get_model_name(model), address);
 
-    ldn = 0;
-    vendor = "";
-    
-    switch (id) {
-        case IT8512F:
-        case IT8712F:
-        case IT8716F:
-        case IT8718F:
-        case IT8720F:
-        case IT8721F:
-        case IT8726F:
-        case IT8620E:
-        case IT8628E:
-        case IT8686E:
-        case IT8728F:
-        case IT8752F:
-        case IT8771E:
-        case IT8772E:
-        case IT8792E:
-            model = id;
-            ldn = kFintekITEHardwareMonitorLDN;
-            vendor = "ITE";
-            break;
-    }
-    
-    if (model != 0 && ldn != 0) {
-
-        HWSensorsDebugLog("detected %s %s, starting address sanity checks", vendor, superio_get_model_name(model));
-
-        superio_select_logical_device(port, ldn);
-        
-        IOSleep(10);
-        
-        address = superio_listen_port_word(port, kSuperIOBaseAddressRegister);
-        
-        IOSleep(10);
-        
-        UInt16 verify = superio_listen_port_word(port, kSuperIOBaseAddressRegister);
-        
-        IOSleep(10);
-        
-        ite_family_exit(port);
-        
-        if (address != verify || address < 0x100 || (address & 0xF007) != 0)
-            return false;
-        
-        return true;
-    }
-    else ite_family_exit(port);
-    
-    return false;
+    return found;
+}
+
+bool SuperIODevice::detectWinbondFamilyChip(i386_ioport_t probePort)
+{
+    return detectFamilyChip(probePort, false);
+}
+
+bool SuperIODevice::detectITEFamilyChip(i386_ioport_t probePort)
+{
+    return detectFamilyChip(probePort, true);
 }
 
 bool SuperIODevice::init(OSDictionary *dictionary)
 {
 	if (!super::init(dictionary))
 		return false;
+
+    id = 0;
+    model = 0;
+    ldn = 0;
+    vendor = "";
+    address = 0;
+    port = 0;
+    index = 0;
     
 	return true;
 }
@@ -337,38 +100,74 @@ bool SuperIODevice::start(IOService *provider)
 	if (!super::start(provider)) return false;
 
     // Gigabyte mobos usualy use ITE
+    bool iteFirst = false;
+
     if (OSDictionary *matching = serviceMatching(kFakeSMCService)) {
         if (IOService *headingProvider = waitForMatchingService(matching, kFakeSMCDefaultWaitTimeout)) {
             if (OSString *manufacturer = OSDynamicCast(OSString, headingProvider->getProperty(kOEMInfoManufacturer))) {
-                if (manufacturer->isEqualTo("Gigabyte")) {
-                    if (!detectITEFamilyChip()) {
-
-                        UInt16 ite_id = id;
-
-                        if (!detectWinbondFamilyChip()) {
-                            HWSensorsFatalLog("found unsupported chip! ITE sequence ID=0x%x, Winbond sequence ID=0x%x", ite_id, id);
-                            return false;
-                        }
-                    }
-                }
+                iteFirst = manufacturer->isEqualTo("Gigabyte");
             }
         }
         OSSafeReleaseNULL(matching);
     }
 
-    // Other vendors usualy use Winbond family chipsets
-    if (model == 0) {
-        if (!detectWinbondFamilyChip()) {
-            
-            UInt16 wnbnd_id = id;
-            
-            if (!detectITEFamilyChip()) {
-                HWSensorsFatalLog("found unsupported chip! ITE sequence ID=0x%x, Winbond sequence ID=0x%x", id, wnbnd_id);
-                return false;
+    // Boards may carry more than one chip, this device takes the first one found, a new nub is published for every other
+    SuperIODevice *device = this;
+    UInt8 count = 0;
+
+    for (int i = 0; i < 2; i++) {
+
+        if (!device) {
+            if (!(device = new SuperIODevice) || !device->init()) {
+                OSSafeReleaseNULL(device);
+                break;
             }
         }
+
+        if (!device->detectChip(kSuperIOPorts[i], iteFirst))
+            continue;
+
+        device->index = count++;
+
+        if (device != this) {
+            if (device->attach(this))
+                device->publish();
+
+            device->release();
+        }
+        else publish();
+
+        device = NULL;
     }
-    
+
+    if (device && device != this)
+        device->release();
+
+    if (!count) {
+        HWSensorsFatalLog("no supported chip found");
+        return false;
+    }
+
+    return true;
+}
+
+bool SuperIODevice::detectChip(i386_ioport_t probePort, bool iteFirst)
+{
+    if (iteFirst ? detectITEFamilyChip(probePort) : detectWinbondFamilyChip(probePort))
+        return true;
+
+    UInt16 first = id;
+
+    if (iteFirst ? detectWinbondFamilyChip(probePort) : detectITEFamilyChip(probePort))
+        return true;
+
+    HWSensorsDebugLog("no supported chip on port 0x%x! ITE sequence ID=0x%x, Winbond sequence ID=0x%x", probePort, iteFirst ? first : id, iteFirst ? id : first);
+
+    return false;
+}
+
+void SuperIODevice::publish()
+{
     HWSensorsInfoLog("found %s %s on port=0x%x address=0x%x", vendor, superio_get_model_name(model), port, address);
     
     char string[128];
@@ -382,6 +181,7 @@ bool SuperIODevice::start(IOService *provider)
     setProperty(kSuperIOHWMAddress, address, 16);
     setProperty(kSuperIOControlPort, port, 8);
     setProperty(kSuperIOModelValue, model, 16);
+    setProperty(kSuperIOChipIndex, index, 8);
     
     setProperty(kSuperIOModelName, superio_get_model_name(model));
     setProperty(kSuperIOVendorName, vendor);
@@ -389,8 +189,6 @@ bool SuperIODevice::start(IOService *provider)
     setProperty(kSuperIODeviceID, OSData::withBytes(&id, sizeof(id)));
     
     registerService();
-    
-    return true;
 }
 
 void SuperIODevice::stop(IOService *provider)
@@ -0,0 +1,146 @@
+//
+//  W836xxDefinitions.h
+//  HWSensors
+//
+//  Winbond hardware monitor registers and chip descriptors, free of IOKit so
+//  they can be used by HWSensorsTests.
+//
+
+#ifndef HWSensors_W836xxDefinitions_h
+#define HWSensors_W836xxDefinitions_h
+
+#include "SuperIODefinitions.h"
+
+const UInt16 WINBOND_VENDOR_ID						= 0x5CA3;
+const UInt8 WINBOND_HIGH_BYTE						= 0x80;
+
+// Winbond Hardware Monitor
+const UInt8 WINBOND_VENDOR_ID_REGISTER              = 0x4F;
+const UInt8 WINBOND_TEMPERATURE_SOURCE_SELECT_REG	= 0x49;
+
+const UInt16 WINBOND_TEMPERATURE[]					= { 0x0150, 0x0250, 0x0027 };
+
+const UInt16 WINBOND_VOLTAGE_VBAT                   = 0x0551;
+
+const UInt16 WINBOND_VOLTAGE[]                      = { 0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0550, 0x0551, 0x0552 };
+const UInt16 WINBOND_VOLTAGE1[]                     = { 0x0020, 0x0021, 0x0022, 0x0023, 0x0024,                 0x0550, 0x0551 };
+
+const UInt16 WINBOND_TACHOMETER[]					= { 0x0028, 0x0029, 0x002A, 0x003F, 0x0553 };
+
+const UInt8 WINBOND_TACHOMETER_DIV0[]				= { 0x47, 0x47, 0x4B, 0x59, 0x59 };
+const UInt8 WINBOND_TACHOMETER_DIV0_BIT[]			= { 4,    6,    6,    0,    2 };
+const UInt8 WINBOND_TACHOMETER_DIV1[]				= { 0x47, 0x47, 0x4B, 0x59, 0x59 };
+const UInt8 WINBOND_TACHOMETER_DIV1_BIT[]			= { 5,    7,    7,    1,    3 };
+const UInt8 WINBOND_TACHOMETER_DIV2[]				= { 0x5D, 0x5D, 0x5D, 0x4C, 0x59 };
+const UInt8 WINBOND_TACHOMETER_DIV2_BIT[]			= { 5,    6,    7,    7,    7 };
+
+const UInt16 WINBOND_TACHOMETER_DIVISOR[]			= { 0x0047, 0x004B, 0x004C, 0x0059, 0x005D };
+const UInt8 WINBOND_TACHOMETER_DIVISOR0[]			= {     36,     38,     30,      8,     10 };
+const UInt8 WINBOND_TACHOMETER_DIVISOR1[]			= {     37,     39,     31,      9,     11 };
+const UInt8 WINBOND_TACHOMETER_DIVISOR2[]			= {      5,      6,      7,     23,     15 };
+
+// Fan Control
+const UInt8 WINBOND_FAN_PWM_ENABLE[]				= { 0x04, 0x04, 0x12, 0x62 };
+const UInt8 WINBOND_FAN_PWM_MODE_SHIFT[]			= { 0x00, 0x01, 0x00, 0x06 };
+const UInt8 WINBOND_FAN_PWM_ENABLE_SHIFT[]			= { 0x02, 0x04, 0x01, 0x04 };
+const UInt8 WINBOND_FAN_PWM_OUTPUT[]				= { 0x01, 0x03, 0x11, 0x61 };
+
+// Per-model description, bound once at start so the read path does no model branching
+struct WinbondChipDescriptor {
+    UInt16          model;
+    UInt8           fanLimit;
+    UInt8           voltageLimit;
+    float           voltageGain;
+    const UInt16    *voltageRegisters;
+    bool            vrmCoreVoltage;         // VIN0 is decoded with VRM8/VRM9 formula
+    float           pwmScale;               // PWM units per percent
+    UInt8           peciSourceMask[2];      // temperature source select bits, inputs reading PECI are skipped
+};
+
+const WinbondChipDescriptor WINBOND_CHIPS[] = {
+    { W83627EHF,    5, 10, 0.008f, WINBOND_VOLTAGE,     false,  2.55f, { 0x00, 0x00 } },
+    { W83627DHG,    5, 9,  0.008f, WINBOND_VOLTAGE,     false,  2.55f, { 0x07, 0x70 } },
+    { W83627DHGP,   5, 9,  0.008f, WINBOND_VOLTAGE,     false,  2.55f, { 0x07, 0x70 } },
+    { W83667HG,     5, 9,  0.008f, WINBOND_VOLTAGE,     false,  2.55f, { 0x04, 0x40 } },
+    { W83667HGB,    5, 9,  0.008f, WINBOND_VOLTAGE,     false,  2.55f, { 0x04, 0x40 } },
+    { W83627HF,     3, 7,  0.016f, WINBOND_VOLTAGE1,    true,   2.55f, { 0x00, 0x00 } },
+    { W83627THF,    3, 7,  0.016f, WINBOND_VOLTAGE1,    true,   2.55f, { 0x00, 0x00 } },
+    { W83687THF,    3, 7,  0.016f, WINBOND_VOLTAGE1,    true,   1.27f, { 0x00, 0x00 } },
+};
+
+inline UInt64 winbond_set_bit(UInt64 target, UInt16 bit, UInt32 value)
+{
+	if (((value & 1) == value) && bit <= 63)
+	{
+		UInt64 mask = (((UInt64)1) << bit);
+		return value > 0 ? target | mask : target & ~mask;
+	}
+	
+	return value;
+}
+
+// Fan counts are 8 bit, taken with a divisor of 1 << offset. 0xFF means the fan is stopped
+inline float winbond_fan_rpm(UInt8 count, UInt8 offset)
+{
+	return count > 0 && count < 0xff ? 1.35e6f / (float)(count * (1 << offset)) : 0;
+}
+
+// Moves the divisor so the next count lands between 96 and 192, where the resolution is best
+inline UInt8 winbond_next_divisor_offset(UInt8 count, UInt8 offset)
+{
+	if (count > 192 && offset < 7)
+		return offset + 1;
+
+	if (count < 96 && offset > 0)
+		return offset - 1;
+
+	return offset;
+}
+
+// Reads every fan count with its current divisor, then writes back the divisor bytes that changed
+inline void winbond_update_tachometers(UInt16 address, SInt16 *bank, UInt8 fanLimit, UInt16 *values)
+{
+	UInt64 bits = 0;
+	
+	for (int i = 0; i < 5; i++)
+	{
+		bits = (bits << 8) | superio_hwm_read_banked(address, bank, WINBOND_TACHOMETER_DIVISOR[i]);
+	}
+	
+	UInt64 newBits = bits;
+	
+	for (int i = 0; i < fanLimit; i++)
+	{
+		// assemble fan divisor
+		UInt8 offset =	(((bits >> WINBOND_TACHOMETER_DIVISOR2[i]) & 1) << 2) |
+		(((bits >> WINBOND_TACHOMETER_DIVISOR1[i]) & 1) << 1) |
+		((bits >> WINBOND_TACHOMETER_DIVISOR0[i]) & 1);
+		
+		UInt8 count = superio_hwm_read_banked(address, bank, WINBOND_TACHOMETER[i]);
+		
+		values[i] = winbond_fan_rpm(count, offset);
+		
+		offset = winbond_next_divisor_offset(count, offset);
+		
+		newBits = winbond_set_bit(newBits, WINBOND_TACHOMETER_DIVISOR2[i], (offset >> 2) & 1);
+		newBits = winbond_set_bit(newBits, WINBOND_TACHOMETER_DIVISOR1[i], (offset >> 1) & 1);
+		newBits = winbond_set_bit(newBits, WINBOND_TACHOMETER_DIVISOR0[i],  offset       & 1);
+	}		
+	
+	// write new fan divisors 
+	for (int i = 4; i >= 0; i--) 
+	{
+		UInt8 oldByte = bits & 0xff;
+		UInt8 newByte = newBits & 0xff;
+		
+		if (oldByte != newByte)
+		{
+			superio_hwm_write_banked(address, bank, WINBOND_TACHOMETER_DIVISOR[i], newByte);
+		}
+		
+		bits = bits >> 8;
+		newBits = newBits >> 8;
+	}
+}
+
+#endif
@@ -53,37 +53,20 @@
 #define super LPCSensors
 OSDefineMetaClassAndStructors(W836xxSensors, LPCSensors)
 
-UInt8 W836xxSensors::readByte(UInt16 reg) 
+void W836xxSensors::didBeginTransaction(void)
 {
-    UInt8 bank = reg >> 8;
-    UInt8 regi = reg & 0xFF;
-    
-	outb((UInt16)(address + WINBOND_ADDRESS_REGISTER_OFFSET), WINBOND_BANK_SELECT_REGISTER);
-	outb((UInt16)(address + WINBOND_DATA_REGISTER_OFFSET), bank);
-	outb((UInt16)(address + WINBOND_ADDRESS_REGISTER_OFFSET), regi);
-	return inb((UInt16)(address + WINBOND_DATA_REGISTER_OFFSET));
+    // Firmware may have switched banks since our previous transaction
+    bank = -1;
 }
 
-void W836xxSensors::writeByte(UInt16 reg, UInt8 value)
+UInt8 W836xxSensors::readRegister(UInt16 reg) 
 {
-    UInt8 bank = reg >> 8;
-    UInt8 regi = reg & 0xFF;
-    
-	outb((UInt16)(address + WINBOND_ADDRESS_REGISTER_OFFSET), WINBOND_BANK_SELECT_REGISTER);
-	outb((UInt16)(address + WINBOND_DATA_REGISTER_OFFSET), bank);
-	outb((UInt16)(address + WINBOND_ADDRESS_REGISTER_OFFSET), regi);
-	outb((UInt16)(address + WINBOND_DATA_REGISTER_OFFSET), value); 
+    return superio_hwm_read_banked(address, &bank, reg);
 }
 
-inline UInt64 set_bit(UInt64 target, UInt16 bit, UInt32 value)
+void W836xxSensors::writeRegister(UInt16 reg, UInt8 value)
 {
-	if (((value & 1) == value) && bit <= 63)
-	{
-		UInt64 mask = (((UInt64)1) << bit);
-		return value > 0 ? target | mask : target & ~mask;
-	}
-	
-	return value;
+    superio_hwm_write_banked(address, &bank, reg, value);
 }
 
 UInt8 W836xxSensors::temperatureSensorsLimit()
@@ -93,7 +76,7 @@ UInt8 W836xxSensors::temperatureSensorsLimit()
 
 UInt8 W836xxSensors::voltageSensorsLimit()
 {
-    return voltageLimit;
+    return chip->voltageLimit;
 }
 
 UInt8 W836xxSensors::tachometerSensorsLimit()
@@ -117,27 +100,11 @@ float W836xxSensors::readVoltage(UInt32 index)
 {
     float voltage = 0;
     
-    if (WINBOND_VOLTAGE[index] != WINBOND_VOLTAGE_VBAT) {
+    if (chip->voltageRegisters[index] != WINBOND_VOLTAGE_VBAT) {
         
-        UInt16 V = 0;
+        UInt16 V = readByte(chip->voltageRegisters[index]);
         
-        switch (model) 
-        {
-            case W83627EHF:
-            case W83627DHG:
-            case W83627DHGP:        
-            case W83667HG:
-            case W83667HGB:
-                V = readByte(WINBOND_VOLTAGE[index]);
-                break;
-            case W83627HF:
-            case W83627THF:
-            case W83687THF:
-                V = readByte(WINBOND_VOLTAGE1[index]);
-                break;
-        }
-        
-        if (index == 0 && (model == W83627HF || model == W83627THF || model == W83687THF)) 
+        if (index == 0 && chip->vrmCoreVoltage) 
         {
             UInt8 vrmConfiguration = readByte(0x0018);
             
@@ -146,12 +113,12 @@ float W836xxSensors::readVoltage(UInt32 index)
             else
                 voltage = 0.00488f * (float)V + 0.69f; // VRM9 formula
         }
-        else voltage = (float)V * voltageGain;
+        else voltage = (float)V * chip->voltageGain;
     }
 	else {
         // Battery voltage
         if ((readByte(0x005D) & 0x01) > 0)
-            voltage = readByte(WINBOND_VOLTAGE_VBAT) * voltageGain;
+            voltage = readByte(WINBOND_VOLTAGE_VBAT) * chip->voltageGain;
     }
 	
 	return voltage;
@@ -159,57 +126,12 @@ float W836xxSensors::readVoltage(UInt32 index)
 
 void W836xxSensors::updateTachometers()
 {
-	UInt64 bits = 0;
-	
-	for (int i = 0; i < 5; i++)
-	{
-		bits = (bits << 8) | readByte(WINBOND_TACHOMETER_DIVISOR[i]);
-	}
-	
-	UInt64 newBits = bits;
-	
+	// Divisor auto-ranging depends on the count taken with the divisor just written,
+	// so counts and divisors are read from the chip, not from the register snapshot
+	winbond_update_tachometers(address, &bank, fanLimit, fanValue);
+
 	for (int i = 0; i < fanLimit; i++)
-	{
-		// assemble fan divisor
-		UInt8 offset =	(((bits >> WINBOND_TACHOMETER_DIVISOR2[i]) & 1) << 2) |
-		(((bits >> WINBOND_TACHOMETER_DIVISOR1[i]) & 1) << 1) |
-		((bits >> WINBOND_TACHOMETER_DIVISOR0[i]) & 1);
-		
-		UInt8 divisor = 1 << offset;
-		UInt8 count = readByte(WINBOND_TACHOMETER[i]);
-		
-		// update fan divisor
-		if (count > 192 && offset < 7)
-		{
-			offset++;
-		}
-		else if (count < 96 && offset > 0)
-		{
-			offset--;
-		}
-		
-		fanValue[i] = (count < 0xff) ? 1.35e6f / (float(count * divisor)) : 0;
 		fanValueObsolete[i] = false;
-		
-		newBits = set_bit(newBits, WINBOND_TACHOMETER_DIVISOR2[i], (offset >> 2) & 1);
-		newBits = set_bit(newBits, WINBOND_TACHOMETER_DIVISOR1[i], (offset >> 1) & 1);
-		newBits = set_bit(newBits, WINBOND_TACHOMETER_DIVISOR0[i],  offset       & 1);
-	}		
-	
-	// write new fan divisors 
-	for (int i = 4; i >= 0; i--) 
-	{
-		UInt8 oldByte = bits & 0xff;
-		UInt8 newByte = newBits & 0xff;
-		
-		if (oldByte != newByte)
-		{
-			writeByte(WINBOND_TACHOMETER_DIVISOR[i], newByte);
-		}
-		
-		bits = bits >> 8;
-		newBits = newBits >> 8;
-	}
 }
 
 float W836xxSensors::readTachometer(UInt32 index)
@@ -232,11 +154,7 @@ UInt8 W836xxSensors::readTachometerControl(UInt32 index)
 {
     UInt8 control = readByte(WINBOND_FAN_PWM_OUTPUT[index]);
 
-    if (model == W83687THF) {
-        return (float)(control >> 8) / 1.27f;
-    }
-
-    return (float)(control) / 2.55f;
+    return (float)(control) / chip->pwmScale;
 }
 
 void W836xxSensors::writeTachometerControl(UInt32 index, UInt8 percent)
@@ -256,7 +174,7 @@ void W836xxSensors::writeTachometerControl(UInt32 index, UInt8 percent)
         }
         
         
-        writeByte(WINBOND_FAN_PWM_OUTPUT[index], (float)(percent) * (model == W83687THF ? 1.27f : 2.55f));
+        writeByte(WINBOND_FAN_PWM_OUTPUT[index], (float)(percent) * chip->pwmScale);
         
     }
 }
@@ -267,35 +185,22 @@ bool W836xxSensors::addTemperatureSensors(OSDictionary *configuration)
     
     UInt8 flag = 0;
     
-    switch (model) 
-    {
-        case W83667HG:
-        case W83667HGB:
-        case W83627DHG:        
-        case W83627DHGP:
-            // do not add temperature sensor registers that read PECI
+    // do not add temperature sensor registers that read PECI
+    if (chip->peciSourceMask[0] || chip->peciSourceMask[1]) {
+        LPCSensorsTransaction transaction(this);
+
+        if (transaction.isLocked())
             flag = readByte(WINBOND_TEMPERATURE_SOURCE_SELECT_REG);
-            break;                
+        else
+            HWSensorsWarningLog("firmware holds the ports, PECI sourced sensors skipped");
     }
     
     int index = 0;
     
     for (int i = 0; i < temperatureSensorsLimit(); i++) 
     {				
-        switch (model) 
-        {
-            case W83667HG:
-            case W83667HGB:
-                if ((i == 0 && ((flag & 0x04) == 0)) || (i == 1 && ((flag & 0x40) == 0)))
-                    continue;
-                break;
-                
-            case W83627DHG:        
-            case W83627DHGP:
-                if ((i == 0 && ((flag & 0x07) == 0)) || (i == 1 && ((flag & 0x70) == 0)))
-                    continue;
-                break;
-        }
+        if (i < 2 && chip->peciSourceMask[i] && (flag & chip->peciSourceMask[i]) == 0)
+            continue;
         
         char key[8];
         snprintf(key, 8, "TEMPIN%X", index++);
@@ -317,17 +222,26 @@ bool W836xxSensors::addTachometerSensors(OSDictionary *configuration)
 	if (fanlimit && fanlimit->unsigned8BitValue() > 0)
 		fanLimit = fanlimit->unsigned8BitValue();
     
-    // Be sure readTachometer will report correct values 
-    updateTachometers();
-    
-    for (int i = 0; i < fanLimit; i++)
-        readTachometer(i);
+    // Be sure readTachometer will report correct values. Transaction is scoped
+    // to the register accesses, key store lock is never taken under it
+    {
+        LPCSensorsTransaction transaction(this);
+
+        if (transaction.isLocked()) {
+            updateTachometers();
+
+            for (int i = 0; i < fanLimit; i++)
+                readTachometer(i);
+        }
+    }
     
     return super::addTachometerSensors(configuration);
 }
 
 bool W836xxSensors::initialize()
 {
+    bank = -1;
+
     UInt16 vendor = (UInt16)(readByte((WINBOND_HIGH_BYTE << 8) | WINBOND_VENDOR_ID_REGISTER) << 8) | readByte(WINBOND_VENDOR_ID_REGISTER);
     
     if (vendor != WINBOND_VENDOR_ID) {
@@ -335,29 +249,38 @@ bool W836xxSensors::initialize()
         return false;
     }
     
-    switch (model) 
-    {
-        case W83627EHF:
-            voltageLimit = 10;
-            fanLimit = 5;
-            voltageGain = 0.008f;
-            break;
-        case W83627DHG:
-        case W83627DHGP:        
-        case W83667HG:
-        case W83667HGB:
-            voltageLimit = 9;
-            fanLimit = 5;
-            voltageGain = 0.008f;
-            break;
-        case W83627HF:
-        case W83627THF:
-        case W83687THF:
-            voltageLimit = 7;
-            fanLimit = 3;
-            voltageGain = 0.016f;
+    chip = NULL;
+
+    for (unsigned int i = 0; i < sizeof(WINBOND_CHIPS) / sizeof(WINBOND_CHIPS[0]); i++) {
+        if (WINBOND_CHIPS[i].model == model) {
+            chip = &WINBOND_CHIPS[i];
             break;
+        }
     }
+
+    if (!chip) {
+        HWSensorsFatalLog("no descriptor for model 0x%x", model);
+        return false;
+    }
+
+    // Profile may lower it with FANINLIMIT
+    fanLimit = chip->fanLimit;
     
 	return true;
 }
+
+void W836xxSensors::hasPoweredOn()
+{
+    LPCSensorsTransaction transaction(this);
+
+    // Firmware still has the chip, the control timer calls us again
+    if (!transaction.isLocked()) {
+        deferPowerOn();
+        return;
+    }
+
+    // Firmware had the chip during sleep, don't trust the cached bank
+    bank = -1;
+
+    LPCSensors::hasPoweredOn();
+}
@@ -48,59 +48,24 @@
 
 #include <IOKit/IOService.h>
 #include "LPCSensors.h"
-
-const UInt16 WINBOND_VENDOR_ID						= 0x5CA3;
-const UInt8 WINBOND_HIGH_BYTE						= 0x80;
-
-// Winbond Hardware Monitor
-const UInt8 WINBOND_ADDRESS_REGISTER_OFFSET			= 0x05;
-const UInt8 WINBOND_DATA_REGISTER_OFFSET			= 0x06;
-const UInt8 WINBOND_BANK_SELECT_REGISTER			= 0x4E;
-
-const UInt8 WINBOND_VENDOR_ID_REGISTER              = 0x4F;
-const UInt8 WINBOND_TEMPERATURE_SOURCE_SELECT_REG	= 0x49;
-
-const UInt16 WINBOND_TEMPERATURE[]					= { 0x0150, 0x0250, 0x0027 };
-
-const UInt16 WINBOND_VOLTAGE_VBAT                   = 0x0551;
-
-const UInt16 WINBOND_VOLTAGE[]                      = { 0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0550, 0x0551, 0x0552 };
-const UInt16 WINBOND_VOLTAGE1[]                     = { 0x0020, 0x0021, 0x0022, 0x0023, 0x0024,                 0x0550, 0x0551 };
-
-const UInt16 WINBOND_TACHOMETER[]					= { 0x0028, 0x0029, 0x002A, 0x003F, 0x0553 };
-
-const UInt8 WINBOND_TACHOMETER_DIV0[]				= { 0x47, 0x47, 0x4B, 0x59, 0x59 };
-const UInt8 WINBOND_TACHOMETER_DIV0_BIT[]			= { 4,    6,    6,    0,    2 };
-const UInt8 WINBOND_TACHOMETER_DIV1[]				= { 0x47, 0x47, 0x4B, 0x59, 0x59 };
-const UInt8 WINBOND_TACHOMETER_DIV1_BIT[]			= { 5,    7,    7,    1,    3 };
-const UInt8 WINBOND_TACHOMETER_DIV2[]				= { 0x5D, 0x5D, 0x5D, 0x4C, 0x59 };
-const UInt8 WINBOND_TACHOMETER_DIV2_BIT[]			= { 5,    6,    7,    7,    7 };
-
-const UInt16 WINBOND_TACHOMETER_DIVISOR[]			= { 0x0047, 0x004B, 0x004C, 0x0059, 0x005D };
-const UInt8 WINBOND_TACHOMETER_DIVISOR0[]			= {     36,     38,     30,      8,     10 };
-const UInt8 WINBOND_TACHOMETER_DIVISOR1[]			= {     37,     39,     31,      9,     11 };
-const UInt8 WINBOND_TACHOMETER_DIVISOR2[]			= {      5,      6,      7,     23,     15 };
-
-// Fan Control
-const UInt8 WINBOND_FAN_PWM_ENABLE[]				= { 0x04, 0x04, 0x12, 0x62 };
-const UInt8 WINBOND_FAN_PWM_MODE_SHIFT[]			= { 0x00, 0x01, 0x00, 0x06 };
-const UInt8 WINBOND_FAN_PWM_ENABLE_SHIFT[]			= { 0x02, 0x04, 0x01, 0x04 };
-const UInt8 WINBOND_FAN_PWM_OUTPUT[]				= { 0x01, 0x03, 0x11, 0x61 };
+#include "SuperIODevice.h"
+#include "W836xxDefinitions.h"
 
 class EXPORT W836xxSensors : public LPCSensors
 {
     OSDeclareDefaultStructors(W836xxSensors)
 	
 private:
+    const WinbondChipDescriptor *chip;
 	UInt8					fanLimit;
-    UInt8					voltageLimit;
-    float                   voltageGain;
 	UInt16					fanValue[5];
 	bool					fanValueObsolete[5];
     bool                    fanControlEnabled[5];
-	
-	void					writeByte(UInt16 reg, UInt8 value);
-	UInt8					readByte(UInt16 reg);
+
+    SInt16                  bank;
+
+	virtual void			writeRegister(UInt16 reg, UInt8 value);
+	virtual UInt8			readRegister(UInt16 reg);
     
     virtual UInt8           temperatureSensorsLimit();
     virtual UInt8           voltageSensorsLimit();
@@ -119,6 +84,8 @@ private:
     virtual bool            addTachometerSensors(OSDictionary *configuration);
     
     virtual bool            initialize();
+    virtual void            didBeginTransaction(void);
+    virtual void            hasPoweredOn();
     
 public:
 	